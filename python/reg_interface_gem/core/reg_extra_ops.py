@@ -7,6 +7,12 @@ rReg.restype = c_uint
 rReg.argtypes=[c_uint]
 wReg = lib.putReg
 wReg.argtypes=[c_uint,c_uint]
+wRegMasked = lib.putRegMasked
+wRegMasked.argtypes=[c_uint,c_uint,c_uint]
+wRegMasked.restype = c_uint
+wRegsMasked = lib.putRegsMasked
+wRegsMasked.argtypes=[POINTER(c_uint32),POINTER(c_uint32),POINTER(c_uint32),c_long]
+wRegsMasked.restype = c_uint
 rpc_connect = lib.init
 rpc_connect.argtypes = [c_char_p]
 rpc_connect.restype = c_uint
@@ -50,6 +56,10 @@ rList = lib.getList
 rList.restype = c_uint
 rList.argtypes=[POINTER(c_uint32),POINTER(c_uint32)]
 
+rPlanned = lib.getPlanned
+rPlanned.restype = c_uint
+rPlanned.argtypes=[POINTER(c_uint32),POINTER(c_uint32),c_long]
+
 scanGBTPhases = lib.scanGBTPhases
 scanGBTPhases.restype = c_uint
 scanGBTPhases.argtype = [POINTER(c_uint), c_uint, c_uint, c_uint, c_uint, c_uint, c_uint, c_uint]
@@ -0,0 +1,333 @@
+/**
+ * @file bench_t.cpp
+ * Parser and lookup benchmarks on synthetic address tables, no hardware needed
+ *
+ * Usage: xhal_bench [-s <sizes>] [-d <depths>] [-l <lookups>] [-w <workdir>] [-c] [<address_table>.xml ...]
+ *   -s  comma separated approximate node counts of the synthetic tables (default 1000,10000,100000,500000)
+ *   -d  comma separated generate nesting depths of the synthetic tables (default 1,2,3)
+ *   -l  number of lookups per measurement (default 200000)
+ *   -w  directory the synthetic tables are written to (default /tmp/xhal_bench)
+ *   -c  prints CSV instead of a table
+ * Address tables given on the command line are benchmarked instead of the synthetic ones.
+ *
+ * Every parse runs in its own process, so that the reported peak RSS belongs to this parse only.
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#include "xhal/utils/XHALXMLParser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace xhal {
+  namespace test {
+    /**
+     * @brief writes a synthetic address table: a few plain registers and nested generate blocks of registers
+     * @param fileName output file
+     * @param nodes approximate number of nodes
+     * @param depth number of nested generate blocks
+     */
+    void writeSyntheticTable(const std::string& fileName, uint32_t nodes, int depth)
+    {
+      const uint32_t registers = 16;
+      const uint32_t system = 32;
+      // each innermost block holds its registers, every level multiplies the block count by the generate size
+      const double blocks = std::max(1.0, double(nodes - std::min(nodes, system + 3)) / (registers + 1));
+      const uint32_t size = std::max(1u, uint32_t(std::lround(std::pow(blocks, 1.0 / depth))));
+      std::vector<uint32_t> steps(depth);
+      uint32_t step = 0x20;
+      for (int level = depth - 1; level >= 0; --level) {
+        steps[level] = step;
+        uint32_t span = step * size;
+        step = 1;
+        while (step < span) step <<= 1;
+      }
+
+      std::ofstream out(fileName);
+      out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>" << std::endl;
+      out << "<node id=\"top\">" << std::endl;
+      out << " <node id=\"GEM_AMC\" address=\"0x0\" fw_is_module=\"true\">" << std::endl;
+      out << "  <node id=\"GEM_SYSTEM\" address=\"0x00900000\">" << std::endl;
+      for (uint32_t r = 0; r < system; ++r) {
+        out << "   <node id=\"REG" << r << "\" address=\"0x" << std::hex << r << std::dec
+            << "\" permission=\"rw\" mask=\"0x0000ffff\" description=\"System register " << r << "\"/>" << std::endl;
+      }
+      out << "  </node>" << std::endl;
+      out << "  <node id=\"BLOCKS\" address=\"0x01000000\">" << std::endl;
+      for (int level = 0; level < depth; ++level) {
+        const char name = 'A' + level;
+        out << std::string(level + 3, ' ') << "<node id=\"" << name << "${" << name << "_IDX}\" address=\"0x0\""
+            << " generate=\"true\" generate_size=\"" << size << "\" generate_address_step=\"0x" << std::hex << steps[level]
+            << std::dec << "\" generate_idx_var=\"" << name << "_IDX\">" << std::endl;
+      }
+      const std::string indent(depth + 3, ' ');
+      for (uint32_t r = 0; r < registers; ++r) {
+        out << indent << "<node id=\"REG" << r << "\" address=\"0x" << std::hex << r << std::dec << "\" permission=\""
+            << (r % 4 ? "rw" : "r") << "\" mask=\"" << (r % 2 ? "0x000000ff" : "0xffffffff") << "\"";
+        if (r % 8 == 0) out << " description=\"Synthetic register " << r << "\"";
+        out << "/>" << std::endl;
+      }
+      for (int level = depth - 1; level >= 0; --level) out << std::string(level + 3, ' ') << "</node>" << std::endl;
+      out << "  </node>" << std::endl;
+      out << " </node>" << std::endl;
+      out << "</node>" << std::endl;
+    }
+
+    /**
+     * @brief results of one benchmark run
+     */
+    struct BenchResult
+    {
+      double parseMs;
+      long peakRssKb;
+      uint64_t nodes;
+      double hitsPerSec;
+      double missesPerSec;
+      double refsPerSec;
+      double addressPerSec;
+      double prefixPerSec;
+      double prefixNodes;
+    };
+
+    class bench_t
+    {
+      public:
+        enum Mode {DOM, STREAM, CACHE, LAZY};
+        static const char * modeName(Mode mode)
+        {
+          switch (mode) {
+            case DOM:    return "dom";
+            case STREAM: return "sax";
+            case CACHE:  return "cache";
+            case LAZY:   return "lazy";
+          }
+          return "";
+        }
+
+        bench_t(size_t lookups) : m_lookups(lookups) {}
+
+        /**
+         * @brief parses the table in a child process and runs the lookup benchmarks there
+         * @return false if the child failed
+         */
+        bool run(const std::string& xmlFile, Mode mode, BenchResult& result)
+        {
+          if (mode == CACHE && !writeCache(xmlFile)) return false;
+          int fds[2];
+          if (pipe(fds) != 0) return false;
+          const pid_t pid = fork();
+          if (pid < 0) return false;
+          if (pid == 0) {
+            close(fds[0]);
+            BenchResult r;
+            std::memset(&r, 0, sizeof(r));
+            int rc = 1;
+            try {
+              measure(xmlFile, mode, r);
+              rc = write(fds[1], &r, sizeof(r)) == sizeof(r) ? 0 : 1;
+            } catch (std::exception& e) {
+              std::cerr << "Benchmark of " << xmlFile << " failed: " << e.what() << std::endl;
+            }
+            _exit(rc);
+          }
+          close(fds[1]);
+          const bool ok = read(fds[0], &result, sizeof(result)) == sizeof(result);
+          close(fds[0]);
+          int status;
+          waitpid(pid, &status, 0);
+          return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+
+      private:
+        size_t m_lookups;
+
+        /**
+         * @brief writes the cache image in a child process, the measured parse loads it
+         */
+        bool writeCache(const std::string& xmlFile)
+        {
+          const pid_t pid = fork();
+          if (pid < 0) return false;
+          if (pid == 0) {
+            try {
+              xhal::utils::XHALXMLParser parser(xmlFile);
+              parser.setLogLevel(0);
+              parser.setStreaming(true);
+              parser.parseXML();
+            } catch (std::exception& e) {
+              _exit(1);
+            }
+            _exit(0);
+          }
+          int status;
+          waitpid(pid, &status, 0);
+          return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+
+        template<typename F>
+        double perSecond(size_t count, F f)
+        {
+          auto begin = std::chrono::high_resolution_clock::now();
+          for (size_t n = 0; n < count; ++n) f(n);
+          auto end = std::chrono::high_resolution_clock::now();
+          return count / std::max(1e-9, std::chrono::duration<double>(end - begin).count());
+        }
+
+        void measure(const std::string& xmlFile, Mode mode, BenchResult& r)
+        {
+          xhal::utils::XHALXMLParser parser(xmlFile);
+          parser.setLogLevel(0);
+          parser.setUseCache(mode == CACHE);
+          parser.setStreaming(mode != DOM);
+          parser.setLazyExpansion(mode == LAZY);
+          auto begin = std::chrono::high_resolution_clock::now();
+          parser.parseXML();
+          auto end = std::chrono::high_resolution_clock::now();
+          r.parseMs = std::chrono::duration<double, std::milli>(end - begin).count();
+          struct rusage usage;
+          getrusage(RUSAGE_SELF, &usage);
+          r.peakRssKb = usage.ru_maxrss;
+
+          r.nodes = parser.getNodeStore().size();
+          // lazy mode: the generated names are taken from an expanded parse, done after the RSS measurement
+          std::unique_ptr<xhal::utils::XHALXMLParser> expanded;
+          if (mode == LAZY) {
+            expanded.reset(new xhal::utils::XHALXMLParser(xmlFile));
+            expanded->setLogLevel(0);
+            expanded->setUseCache(false);
+            expanded->setStreaming(true);
+            expanded->parseXML();
+          }
+          const xhal::utils::NodeStore& store = expanded ? expanded->getNodeStore() : parser.getNodeStore();
+          std::vector<std::string> names, misses;
+          std::vector<uint32_t> addresses;
+          std::vector<std::string> prefixes;
+          for (auto node: store) {
+            names.push_back(node.name());
+            if (node.permission() != xhal::utils::NodePermission::NONE) addresses.push_back(node.realAddress());
+            if (node.children().size() > 1) prefixes.push_back(node.name().substr(node.name().find('.') + 1) + ".");
+          }
+          std::mt19937 random(42);
+          std::shuffle(names.begin(), names.end(), random);
+          std::shuffle(addresses.begin(), addresses.end(), random);
+          std::shuffle(prefixes.begin(), prefixes.end(), random);
+          for (auto const& name: names) misses.push_back(name + "_MISSING");
+
+          size_t found = 0;
+          r.hitsPerSec = perSecond(m_lookups, [&](size_t n) {if (parser.getNode(names[n % names.size()].c_str())) ++found;});
+          r.missesPerSec = perSecond(m_lookups, [&](size_t n) {if (parser.getNode(misses[n % misses.size()].c_str())) ++found;});
+          if (mode == LAZY) {
+            // handles and address lookups only see the nodes outside of the generate blocks
+            if (found == 0) std::cerr << "No lookup succeeded for " << xmlFile << std::endl;
+            return;
+          }
+          r.refsPerSec = perSecond(m_lookups, [&](size_t n) {if (parser.findNode(names[n % names.size()])) ++found;});
+          if (!addresses.empty()) {
+            r.addressPerSec = perSecond(m_lookups, [&](size_t n) {if (parser.findNodeFromAddress(addresses[n % addresses.size()])) ++found;});
+          }
+          if (!prefixes.empty()) {
+            size_t matched = 0;
+            const size_t queries = std::max<size_t>(1, m_lookups / 100);
+            r.prefixPerSec = perSecond(queries, [&](size_t n) {matched += parser.findNodes(prefixes[n % prefixes.size()]).size();});
+            r.prefixNodes = double(matched) / queries;
+          }
+          if (found == 0) std::cerr << "No lookup succeeded for " << xmlFile << std::endl;
+        }
+    };
+  }
+}
+
+namespace {
+  std::vector<uint32_t> parseList(const char * s)
+  {
+    std::vector<uint32_t> values;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) values.push_back(std::strtoul(item.c_str(), nullptr, 10));
+    return values;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<uint32_t> sizes = {1000, 10000, 100000, 500000};
+  std::vector<uint32_t> depths = {1, 2, 3};
+  size_t lookups = 200000;
+  std::string workdir = "/tmp/xhal_bench";
+  bool csv = false;
+  std::vector<std::string> tables;
+  for (int a = 1; a < argc; ++a) {
+    const std::string arg = argv[a];
+    if (arg == "-c") csv = true;
+    else if (a + 1 < argc && arg == "-s") sizes = parseList(argv[++a]);
+    else if (a + 1 < argc && arg == "-d") depths = parseList(argv[++a]);
+    else if (a + 1 < argc && arg == "-l") lookups = std::strtoul(argv[++a], nullptr, 10);
+    else if (a + 1 < argc && arg == "-w") workdir = argv[++a];
+    else if (arg[0] == '-') {
+      std::cout << "Usage: " << argv[0] << " [-s <sizes>] [-d <depths>] [-l <lookups>] [-w <workdir>] [-c] [<address_table>.xml ...]" << std::endl;
+      return 2;
+    }
+    else tables.push_back(arg);
+  }
+
+  if (tables.empty()) {
+    mkdir(workdir.c_str(), 0775);
+    for (auto size: sizes) {
+      for (auto depth: depths) {
+        if (depth == 0) continue;
+        const std::string file = workdir + "/synthetic_" + std::to_string(size) + "_d" + std::to_string(depth) + ".xml";
+        xhal::test::writeSyntheticTable(file, size, depth);
+        tables.push_back(file);
+      }
+    }
+  }
+
+  if (csv) {
+    std::cout << "table,mode,nodes,parse_ms,peak_rss_kb,getNode_hit_per_s,getNode_miss_per_s,findNode_per_s,address_per_s,prefix_per_s,prefix_avg_nodes" << std::endl;
+  } else {
+    std::printf("%-40s %-5s %8s %10s %10s %12s %12s %12s %12s %10s\n", "table", "mode", "nodes", "parse ms", "peak KB",
+                "getNode/s", "miss/s", "findNode/s", "address/s", "prefix/s");
+  }
+  xhal::test::bench_t bench(lookups);
+  int failures = 0;
+  for (auto const& table: tables) {
+    const size_t slash = table.find_last_of('/');
+    const std::string shortName = slash == std::string::npos ? table : table.substr(slash + 1);
+    for (auto mode: {xhal::test::bench_t::DOM, xhal::test::bench_t::STREAM, xhal::test::bench_t::CACHE, xhal::test::bench_t::LAZY}) {
+      xhal::test::BenchResult r;
+      if (!bench.run(table, mode, r)) {
+        std::cout << shortName << " " << xhal::test::bench_t::modeName(mode) << " FAILED" << std::endl;
+        ++failures;
+        continue;
+      }
+      if (csv) {
+        std::cout << shortName << "," << xhal::test::bench_t::modeName(mode) << "," << r.nodes << "," << r.parseMs << ","
+                  << r.peakRssKb << "," << r.hitsPerSec << "," << r.missesPerSec << "," << r.refsPerSec << ","
+                  << r.addressPerSec << "," << r.prefixPerSec << "," << r.prefixNodes << std::endl;
+      } else {
+        std::printf("%-40s %-5s %8llu %10.1f %10ld %12.0f %12.0f %12.0f %12.0f %10.0f\n", shortName.c_str(),
+                    xhal::test::bench_t::modeName(mode), (unsigned long long)r.nodes, r.parseMs, r.peakRssKb,
+                    r.hitsPerSec, r.missesPerSec, r.refsPerSec, r.addressPerSec, r.prefixPerSec);
+      }
+    }
+  }
+  return failures ? 1 : 0;
+}
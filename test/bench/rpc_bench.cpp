@@ -0,0 +1,263 @@
+/**
+ * @file rpc_bench.cpp
+ * Throughput of the asynchronous RPC client against the number of requests in flight
+ *
+ * Usage: xhal_rpc_bench [-H <host>] [-p <port>] [-a <address>] [-n <requests>] [-d <depths>] [-l <latency_us>] [-c]
+ *   -H  board to benchmark, a local stand-in server is started if not given
+ *   -p  RPC port (default 9812)
+ *   -a  register address read by the requests (default 0x66400008)
+ *   -n  number of requests per measurement (default 20000)
+ *   -d  comma separated pipeline depths, i.e. numbers of connections (default 1,2,4,8,16,32)
+ *   -l  response latency of the stand-in server in microseconds (default 200)
+ *   -c  prints CSV instead of a table
+ *
+ * Every measurement issues memory.read requests of one word, first one by one with wisc::RPCSvc::call_method(),
+ * then through xhal::AsyncRPCClient at each depth, which opens as many connections. The stand-in server runs in a
+ * child process and answers the requests of a connection in order, each response being sent the given latency after
+ * its request arrived, so that a network round trip is modelled without a board. It assumes the messages are framed
+ * by their 32-bit length in network byte order followed by RPCMsg::serialize(), which is not checked against
+ * libwiscrpcsvc: the reference numbers are the ones measured against a board with -H.
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#include "xhal/XHALAsyncClient.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace xhal {
+  namespace test {
+    typedef std::chrono::steady_clock Clock;
+
+    bool readAll(int fd, void* data, size_t size)
+    {
+      char* p = static_cast<char*>(data);
+      while (size > 0) {
+        const ssize_t n = ::recv(fd, p, size, 0);
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+      }
+      return true;
+    }
+
+    bool writeAll(int fd, const void* data, size_t size)
+    {
+      const char* p = static_cast<const char*>(data);
+      while (size > 0) {
+        const ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+      }
+      return true;
+    }
+
+    /**
+     * @brief answers the requests of one connection: memory.read returns the address, the others an empty response
+     * a writer thread sends every response latency after its request arrived, in order
+     */
+    void serveConnection(int fd, std::chrono::microseconds latency)
+    {
+      std::deque<std::pair<Clock::time_point, std::string> > responses;
+      std::mutex mutex;
+      std::condition_variable ready;
+      bool done = false;
+      std::thread writer([&] {
+        while (true) {
+          std::unique_lock<std::mutex> lock(mutex);
+          ready.wait(lock, [&] {return !responses.empty() || done;});
+          if (responses.empty()) return;
+          auto response = std::move(responses.front());
+          responses.pop_front();
+          lock.unlock();
+          std::this_thread::sleep_until(response.first);
+          const uint32_t length = htonl(response.second.size());
+          if (!writeAll(fd, &length, sizeof(length)) || !writeAll(fd, response.second.data(), response.second.size())) return;
+        }
+      });
+
+      std::vector<char> buffer;
+      uint32_t length;
+      while (readAll(fd, &length, sizeof(length))) {
+        buffer.resize(ntohl(length));
+        if (!readAll(fd, buffer.data(), buffer.size())) break;
+        const Clock::time_point due = Clock::now() + latency;
+        wisc::RPCMsg request(buffer.data(), buffer.size());
+        wisc::RPCMsg response(request.get_method());
+        if (request.get_method() == "memory.read") {
+          std::vector<uint32_t> data(request.get_word("count"), request.get_word("address"));
+          response.set_word_array("data", data);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        responses.emplace_back(due, response.serialize());
+        ready.notify_one();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+      }
+      ready.notify_one();
+      writer.join();
+      ::close(fd);
+    }
+
+    /**
+     * @brief starts the stand-in server in a child process listening on the loopback interface
+     * @return pid of the child, -1 on failure
+     */
+    pid_t startServer(uint16_t port, std::chrono::microseconds latency)
+    {
+      const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+      const int one = 1;
+      ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      sockaddr_in address = {};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(port);
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 64) != 0) {
+        std::perror("Stand-in server");
+        ::close(listener);
+        return -1;
+      }
+      const pid_t pid = ::fork();
+      if (pid != 0) {
+        ::close(listener);
+        return pid;
+      }
+      while (true) {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) break;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::thread(serveConnection, fd, latency).detach();
+      }
+      ::_exit(0);
+    }
+
+    /**
+     * @brief reads the register count times, one request at a time
+     * @return requests per second
+     */
+    double runSync(const std::string& host, uint16_t port, uint32_t address, size_t count)
+    {
+      wisc::RPCSvc rpc;
+      rpc.connect(host, port);
+      rpc.load_module("memory", "memory v1.0.1");
+      wisc::RPCMsg request("memory.read");
+      request.set_word("address", address);
+      request.set_word("count", 1);
+      const Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < count; ++i) rpc.call_method(request);
+      const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+      rpc.disconnect();
+      return count / seconds;
+    }
+
+    /**
+     * @brief reads the register count times with up to depth requests in flight
+     * @return requests per second, 0 if a request failed
+     */
+    double runAsync(const std::string& host, uint16_t port, uint32_t address, size_t count, size_t depth)
+    {
+      xhal::AsyncRPCClient client(depth);
+      client.connect(host, port);
+      client.loadModule("memory", "memory v1.0.1");
+      wisc::RPCMsg request("memory.read");
+      request.set_word("address", address);
+      request.set_word("count", 1);
+      std::atomic<size_t> failures(0);
+      const Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < count; ++i) {
+        client.call(request, [&failures](uint64_t, const wisc::RPCMsg&, std::exception_ptr error) {
+          if (error) ++failures;
+        });
+      }
+      client.flush();
+      const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+      return failures ? 0 : count / seconds;
+    }
+
+    std::vector<uint32_t> parseList(const std::string& s)
+    {
+      std::vector<uint32_t> values;
+      std::stringstream ss(s);
+      std::string item;
+      while (std::getline(ss, item, ',')) values.push_back(std::strtoul(item.c_str(), nullptr, 10));
+      return values;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::string host;
+  uint16_t port = 9812;
+  uint32_t address = 0x66400008;
+  size_t requests = 20000;
+  std::vector<uint32_t> depths = {1, 2, 4, 8, 16, 32};
+  uint32_t latency = 200;
+  bool csv = false;
+  for (int a = 1; a < argc; ++a) {
+    const std::string arg = argv[a];
+    if (arg == "-c") csv = true;
+    else if (a + 1 < argc && arg == "-H") host = argv[++a];
+    else if (a + 1 < argc && arg == "-p") port = std::strtoul(argv[++a], nullptr, 10);
+    else if (a + 1 < argc && arg == "-a") address = std::strtoul(argv[++a], nullptr, 0);
+    else if (a + 1 < argc && arg == "-n") requests = std::strtoul(argv[++a], nullptr, 10);
+    else if (a + 1 < argc && arg == "-d") depths = xhal::test::parseList(argv[++a]);
+    else if (a + 1 < argc && arg == "-l") latency = std::strtoul(argv[++a], nullptr, 10);
+    else {
+      std::cout << "Usage: " << argv[0] << " [-H <host>] [-p <port>] [-a <address>] [-n <requests>] [-d <depths>] [-l <latency_us>] [-c]" << std::endl;
+      return 2;
+    }
+  }
+
+  pid_t server = -1;
+  if (host.empty()) {
+    host = "localhost";
+    server = xhal::test::startServer(port, std::chrono::microseconds(latency));
+    if (server < 0) return 1;
+  }
+
+  int failures = 0;
+  try {
+    const double sync = xhal::test::runSync(host, port, address, requests);
+    if (csv) std::cout << "depth,requests_per_s,speedup" << std::endl << "sync," << sync << ",1" << std::endl;
+    else std::printf("%-8s %14s %8s\n%-8s %14.0f %8.2f\n", "depth", "requests/s", "speedup", "sync", sync, 1.0);
+    for (auto depth: depths) {
+      const double rate = xhal::test::runAsync(host, port, address, requests, depth);
+      if (rate == 0) ++failures;
+      if (csv) std::cout << depth << "," << rate << "," << rate / sync << std::endl;
+      else std::printf("%-8u %14.0f %8.2f\n", depth, rate, rate / sync);
+    }
+  } catch (wisc::RPCSvc::RPCException &e) {
+    std::cout << "RPC exception: " << e.message << std::endl;
+    ++failures;
+  }
+
+  if (server > 0) {
+    ::kill(server, SIGTERM);
+    ::waitpid(server, nullptr, 0);
+  }
+  return failures ? 1 : 0;
+}
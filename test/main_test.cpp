@@ -1,6 +1,16 @@
 #include "units/getNode_t.cpp"
+#include "units/getNodeFromAddress_t.cpp"
 #include "units/parse_t.cpp"
+#include "units/parseStream_t.cpp"
+#include "units/lazyNode_t.cpp"
+#include "units/findNodes_t.cpp"
+#include "units/getAllChildren_t.cpp"
+#include "units/tableRegistry_t.cpp"
+#include "units/tableStore_t.cpp"
+#include "units/readPlan_t.cpp"
+#include "units/registerCache_t.cpp"
 #include "units/XHALInterface_t.cpp"
+#include "units/asyncClient_t.cpp"
 
 #include <iostream>
 #include <chrono>
@@ -19,7 +29,7 @@ int main(int argc, char** argv)
     std::cout << "Usage: <path>/test <address_table>.xml" << std::endl;
     return 0;
   }
-  int test_results[2];
+  int test_results[11];
   xhal::test::parse_t * t1 = new xhal::test::parse_t(argv[1]);
   std::cout<<std::endl;
   std::cout << "Start parsing test" << std::endl;
@@ -45,9 +55,126 @@ int main(int argc, char** argv)
   }
   end = std::chrono::high_resolution_clock::now();
   std::cout << "getNode test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::getNodeFromAddress_t * t4 = new xhal::test::getNodeFromAddress_t(t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start getNodeFromAddress test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[2] = t4->launch();
+  if (test_results[2]) 
+  {
+    std::cout << "getNodeFromAddress test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "getNodeFromAddress test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::parseStream_t * t5 = new xhal::test::parseStream_t(argv[1], t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start streaming parsing test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[3] = t5->launch();
+  if (test_results[3]) 
+  {
+    std::cout << "streaming parseXML test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "streaming parsing test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::lazyNode_t * t6 = new xhal::test::lazyNode_t(argv[1], t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start lazy expansion test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[4] = t6->launch();
+  if (test_results[4]) 
+  {
+    std::cout << "lazy expansion test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "lazy expansion test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::findNodes_t * t7 = new xhal::test::findNodes_t(t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start findNodes test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[5] = t7->launch();
+  if (test_results[5]) 
+  {
+    std::cout << "findNodes test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "findNodes test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::getAllChildren_t * t8 = new xhal::test::getAllChildren_t(t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start getAllChildren test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[6] = t8->launch();
+  if (test_results[6]) 
+  {
+    std::cout << "getAllChildren test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "getAllChildren test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::tableRegistry_t * t9 = new xhal::test::tableRegistry_t(argv[1], t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start table registry test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[7] = t9->launch();
+  if (test_results[7]) 
+  {
+    std::cout << "table registry test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "table registry test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::tableStore_t * t10 = new xhal::test::tableStore_t(argv[1], t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start table store test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[8] = t10->launch();
+  if (test_results[8]) 
+  {
+    std::cout << "table store test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "table store test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::readPlan_t * t11 = new xhal::test::readPlan_t(t_parser);
+  std::cout<<std::endl;
+  std::cout << "Start read plan test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[9] = t11->launch();
+  if (test_results[9]) 
+  {
+    std::cout << "read plan test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "read plan test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  xhal::test::registerCache_t * t12 = new xhal::test::registerCache_t();
+  std::cout<<std::endl;
+  std::cout << "Start register cache test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  test_results[10] = t12->launch();
+  if (test_results[10]) 
+  {
+    std::cout << "register cache test failed" << std::endl; // TODO call test summary function??
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "register cache test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
 
   if (t1) delete t1;
   if (t2) delete t2;
+  if (t4) delete t4;
+  if (t5) delete t5;
+  if (t6) delete t6;
+  if (t7) delete t7;
+  if (t8) delete t8;
+  if (t9) delete t9;
+  if (t10) delete t10;
+  if (t11) delete t11;
+  if (t12) delete t12;
 
   xhal::test::XHALInterface_t * t3 = new xhal::test::XHALInterface_t("eagle34",argv[1]);
   std::cout << "Start XHALInterface test" << std::endl;
@@ -82,6 +209,24 @@ int main(int argc, char** argv)
   end = std::chrono::high_resolution_clock::now();
   std::cout << "writeReg completeness test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
   std::cout << "=================================" << std::endl;
+  std::cout << "Start transaction test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  t3->transaction_t();
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "transaction test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  std::cout << "=================================" << std::endl;
+  xhal::test::asyncClient_t * t13 = new xhal::test::asyncClient_t("eagle34",argv[1]);
+  std::cout << "Start asynchronous client test" << std::endl;
+  begin = std::chrono::high_resolution_clock::now();
+  if (t13->launch())
+  {
+    std::cout << "asynchronous client test failed" << std::endl;
+    return 1;
+  }
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "asynchronous client test done in " << std::chrono::duration_cast<std::chrono::microseconds>(end-begin).count() << " us" << std::endl;
+  std::cout << "=================================" << std::endl;
+  delete t13;
 
   std::cout << "=================================" << std::endl;
   std::cout << "=================================" << std::endl;
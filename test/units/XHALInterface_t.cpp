@@ -1,4 +1,5 @@
 #include "xhal/XHALInterface.h"
+#include "xhal/XHALTransaction.h"
 #include <iostream>
 
 namespace xhal {
@@ -41,6 +42,17 @@ namespace xhal {
           test = m_interface->readReg("top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN");
           std::cout << "Value after write of top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN: " << std::hex << test << std::dec << std::endl;
         }
+        void transaction_t()
+        {
+          xhal::Transaction t(*m_interface);
+          t.write("top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN", 0xbeef);
+          t.write("top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN", 0x76bc);
+          xhal::Transaction::Stats stats = t.commit();
+          std::cout << "Transaction of " << stats.writes << " writes to " << stats.words << " words committed in "
+                    << stats.roundTrips() << " round trips" << std::endl;
+          uint32_t test = m_interface->readReg("top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN");
+          std::cout << "Value after transaction of top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN: " << std::hex << test << std::dec << std::endl;
+        }
       private:
         xhal::XHALInterface * m_interface;
         std::string s1,s2;
@@ -0,0 +1,144 @@
+#include "xhal/XHALAsyncClient.h"
+#include "xhal/XHALInterface.h"
+#include <future>
+#include <iostream>
+#include <set>
+#include <vector>
+
+namespace xhal {
+  namespace utils {
+  }
+  namespace test {
+    class asyncClient_t
+    {
+      public:
+        asyncClient_t(const std::string& board_domain_name, const std::string& address_table_filename)
+        {
+          s1 = board_domain_name;
+          s2 = address_table_filename;
+        }
+        int launch()
+        {
+          xhal::XHALInterface xhal(s1, s2);
+          xhal.init();
+          m_address = xhal.getRegister("top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN").address;
+          if (spread_t(8) || spread_t(4)) return 1;
+          xhal::AsyncRPCClient client(4);
+          client.connect(s1);
+          if (!client.loadModule("memory", "memory v1.0.1")) {
+            std::cout << "Could not load the memory module" << std::endl;
+            return 1;
+          }
+          if (ordering_t(client) || depth_t(client) || error_t(client) || interface_t(xhal)) return 1;
+          client.disconnect();
+          return 0;
+        }
+      private:
+        std::string s1,s2;
+        uint32_t m_address;
+
+        wisc::RPCMsg write(uint32_t value)
+        {
+          wisc::RPCMsg request("memory.write");
+          request.set_word("address", m_address);
+          request.set_word_array("data", &value, 1);
+          return request;
+        }
+        wisc::RPCMsg read()
+        {
+          wisc::RPCMsg request("memory.read");
+          request.set_word("address", m_address);
+          request.set_word("count", 1);
+          return request;
+        }
+        uint32_t value(std::future<wisc::RPCMsg>& response)
+        {
+          uint32_t word;
+          response.get().get_word_array("data", &word);
+          return word & 0xffff;
+        }
+
+        // consecutive register addresses, multiples of 4, go through several connections
+        int spread_t(size_t depth)
+        {
+          xhal::AsyncRPCClient client(depth);
+          std::set<size_t> connections;
+          for (uint32_t i = 0; i < 8; ++i) connections.insert(client.getConnection(m_address + 4 * i));
+          if (connections.size() <= 2) {
+            std::cout << "8 consecutive words go through " << connections.size() << " of " << depth << " connections" << std::endl;
+            return 1;
+          }
+          return 0;
+        }
+        // the writes and reads of the same key are executed in the order of the calls
+        int ordering_t(xhal::AsyncRPCClient& client)
+        {
+          std::vector<std::future<wisc::RPCMsg> > reads;
+          for (uint32_t i = 0; i < 64; ++i) {
+            client.call(write(0x1000 + i), m_address);
+            reads.push_back(client.call(read(), m_address));
+          }
+          for (uint32_t i = 0; i < reads.size(); ++i) {
+            const uint32_t res = value(reads[i]);
+            if (res != 0x1000 + i) {
+              std::cout << "Read " << std::hex << res << " after the write of " << 0x1000 + i << std::dec << std::endl;
+              return 1;
+            }
+          }
+          return 0;
+        }
+        // the callers block while depth requests are in flight
+        int depth_t(xhal::AsyncRPCClient& client)
+        {
+          size_t maxInFlight = 0;
+          for (int i = 0; i < 256; ++i) {
+            client.call(read(), [](uint64_t, const wisc::RPCMsg&, std::exception_ptr) {});
+            maxInFlight = std::max(maxInFlight, client.getInFlight());
+          }
+          client.flush();
+          std::cout << "At most " << maxInFlight << " requests in flight at depth " << client.getDepth() << std::endl;
+          if (maxInFlight > client.getDepth() || client.getInFlight() != 0) {
+            std::cout << "Pipeline depth exceeded" << std::endl;
+            return 1;
+          }
+          return 0;
+        }
+        // a failed request throws from its future, the next requests go through
+        int error_t(xhal::AsyncRPCClient& client)
+        {
+          std::future<wisc::RPCMsg> failed = client.call(wisc::RPCMsg("memory.no_such_method"));
+          std::future<wisc::RPCMsg> next = client.call(read());
+          try {
+            failed.get();
+            std::cout << "No error from the unknown method" << std::endl;
+            return 1;
+          } catch (wisc::RPCSvc::RPCErrorException &e) {
+            std::cout << "Unknown method failed with: " << e.message << std::endl;
+          }
+          try {
+            next.get();
+          } catch (wisc::RPCSvc::RPCException &e) {
+            std::cout << "Request after the error failed with: " << e.message << std::endl;
+            return 1;
+          }
+          return 0;
+        }
+        int interface_t(xhal::XHALInterface& xhal)
+        {
+          std::vector<std::future<uint32_t> > reads;
+          for (uint32_t i = 0; i < 64; ++i) {
+            xhal.writeRegAsync("top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN", 0x2000 + i);
+            reads.push_back(xhal.readRegAsync("top.GEM_AMC.GEM_SYSTEM.GBT.TX_SYNC_PATTERN"));
+          }
+          for (uint32_t i = 0; i < reads.size(); ++i) {
+            const uint32_t res = reads[i].get();
+            if (res != 0x2000 + i) {
+              std::cout << "readRegAsync returned " << std::hex << res << " after the write of " << 0x2000 + i << std::dec << std::endl;
+              return 1;
+            }
+          }
+          return 0;
+        }
+    };
+  }
+}
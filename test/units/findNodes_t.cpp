@@ -0,0 +1,65 @@
+#include "xhal/utils/XHALXMLParser.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace xhal {
+  namespace test {
+    class findNodes_t
+    {
+      public:
+        findNodes_t(xhal::utils::XHALXMLParser * parser)
+        {
+          m_parser = parser;
+        }
+        ~findNodes_t(){}
+        int launch()
+        {
+          const xhal::utils::NodeStore & store = m_parser->getNodeStore();
+          if (store.size() < 2) return 1;
+          const std::string prefix = store.name(1) + ".";
+          const std::string token = store.token(store.size() - 1);
+          // every query is checked against a linear scan of the names
+          if (check(prefix, [&](const std::string & name) {return name.compare(0, prefix.size(), prefix) == 0;})) return 1;
+          if (check("*." + token, [&](const std::string & name) {
+                return name.size() > token.size() && name.compare(name.size() - token.size() - 1, std::string::npos, "." + token) == 0;
+              })) return 1;
+          if (check("*[0-3]", [&](const std::string & name) {return name.back() >= '0' && name.back() <= '3';})) return 1;
+          if (check("**", [](const std::string &) {return true;})) return 1;
+          return 0;
+        }
+      private:
+        xhal::utils::XHALXMLParser * m_parser;
+
+        template<typename F>
+        int check(const std::string & pattern, F expected)
+        {
+          const xhal::utils::NodeStore & store = m_parser->getNodeStore();
+          std::vector<uint32_t> nodes;
+          try
+          {
+            nodes = m_parser->findNodes(pattern);
+          } catch (...) {
+            std::cout << "findNodes failed for pattern " << pattern << std::endl;
+            return 1;
+          }
+          size_t n = 0;
+          for (uint32_t i = 0; i < store.size(); ++i) if (expected(store.name(i))) ++n;
+          if (nodes.size() != n)
+          {
+            std::cout << "findNodes returned " << nodes.size() << " nodes instead of " << n << " for pattern " << pattern << std::endl;
+            return 1;
+          }
+          for (size_t k = 0; k < nodes.size(); ++k)
+          {
+            if (!expected(store.name(nodes[k])) || (k > 0 && store.address(nodes[k - 1]) > store.address(nodes[k])))
+            {
+              std::cout << "findNodes returned unexpected node " << store.name(nodes[k]) << " for pattern " << pattern << std::endl;
+              return 1;
+            }
+          }
+          return 0;
+        }
+    };
+  }
+}
@@ -0,0 +1,52 @@
+#include "xhal/utils/XHALXMLParser.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace xhal {
+  namespace test {
+    class getAllChildren_t
+    {
+      public:
+        getAllChildren_t(xhal::utils::XHALXMLParser * parser)
+        {
+          m_parser = parser;
+        }
+        ~getAllChildren_t(){}
+        int launch()
+        {
+          const xhal::utils::NodeStore & store = m_parser->getNodeStore();
+          if (store.size() < 2) return 1;
+          // compare against a scan of the names below the first child of the root
+          const std::string top = store.name(1);
+          const std::string prefix = top + ".";
+          size_t leaves = 0;
+          uint32_t minAddress = 0xFFFFFFFF, maxAddress = 0;
+          for (uint32_t i = 1; i < store.size(); ++i)
+          {
+            const std::string name = store.name(i);
+            if (name != top && name.compare(0, prefix.size(), prefix) != 0) continue;
+            if (store.firstChild(i) == xhal::utils::NodeStore::NO_NODE) ++leaves;
+            if (store.permission(i) == xhal::utils::NodePermission::NONE) continue;
+            minAddress = std::min(minAddress, store.address(i));
+            maxAddress = std::max(maxAddress, store.address(i) + store.span(i) - 1);
+          }
+          std::vector<xhal::utils::Node> kids = m_parser->getAllChildren(top.c_str());
+          if (kids.size() != leaves)
+          {
+            std::cout << "getAllChildren returned " << kids.size() << " nodes instead of " << leaves << " for " << top << std::endl;
+            return 1;
+          }
+          if (store.subtreeMinAddress(1) != minAddress || store.subtreeMaxAddress(1) != maxAddress)
+          {
+            std::cout << "Wrong address range of the subtree " << top << std::endl;
+            return 1;
+          }
+          if (!m_parser->getAllChildren("top.NO_SUCH_NODE").empty()) return 1;
+          return 0;
+        }
+      private:
+        xhal::utils::XHALXMLParser * m_parser;
+    };
+  }
+}
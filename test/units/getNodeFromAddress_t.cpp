@@ -0,0 +1,41 @@
+#include "xhal/utils/XHALXMLParser.h"
+#include <iostream>
+
+namespace xhal {
+  namespace test {
+    class getNodeFromAddress_t
+    {
+      public:
+        getNodeFromAddress_t(xhal::utils::XHALXMLParser * parser)
+        {
+          m_parser = parser;
+        }
+        ~getNodeFromAddress_t(){}
+        int launch()
+        {
+          if (auto myOptNode = m_parser->getNodeFromAddress(0x0))
+          {
+            myNode = myOptNode.value();
+            std::cout << "Test called for unmapped address 0x0 and returned: " << std::endl;
+            std::cout << "Node name: " << myNode.name << ", Node address: " << std::hex << myNode.address << std::dec << std::endl;
+            return 1;
+          }
+          // top.GEM_AMC.GEM_SYSTEM.BOARD_ID, address 0x00900002
+          if (auto myOptNode = m_parser->getNodeFromAddress(0x66400008))
+          {
+            myNode = myOptNode.value();
+            if ((myNode.name == "top.GEM_AMC.GEM_SYSTEM.BOARD_ID") && (myNode.real_address == 0x66400008))
+            {
+              return 0;
+            }
+          }
+          std::cout << "Test called for real address 0x66400008 and returned: " << std::endl;
+          std::cout << "Node name: " << myNode.name << ", Node address: " << std::hex << myNode.address << std::dec << std::endl;
+          return 1;
+        }
+      private:
+        xhal::utils::XHALXMLParser * m_parser;
+        xhal::utils::Node myNode;
+    };
+  }
+}
@@ -27,6 +27,14 @@ namespace xhal {
             myNode = myOptNode.value();
             if ((myNode.name == "top.GEM_AMC.GEM_SYSTEM.BOARD_ID") && (myNode.address == 0x00900002))
             {
+              // the handle API must agree with the copying one
+              xhal::utils::NodeRef ref = m_parser->findNode("top.GEM_AMC.GEM_SYSTEM.BOARD_ID");
+              if (!ref || ref.name() != myNode.name || ref.address() != myNode.address || ref.realAddress() != myNode.real_address
+                  || m_parser->findNode("top.GEM_SYSTEM.BOARD_ID"))
+              {
+                std::cout << "findNode returned a different node for top.GEM_AMC.GEM_SYSTEM.BOARD_ID" << std::endl;
+                return 1;
+              }
               return 0;
             }
           } else {
@@ -0,0 +1,113 @@
+#include "xhal/utils/XHALXMLParser.h"
+#include <iostream>
+#include <string>
+
+namespace xhal {
+  namespace test {
+    class lazyNode_t
+    {
+      public:
+        lazyNode_t(const std::string & address_table_filename, xhal::utils::XHALXMLParser * reference)
+        {
+          m_filename = address_table_filename;
+          m_parser = new xhal::utils::XHALXMLParser(address_table_filename);
+          m_reference = reference;
+        }
+        ~lazyNode_t()
+        {
+          if (m_parser) delete m_parser;
+        }
+        int launch()
+        {
+          try 
+          {
+            m_parser->setLogLevel(1);
+            m_parser->setUseCache(false);
+            m_parser->setLazyExpansion(true);
+            m_parser->setLazyCacheSize(16);
+            m_parser->parseXML();
+          } catch (...){
+            std::cout << "Lazy parsing failed" << std::endl;
+            return 1;
+          }
+          const xhal::utils::NodeStore & reference = m_reference->getNodeStore();
+          std::cout << "Lazy parser materialized " << m_parser->getNodeStore().size() << " nodes out of " << reference.size() << std::endl;
+          for (uint32_t i = 0; i < reference.size(); ++i)
+          {
+            const std::string name = reference.name(i);
+            auto node = m_parser->getNode(name.c_str());
+            if (!node)
+            {
+              std::cout << "Lazy parser did not find node " << name << std::endl;
+              return 1;
+            }
+            if (node->address != reference.address(i) || node->real_address != reference.realAddress(i) ||
+                node->mask != reference.mask(i) || node->size != reference.nodeSize(i) ||
+                node->level != reference.level(i) || node->description != reference.description(i))
+            {
+              std::cout << "Lazy parser node " << name << " differs from expanded node" << std::endl;
+              return 1;
+            }
+          }
+          if (address_t()) return 1;
+          if (m_parser->getNode("top.NO_SUCH_NODE") || m_parser->getAllNodes().size() != m_reference->getAllNodes().size())
+          {
+            std::cout << "Lazy parser expansion differs from expanded nodes" << std::endl;
+            return 1;
+          }
+          return 0;
+        }
+      private:
+        std::string m_filename;
+        xhal::utils::XHALXMLParser * m_parser;
+        xhal::utils::XHALXMLParser * m_reference;
+
+        // the generated registers are found by address once the blocks spanning it are expanded
+        int address_t()
+        {
+          xhal::utils::XHALXMLParser parser(m_filename);
+          parser.setLogLevel(1);
+          parser.setUseCache(false);
+          parser.setLazyExpansion(true);
+          parser.parseXML();
+          const xhal::utils::NodeStore & reference = m_reference->getNodeStore();
+          uint32_t generated = xhal::utils::NodeStore::NO_NODE;
+          for (uint32_t i = 0; i < reference.size() && generated == xhal::utils::NodeStore::NO_NODE; ++i)
+          {
+            if (reference.permission(i) != xhal::utils::NodePermission::NONE && !parser.findNode(reference.name(i))) generated = i;
+          }
+          if (generated == xhal::utils::NodeStore::NO_NODE)
+          {
+            std::cout << "No generated register in the address table, address lookup not tested" << std::endl;
+            return 0;
+          }
+          // an address outside of the table leaves the blocks unexpanded
+          if (parser.getNodeFromAddress(0) || parser.getNodeStore().size() != m_parser->getNodeStore().size())
+          {
+            std::cout << "Lazy parser expanded generate blocks on an unmapped address" << std::endl;
+            return 1;
+          }
+          const std::string name = reference.name(generated);
+          auto node = parser.getNodeFromAddress(reference.realAddress(generated));
+          if (!node || !parser.findNode(name))
+          {
+            std::cout << "Lazy parser did not expand the generate block of " << name << " on address lookup" << std::endl;
+            return 1;
+          }
+          for (uint32_t i = 0; i < reference.size(); ++i)
+          {
+            if (reference.permission(i) == xhal::utils::NodePermission::NONE) continue;
+            auto expected = m_reference->getNodeFromAddress(reference.realAddress(i));
+            auto found = parser.getNodeFromAddress(reference.realAddress(i));
+            if (!found || found->real_address != expected->real_address || parser.getNodesFromAddress(reference.realAddress(i)).size() !=
+                m_reference->getNodesFromAddress(reference.realAddress(i)).size())
+            {
+              std::cout << "Lazy parser address lookup of " << reference.name(i) << " differs from expanded nodes" << std::endl;
+              return 1;
+            }
+          }
+          return 0;
+        }
+    };
+  }
+}
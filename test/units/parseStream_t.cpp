@@ -0,0 +1,141 @@
+#include "xhal/utils/XHALXMLParser.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+namespace xhal {
+  namespace test {
+    class parseStream_t
+    {
+      public:
+        parseStream_t(const std::string & address_table_filename, xhal::utils::XHALXMLParser * reference)
+        {
+          m_parser = new xhal::utils::XHALXMLParser(address_table_filename);
+          m_reference = reference;
+        }
+        ~parseStream_t()
+        {
+          if (m_parser) delete m_parser;
+        }
+        int launch()
+        {
+          try 
+          {
+            m_parser->setLogLevel(1);
+            m_parser->setUseCache(false);
+            m_parser->setStreaming(true);
+            m_parser->parseXML();
+          } catch (...){
+            std::cout << "Streaming parsing failed" << std::endl;
+            return 1;
+          }
+          const xhal::utils::NodeStore & store = m_parser->getNodeStore();
+          const xhal::utils::NodeStore & reference = m_reference->getNodeStore();
+          if (store.size() != reference.size())
+          {
+            std::cout << "Streaming parser returned " << store.size() << " nodes instead of " << reference.size() << std::endl;
+            return 1;
+          }
+          for (uint32_t i = 0; i < store.size(); ++i)
+          {
+            if (store.name(i) != reference.name(i) || store.address(i) != reference.address(i) ||
+                store.mask(i) != reference.mask(i) || store.permission(i) != reference.permission(i) ||
+                store.mode(i) != reference.mode(i) || store.nodeSize(i) != reference.nodeSize(i) ||
+                std::string(store.description(i)) != reference.description(i))
+            {
+              std::cout << "Streaming parser node " << store.name(i) << " differs from DOM parser node " << reference.name(i) << std::endl;
+              return 1;
+            }
+          }
+          // nothing changed on disk since the parse
+          if (m_parser->reparseChanged())
+          {
+            std::cout << "Unchanged address table was reparsed" << std::endl;
+            return 1;
+          }
+          return reload_t();
+        }
+      private:
+        /**
+         * @brief reloads an included file of a small table many times, its nodes must stay in document order and the
+         * removed ones must not pile up
+         */
+        int reload_t()
+        {
+          char dir[] = "/tmp/xhal_reload_XXXXXX";
+          if (!mkdtemp(dir))
+          {
+            std::cout << "Unable to create the reload test directory" << std::endl;
+            return 1;
+          }
+          const std::string top = std::string(dir) + "/top.xml";
+          const std::string part = std::string(dir) + "/part.xml";
+          std::ofstream(top.c_str())
+            << "<node id=\"top\" xmlns:xi=\"http://www.w3.org/2001/XInclude\">\n"
+            << "  <node id=\"MOD\" address=\"0x0\">\n"
+            << "    <node id=\"FIRST\" address=\"0x0\" permission=\"r\"/>\n"
+            << "    <xi:include href=\"part.xml\"/>\n"
+            << "    <node id=\"LAST\" address=\"0x100\" permission=\"r\"/>\n"
+            << "  </node>\n"
+            << "</node>\n";
+          auto writePart = [&part](int version) {
+            std::ofstream(part.c_str())
+              << "<node id=\"PART\" address=\"0x10\" description=\"version " << version << "\">\n"
+              << "  <node id=\"REG0\" address=\"0x0\" permission=\"rw\"/>\n"
+              << "  <node id=\"REG1\" address=\"0x1\" permission=\"rw\"/>\n"
+              << "</node>\n";
+          };
+          writePart(0);
+          int res = 0;
+          xhal::utils::XHALXMLParser parser(top);
+          try
+          {
+            parser.setLogLevel(1);
+            parser.setUseCache(false);
+            parser.setStreaming(true);
+            parser.parseXML();
+            const uint32_t nodes = parser.getNodeStore().size();
+            for (int version = 1; version <= 20 && !res; ++version)
+            {
+              writePart(version);
+              if (!parser.reparseChanged())
+              {
+                std::cout << "Changed included file was not reparsed" << std::endl;
+                res = 1;
+                break;
+              }
+              const xhal::utils::NodeStore & store = parser.getNodeStore();
+              std::string order;
+              for (uint32_t i = store.firstChild(store.find("top.MOD")); i != xhal::utils::NodeStore::NO_NODE; i = store.nextSibling(i))
+              {
+                order += std::string(store.token(i)) + " ";
+              }
+              if (order != "FIRST PART LAST ")
+              {
+                std::cout << "Reparsed nodes out of document order: " << order << std::endl;
+                res = 1;
+              }
+              if (store.size() >= 2 * nodes + 3)
+              {
+                std::cout << "Removed nodes not compacted, " << store.size() << " nodes after " << version << " reloads" << std::endl;
+                res = 1;
+              }
+            }
+          } catch (...) {
+            std::cout << "Reloading the included file failed" << std::endl;
+            res = 1;
+          }
+          std::remove(part.c_str());
+          std::remove(top.c_str());
+          rmdir(dir);
+          return res;
+        }
+
+        xhal::utils::XHALXMLParser * m_parser;
+        xhal::utils::XHALXMLParser * m_reference;
+    };
+  }
+}
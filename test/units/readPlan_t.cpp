@@ -0,0 +1,100 @@
+#include "xhal/utils/XHALReadPlan.h"
+#include "xhal/utils/XHALXMLParser.h"
+#include <iostream>
+#include <vector>
+
+namespace xhal {
+  namespace test {
+    class readPlan_t
+    {
+      public:
+        readPlan_t(xhal::utils::XHALXMLParser * reference)
+        {
+          m_reference = reference;
+        }
+        int launch()
+        {
+          // a status table at consecutive addresses is a single block read
+          std::vector<uint32_t> table;
+          for (uint32_t k = 0; k < 64; ++k) table.push_back(0x64000000 + 4 * (63 - k));
+          xhal::utils::ReadPlan block(table);
+          if (block.blocks().size() != 1 || !block.list().empty() || block.wordCount() != 64 || !check(block, table))
+          {
+            std::cout << "Consecutive registers are not read as one block" << std::endl;
+            return 1;
+          }
+          // scattered registers are a single list read, no unrequested word is read by default
+          std::vector<uint32_t> scattered = {0x64000100, 0x64000000, 0x64000108, 0x64000000, 0x64000200};
+          xhal::utils::ReadPlan list(scattered);
+          if (!list.blocks().empty() || list.list().size() != 4 || list.wordCount() != 4 || !check(list, scattered))
+          {
+            std::cout << "Scattered registers are not read as one list" << std::endl;
+            return 1;
+          }
+          // gap filling on request, the registers around the gap are read as a block when it is cheaper
+          xhal::utils::ReadCost cost;
+          cost.maxGap = 8;
+          cost.request = 2.;
+          cost.address = 8.;
+          xhal::utils::ReadPlan filled(scattered, cost);
+          if (filled.blocks().empty() || filled.wordCount() <= 4 || !check(filled, scattered))
+          {
+            std::cout << "Gap between registers is not filled when allowed" << std::endl;
+            return 1;
+          }
+          cost = xhal::utils::ReadCost();
+          // block size limit
+          cost.maxBlock = 16;
+          xhal::utils::ReadPlan limited(table, cost);
+          for (auto const& b: limited.blocks())
+          {
+            if (b.count > 16)
+            {
+              std::cout << "Block read exceeds the size limit" << std::endl;
+              return 1;
+            }
+          }
+          if (!check(limited, table)) return 1;
+
+          // all registers of the table
+          const xhal::utils::NodeStore & store = m_reference->getNodeStore();
+          std::vector<uint32_t> addresses;
+          for (uint32_t i = 0; i < store.size(); ++i)
+          {
+            if (store.permission(i) != xhal::utils::NodePermission::NONE) addresses.push_back(store.realAddress(i));
+          }
+          xhal::utils::ReadPlan plan(addresses);
+          std::cout << "Read plan of " << addresses.size() << " registers: " << plan.blocks().size() << " block reads, "
+                    << plan.list().size() << " listed words, " << plan.wordCount() << " words read" << std::endl;
+          if (!check(plan, addresses)) return 1;
+          return 0;
+        }
+      private:
+        xhal::utils::XHALXMLParser * m_reference;
+
+        static uint32_t value(uint32_t address) {return address ^ 0x5a5a5a5a;}
+
+        /*
+         * Executes the plan on simulated registers and checks that every address finds its own word
+         */
+        bool check(const xhal::utils::ReadPlan & plan, const std::vector<uint32_t> & addresses)
+        {
+          std::vector<uint32_t> words(plan.wordCount(), 0);
+          for (auto const& b: plan.blocks())
+          {
+            for (uint32_t k = 0; k < b.count; ++k) words.at(b.offset + k) = value(b.address + 4 * k);
+          }
+          for (size_t k = 0; k < plan.list().size(); ++k) words.at(plan.listOffset() + k) = value(plan.list()[k]);
+          for (size_t i = 0; i < addresses.size(); ++i)
+          {
+            if (words.at(plan.index(i)) != value(addresses[i]))
+            {
+              std::cout << "Read plan returns a wrong word for address " << std::hex << addresses[i] << std::dec << std::endl;
+              return false;
+            }
+          }
+          return true;
+        }
+    };
+  }
+}
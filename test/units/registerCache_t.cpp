@@ -0,0 +1,62 @@
+#include "xhal/utils/XHALRegisterCache.h"
+#include <iostream>
+#include <thread>
+
+namespace xhal {
+  namespace test {
+    class registerCache_t
+    {
+      public:
+        registerCache_t() {}
+        int launch()
+        {
+          using xhal::utils::NodePermission;
+          xhal::utils::RegisterCache cache;
+          uint32_t value;
+          // read only registers marked in the address table are kept forever, the others never
+          cache.insert("GEM_AMC.GEM_SYSTEM.BOARD_ID", 0x66400008, 0xbeef, NodePermission::READ, true);
+          cache.insert("GEM_AMC.GEM_SYSTEM.CTRL.LINK_RESET", 0x66400010, 0x1, NodePermission::READWRITE, true);
+          cache.insert("GEM_AMC.GEM_SYSTEM.RELEASE", 0x6640000c, 0x3, NodePermission::READ, false);
+          if (!cache.get("GEM_AMC.GEM_SYSTEM.BOARD_ID", value) || value != 0xbeef ||
+              cache.get("GEM_AMC.GEM_SYSTEM.CTRL.LINK_RESET", value) || cache.get("GEM_AMC.GEM_SYSTEM.RELEASE", value))
+          {
+            std::cout << "Register cache policy is not derived from the node attributes" << std::endl;
+            return 1;
+          }
+          // a write to the word invalidates the entry until it is read again
+          cache.invalidate(0x66400004, 2);
+          if (cache.get("GEM_AMC.GEM_SYSTEM.BOARD_ID", value) || !cache.update("GEM_AMC.GEM_SYSTEM.BOARD_ID", 0xcafe) ||
+              !cache.get("GEM_AMC.GEM_SYSTEM.BOARD_ID", value) || value != 0xcafe)
+          {
+            std::cout << "Register cache entry is not invalidated by address" << std::endl;
+            return 1;
+          }
+          cache.invalidate("GEM_AMC.GEM_SYSTEM");
+          if (cache.get("GEM_AMC.GEM_SYSTEM.BOARD_ID", value))
+          {
+            std::cout << "Register cache entry is not invalidated by name" << std::endl;
+            return 1;
+          }
+          // time to live rules override the address table
+          cache.setTTL("GEM_AMC.OH", std::chrono::milliseconds(50));
+          cache.setTTL("GEM_AMC.OH.OH0.FPGA", std::chrono::milliseconds(0));
+          cache.insert("GEM_AMC.OH.OH0.STATUS.EVT_SENT", 0x66800000, 7, NodePermission::READ, false);
+          cache.insert("GEM_AMC.OH.OH0.FPGA.FW_VERSION", 0x66810000, 9, NodePermission::READ, true);
+          if (!cache.get("GEM_AMC.OH.OH0.STATUS.EVT_SENT", value) || cache.get("GEM_AMC.OH.OH0.FPGA.FW_VERSION", value))
+          {
+            std::cout << "Register cache prefix rules are not applied" << std::endl;
+            return 1;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(60));
+          if (cache.get("GEM_AMC.OH.OH0.STATUS.EVT_SENT", value))
+          {
+            std::cout << "Register cache entry did not expire" << std::endl;
+            return 1;
+          }
+          std::cout << "Register cache hits " << cache.hits() << ", misses " << cache.misses() << std::endl;
+          if (cache.hits() != 3 || cache.misses() != 3) return 1;
+          return 0;
+        }
+    };
+  }
+}
@@ -0,0 +1,69 @@
+#include "xhal/utils/XHALTableRegistry.h"
+#include "xhal/utils/XHALXMLParser.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xhal {
+  namespace test {
+    class tableRegistry_t
+    {
+      public:
+        tableRegistry_t(const std::string & address_table_filename, xhal::utils::XHALXMLParser * reference)
+        {
+          m_address_table_filename = address_table_filename;
+          m_reference = reference;
+        }
+        int launch()
+        {
+          // boards initialized in parallel with the same firmware
+          const size_t boards = 12;
+          std::vector<std::shared_ptr<const xhal::utils::XHALXMLParser> > tables(boards);
+          std::vector<std::thread> threads;
+          bool failed = false;
+          for (size_t b = 0; b < boards; ++b)
+          {
+            threads.emplace_back([&, b]() {
+              try {
+                tables[b] = xhal::utils::XHALTableRegistry::instance().acquire(m_address_table_filename, 1);
+              } catch (...) {
+                failed = true;
+              }
+            });
+          }
+          for (auto& t: threads) t.join();
+          if (failed)
+          {
+            std::cout << "Table registry failed to parse " << m_address_table_filename << std::endl;
+            return 1;
+          }
+          for (auto const& table: tables)
+          {
+            if (table != tables[0])
+            {
+              std::cout << "Table registry returned several copies of the table" << std::endl;
+              return 1;
+            }
+          }
+          if (xhal::utils::XHALTableRegistry::instance().size() != 1 ||
+              tables[0]->getNodeStore().size() != m_reference->getNodeStore().size())
+          {
+            std::cout << "Shared table differs from the reference parse" << std::endl;
+            return 1;
+          }
+          tables.clear();
+          if (xhal::utils::XHALTableRegistry::instance().size() != 0)
+          {
+            std::cout << "Table registry kept the table after its last user released it" << std::endl;
+            return 1;
+          }
+          return 0;
+        }
+      private:
+        std::string m_address_table_filename;
+        xhal::utils::XHALXMLParser * m_reference;
+    };
+  }
+}
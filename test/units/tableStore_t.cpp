@@ -0,0 +1,77 @@
+#include "xhal/utils/XHALTableStore.h"
+#include "xhal/utils/XHALXMLParser.h"
+#include <iostream>
+#include <string>
+
+namespace xhal {
+  namespace test {
+    class tableStore_t
+    {
+      public:
+        tableStore_t(const std::string & address_table_filename, xhal::utils::XHALXMLParser * reference)
+        {
+          m_address_table_filename = address_table_filename;
+          m_reference = reference;
+        }
+        int launch()
+        {
+          xhal::utils::XHALTableStore store;
+          uint32_t first, second;
+          try
+          {
+            first = store.loadVersion("first", m_address_table_filename);
+            store.assignBoard("board0", first);
+            second = store.addVersion("second", m_reference->getNodeStore());
+            store.assignBoard("board1", second);
+          } catch (...) {
+            std::cout << "Table store failed to load " << m_address_table_filename << std::endl;
+            return 1;
+          }
+          const xhal::utils::NodeStore & reference = m_reference->getNodeStore();
+          const uint32_t shapes = store.shapeCount();
+          std::cout << "Table store holds " << shapes << " distinct subtree nodes for " << reference.size() << " nodes" << std::endl;
+          // the second version is identical to the first one, it adds no nodes
+          if (store.versionCount() != 2 || shapes > reference.size() || store.version("second").index() != second)
+          {
+            std::cout << "Table store did not deduplicate identical versions" << std::endl;
+            return 1;
+          }
+          for (auto board: {"board0", "board1"})
+          {
+            xhal::utils::TableVersion version = store.forBoard(board);
+            if (!version || version.nodeCount() != reference.size())
+            {
+              std::cout << "Table store version of " << board << " is incomplete" << std::endl;
+              return 1;
+            }
+            for (uint32_t i = 0; i < reference.size(); ++i)
+            {
+              const std::string name = reference.name(i);
+              auto node = version.getNode(name);
+              if (!node)
+              {
+                std::cout << "Table store did not find node " << name << std::endl;
+                return 1;
+              }
+              if (node->address != reference.address(i) || node->real_address != reference.realAddress(i) ||
+                  node->mask != reference.mask(i) || node->size != reference.nodeSize(i) ||
+                  node->level != reference.level(i) || node->description != reference.description(i))
+              {
+                std::cout << "Table store node " << name << " differs from parsed node" << std::endl;
+                return 1;
+              }
+            }
+            if (version.getNode("top.NO_SUCH_NODE"))
+            {
+              std::cout << "Table store found a missing node" << std::endl;
+              return 1;
+            }
+          }
+          return 0;
+        }
+      private:
+        std::string m_address_table_filename;
+        xhal::utils::XHALXMLParser * m_reference;
+    };
+  }
+}
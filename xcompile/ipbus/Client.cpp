@@ -315,14 +315,8 @@ void Client::process_rmwbits_txn(IPBusTxnHdr transaction_header, std::deque<uint
 	uint32_t or_term = request.front(); request.pop_front();
 
 	uint32_t predata;
-	if (memhub_read(memhub, base_addr, 1, &predata) != 0) {
-		// Failed!
-		transaction_header.info_code = IPBusTxnHdr::BUSERR_READ;
-		response.push_back(transaction_header.serialize());
-		return;
-	}
-	uint32_t data = (predata & and_term) | or_term;
-	if (memhub_write(memhub, base_addr, 1, &data) != 0) {
+	// read and write under one lock, no other writer in between
+	if (memhub_rmw(memhub, base_addr, and_term, or_term, &predata) != 0) {
 		// Failed!
 		transaction_header.info_code = IPBusTxnHdr::BUSERR_WRITE;
 		response.push_back(transaction_header.serialize());
@@ -65,6 +65,21 @@ int memhub_write(memsvc_handle_t handle, uint32_t addr, uint32_t words, const ui
     return ret;
 }
 
+int memhub_rmw(memsvc_handle_t handle, uint32_t addr, uint32_t and_mask, uint32_t or_value, uint32_t *prev) {
+    sem_wait(semaphore);
+    busy = true;
+    uint32_t data;
+    int ret = memsvc_read(handle, addr, 1, &data);
+    if (ret == 0) {
+        if (prev != NULL) *prev = data;
+        data = (data & and_mask) | or_value;
+        ret = memsvc_write(handle, addr, 1, &data);
+    }
+    sem_post(semaphore);
+    busy = false;
+    return ret;
+}
+
 void die(int signo) {
     int semval = 0;
     sem_getvalue(semaphore, &semval);
@@ -20,6 +20,10 @@ int memhub_close(memsvc_handle_t *handle);
  */
 int memhub_read(memsvc_handle_t handle, uint32_t addr, uint32_t words, uint32_t *data);
 int memhub_write(memsvc_handle_t handle, uint32_t addr, uint32_t words, const uint32_t *data);
+/* Replaces the word at addr by (word & and_mask) | or_value under a single lock, so that no other memhub user writes
+ * the word in between. The previous word is stored in prev if it is not NULL.
+ */
+int memhub_rmw(memsvc_handle_t handle, uint32_t addr, uint32_t and_mask, uint32_t or_value, uint32_t *prev);
 void die(int signo);
 
 #ifdef __cplusplus
@@ -0,0 +1,151 @@
+/**
+ * @file XHALAsyncClient.h
+ * Asynchronous RPC client, several requests in flight on a pool of connections
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHALASYNCCLIENT_H
+#define XHALASYNCCLIENT_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "xhal/rpc/wiscrpcsvc.h"
+
+namespace xhal {
+  /**
+   * @class AsyncRPCClient
+   * @brief sends RPC requests without waiting for the previous responses
+   *
+   * wisc::RPCSvc::call_method() waits for the response of every request, so at most one request per round trip time
+   * gets through a connection. The client opens depth connections to the RPC service, each served by its own thread
+   * calling wisc::RPCSvc::call_method(), so that up to depth requests are in flight; the callers block beyond.
+   * Every request gets a sequence number. Requests given the same ordering key go through the same connection and
+   * are executed and completed in the order of the calls, e.g. the accesses to one register when the key is its
+   * address. Requests without key go to the least busy connection and may complete in any order.
+   * Results are delivered through futures or callbacks; the callbacks run on the connection threads and must not
+   * block. Only the public wisc::RPCSvc API is used. Thread safe.
+   */
+  class AsyncRPCClient
+  {
+    public:
+      /**
+       * @brief receives the response, or the exception (wisc::RPCSvc::RPCException) if the request failed
+       */
+      typedef std::function<void(uint64_t sequence, const wisc::RPCMsg& response, std::exception_ptr error)> Callback;
+
+      /**
+       * @brief ordering key of the requests that may run on any connection
+       */
+      static const uint64_t ANY_KEY = ~uint64_t(0);
+
+      /**
+       * @param depth number of connections, i.e. maximal number of requests in flight
+       */
+      explicit AsyncRPCClient(size_t depth = 8);
+      ~AsyncRPCClient();
+
+      /**
+       * @brief opens the connections to the RPC service, throws wisc::RPCSvc::ConnectionFailedException on failure
+       * reconnects if a connection was lost
+       */
+      void connect(const std::string& host, uint16_t port = 9812);
+      /**
+       * @brief fails the requests in flight with wisc::RPCSvc::NotConnectedException and closes the connections
+       */
+      void disconnect();
+      /**
+       * @brief loads the remote module on every connection, waits for the requests in flight first
+       */
+      bool loadModule(const std::string& module, const std::string& moduleVersion);
+
+      /**
+       * @brief sends the request, the future holds the response or throws the RPC exception
+       * @param key requests with the same key are executed in order
+       */
+      std::future<wisc::RPCMsg> call(const wisc::RPCMsg& request, uint64_t key = ANY_KEY);
+      /**
+       * @brief sends the request, the callback receives the response
+       * @param key requests with the same key are executed in order
+       * @return sequence number of the request
+       */
+      uint64_t call(const wisc::RPCMsg& request, Callback callback, uint64_t key = ANY_KEY);
+      /**
+       * @brief waits until all requests sent so far are completed, their callbacks included
+       */
+      void flush();
+
+      size_t getDepth() const {return m_depth;}
+      /**
+       * @brief returns index of the connection executing the requests with the key
+       * the key is mixed first, so that aligned keys such as register byte addresses are spread over the connections
+       */
+      size_t getConnection(uint64_t key) const;
+      /**
+       * @brief returns number of requests sent and not completed yet
+       */
+      size_t getInFlight() const;
+
+    private:
+      /**
+       * @brief connection whose blocking call can be interrupted from another thread
+       */
+      class Connection : public wisc::RPCSvc
+      {
+        public:
+          void interrupt();
+      };
+
+      struct Pending
+      {
+        uint64_t sequence;
+        wisc::RPCMsg request;
+        std::promise<wisc::RPCMsg> promise;
+        Callback callback;
+      };
+
+      struct Worker
+      {
+        Connection rpc;
+        std::condition_variable wake;
+        std::deque<Pending> queue;
+        // the request taken off the queue is being executed
+        bool busy = false;
+        std::thread thread;
+      };
+
+      const size_t m_depth;
+      mutable std::mutex m_mutex;
+      // serializes the callers, and keeps them away while the connections are opened, closed or loading modules
+      std::mutex m_callMutex;
+      // signals the completions to the callers
+      std::condition_variable m_changed;
+      std::vector<std::unique_ptr<Worker> > m_workers;
+      size_t m_inFlight;
+      uint64_t m_sequence;
+      bool m_connected;
+      bool m_stop;
+
+      uint64_t send(const wisc::RPCMsg& request, Pending&& pending, uint64_t key);
+      void run(Worker& worker);
+      /**
+       * @brief stops the threads and closes the connections, m_callMutex must be held
+       */
+      void close();
+      /**
+       * @brief completes the queued requests with the error, m_mutex must be held
+       */
+      void failQueued(std::exception_ptr error);
+      static void complete(Pending& pending, const wisc::RPCMsg& response, std::exception_ptr error);
+  };
+}
+#endif
@@ -9,9 +9,18 @@
 #ifndef XHALINTERFACE_H
 #define XHALINTERFACE_H
 
+#include <chrono>
+#include <future>
+#include <memory>
 #include <string>
+#include <vector>
 #include "xhal/rpc/wiscrpcsvc.h"
+#include "xhal/XHALAsyncClient.h"
 #include "xhal/utils/XHALXMLParser.h"
+#include "xhal/utils/XHALLookupBackend.h"
+#include "xhal/utils/XHALReadPlan.h"
+#include "xhal/utils/XHALRegisterCache.h"
+#include "xhal/XHALRegister.h"
 #include "xhal/utils/Exception.h"
 
 #define STANDARD_CATCH \
@@ -50,7 +59,8 @@ namespace xhal {
       /**
        * @brief Default constructor
        * @param board_domain_name domain name of CTP7
-       * @param address_table_filename XML address table file name
+       * @param address_table_filename XML address table file name, or LMDB register database (path ending with .mdb)
+       * built by xhal-atdb
        */
       XHALInterface(const std::string& board_domain_name, const std::string& address_table_filename);
       ~XHALInterface(){m_logger.shutdown();}
@@ -58,7 +68,7 @@ namespace xhal {
       /**
        * @brief Initialize interface and establish RPC service connection with CTP7
        *
-       * Parses XML file and starts the RPCSvc connection
+       * Parses XML file (or opens the register database) and starts the RPCSvc connection
        */
       void init();
       /**
@@ -77,30 +87,211 @@ namespace xhal {
        */
       void setLogLevel(int loglevel);
 
+      /**
+       * @brief enables the client side cache of the values read by readReg(const std::string&), see
+       * xhal::utils::RegisterCache
+       * Without further setting only the read only registers marked sw_cache="true" in the address table are cached.
+       * Disabling the cache drops its content.
+       */
+      void enableCache(bool enable = true);
+      /**
+       * @brief caches the values of the registers under the name prefix for the given time, or never if it is 0
+       */
+      void setCacheTTL(const std::string& prefix, std::chrono::milliseconds ttl) {m_cache.setTTL(prefix, ttl);}
+      /**
+       * @brief drops the cached values of the registers under the name prefix, e.g. after a firmware reload
+       */
+      void invalidate(const std::string& prefix = "") {m_cache.invalidate(prefix);}
+      /**
+       * @brief returns number of register reads answered by the cache
+       */
+      size_t getCacheHits() const {return m_cache.hits();}
+      /**
+       * @brief returns number of reads of cacheable registers sent to the board
+       */
+      size_t getCacheMisses() const {return m_cache.misses();}
+
       /**
        * @brief read FW register by its name
-       * applies reading mask if any
+       * applies reading mask if any, the value may come from the cache, see enableCache()
        */
-      uint32_t readReg(std::string regName);
+      uint32_t readReg(const std::string& regName);
       /**
        * @brief read FW register by its address
        * reg mask is ignored!!
        */
       uint32_t readReg(uint32_t address);
+      /**
+       * @brief sets the number of readRegAsync() and writeRegAsync() requests in flight, see xhal::AsyncRPCClient
+       * one connection to the board per request in flight. Takes effect when the connections are opened, i.e.
+       * before the first asynchronous access.
+       */
+      void setPipelineDepth(size_t depth) {m_pipelineDepth = depth;}
+      /**
+       * @brief read FW register by its name without waiting for the previous requests
+       * the request goes through the connections of a xhal::AsyncRPCClient, opened on first use. The future throws
+       * xhal::utils::Exception if the read fails. A cached value is returned at once, but the values read this
+       * way are not stored in the cache. Not to be called concurrently with the synchronous methods.
+       */
+      std::future<uint32_t> readRegAsync(const std::string& regName);
+      /**
+       * @brief write FW register by its name without waiting for the previous requests, see readRegAsync()
+       * the accesses to the same word are executed in the order of the calls; a masked register is written by a
+       * single remote read-modify-write, the other bits of the word written by requests in flight are preserved.
+       * Until a rmwReg() succeeded on the connection, a masked write waits for the requests in flight and goes
+       * through rmwReg(), which falls back to a read and a write on boards without memory.rmw.
+       */
+      std::future<void> writeRegAsync(const std::string& regName, uint32_t value);
       /**
        * @brief write FW register by its name
-       * applies read/write mask if any
+       * applies read/write mask if any, a masked register is written by a single remote read-modify-write, see rmwReg()
+       */
+      void writeReg(const std::string& regName, uint32_t value);
+      /**
+       * @brief write FW register by its address
+       * the whole word is written
+       */
+      void writeReg(uint32_t address, uint32_t value);
+      /**
+       * @brief replaces the word at the address by (word & andMask) | orValue in a single request
+       * the board reads and writes the word without any other write in between. Boards without the memory.rmw
+       * method get a memory.read followed by a memory.write instead, the first RPC error is remembered for the
+       * connection.
+       * @return previous value of the word
+       */
+      uint32_t rmwReg(uint32_t address, uint32_t andMask, uint32_t orValue);
+      /**
+       * @brief several rmwReg() in a single request, applied in order
+       * one rmwReg() per word if the board does not have the extras.rmwlist method
+       * @param previous filled with the previous values of the words
+       */
+      void rmwRegs(const uint32_t* addresses, const uint32_t* andMasks, const uint32_t* orValues, uint32_t* previous,
+                   uint32_t count);
+      /**
+       * @brief read consecutive FW registers starting at the address
+       */
+      void readBlock(uint32_t address, uint32_t* data, uint32_t count);
+      /**
+       * @brief write consecutive FW registers starting at the address in a single request
+       * the whole words are written
+       */
+      void writeBlock(uint32_t address, const uint32_t* data, uint32_t count);
+      /**
+       * @brief read FW registers at arbitrary addresses in a single request
+       * the whole words are read
+       */
+      void readList(const uint32_t* addresses, uint32_t* data, uint32_t count);
+      /**
+       * @brief executes the block and list reads of the plan
+       * @param words filled with plan.wordCount() words, the word of the i-th planned address is words[plan.index(i)]
        */
-      void writeReg(std::string regName, uint32_t value);
-      //void writeReg(uint32_t address, uint32_t value);
+      void readPlan(const xhal::utils::ReadPlan& plan, uint32_t* words);
+      /**
+       * @brief sets the cost model used to plan the reads of readRegs()
+       * unrequested words are only read to join blocks if ReadCost::maxGap is raised
+       */
+      void setReadCost(const xhal::utils::ReadCost& cost) {m_readCost = cost;}
+      const xhal::utils::ReadCost& getReadCost() const {return m_readCost;}
+      /**
+       * @brief read FW registers by their names with as few requests as possible
+       * the names are resolved first, each 32-bit word is read once even if several masked fields share it,
+       * consecutive words are read by block reads and the others by a single list read, see xhal::utils::ReadPlan
+       * @return register values with their masks applied, in the order of the names
+       */
+      std::vector<uint32_t> readRegs(const std::vector<std::string>& regNames);
+      /**
+       * @brief read FW registers described by descriptors, no name lookup
+       * see readRegs(const std::vector<std::string>&)
+       */
+      std::vector<uint32_t> readRegs(const std::vector<RegisterDesc>& regs);
+      /**
+       * @brief resolves FW register name to its descriptor, to be reused without further lookups
+       * throws xhal::utils::Exception if the register is not found
+       */
+      RegisterDesc getRegister(const std::string& regName);
+      /**
+       * @brief read FW register described by a generated descriptor, no name lookup
+       */
+      uint32_t read(const RegisterDesc& reg) {return reg.extract(readReg(reg.address));}
+      /**
+       * @brief write FW register described by a generated descriptor, no name lookup
+       * other bits of the word are preserved if the register is masked
+       */
+      void write(const RegisterDesc& reg, uint32_t value)
+      {
+        if (reg.mask == 0xFFFFFFFF) writeReg(reg.address, value);
+        else rmwReg(reg.address, ~reg.mask, reg.insert(0, value));
+      }
+      /**
+       * @brief read FW register given as a type, see XHAL_REGISTER()
+       * mask and shift are applied at compile time
+       */
+      template<typename Reg>
+      uint32_t read()
+      {
+        static_assert(Reg::permission & 1, "register is not readable");
+        return Reg::extract(readReg(Reg::address));
+      }
+      /**
+       * @brief write FW register given as a type, see XHAL_REGISTER()
+       */
+      template<typename Reg>
+      void write(uint32_t value)
+      {
+        static_assert(Reg::permission & 2, "register is not writable");
+        if (Reg::mask == 0xFFFFFFFF) writeReg(Reg::address, value);
+        else rmwReg(Reg::address, ~Reg::mask, Reg::insert(0, value));
+      }
+      /**
+       * @brief reads all the registers of a generated register struct in a single block read
+       * @param module generated struct, e.g. regs::GEM_AMC.OH.OH[n]
+       * @param words filled with the block, the register values are then obtained with RegisterDesc::get(words, module.base)
+       */
+      template<typename Module>
+      void readBlock(const Module& module, std::vector<uint32_t>& words)
+      {
+        words.resize(module.words);
+        if (module.words) readBlock(module.base, words.data(), module.words);
+      }
     private:
       std::string m_board_domain_name;
       std::string m_address_table_filename;
-      xhal::utils::XHALXMLParser * m_parser;
-      xhal::utils::Node m_node;
+      std::unique_ptr<xhal::utils::XHALLookupBackend> m_backend;
       log4cplus::Logger m_logger;
+      xhal::utils::ReadCost m_readCost;
+      bool m_cacheEnabled;
+      xhal::utils::RegisterCache m_cache;
       wisc::RPCSvc rpc;
       wisc::RPCMsg req, rsp;
+      size_t m_pipelineDepth;
+      std::unique_ptr<xhal::AsyncRPCClient> m_async;
+
+      /**
+       * @brief whether the board implements an optional RPC method, learnt from the first call on the connection
+       */
+      enum class Support : uint8_t {UNKNOWN, YES, NO};
+      Support m_rmwSupport;
+      Support m_rmwListSupport;
+
+      /**
+       * @brief sends req to an optional method
+       * @return false if the board answered with an RPC error, i.e. it does not have the method
+       */
+      bool callOptional(Support& support);
+      /**
+       * @brief rmwReg() as separate read and write
+       */
+      uint32_t readModifyWrite(uint32_t address, uint32_t andMask, uint32_t orValue);
+
+      /**
+       * @brief returns the asynchronous client, opens its connections and loads the memory module on first use
+       */
+      xhal::AsyncRPCClient& async();
+      /**
+       * @brief looks up register real address and mask by its name without copying the node,
+       * throws xhal::utils::Exception if the register is not found
+       */
+      void findRegister(const std::string& regName, uint32_t& address, uint32_t& mask);
   };
 }
 #endif  // XHALINTERFACE_H
@@ -0,0 +1,94 @@
+/**
+ * @file XHALRegister.h
+ * Compile-time register descriptors, as generated from the address table by xhal-reggen
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+#ifndef XHALREGISTER_H
+#define XHALREGISTER_H
+
+#include <cstdint>
+
+namespace xhal {
+  /**
+   * @brief returns position of the lowest set bit of the mask, 0 for an empty mask
+   */
+  constexpr uint8_t maskShift(uint32_t mask)
+  {
+    return (mask == 0 || (mask & 1)) ? 0 : 1 + maskShift(mask >> 1);
+  }
+
+  /**
+   * @brief returns number of bits set in the mask
+   */
+  constexpr uint8_t maskWidth(uint32_t mask)
+  {
+    return mask == 0 ? 0 : (mask & 1) + maskWidth(mask >> 1);
+  }
+
+  /**
+   * @class RegisterDesc
+   * @brief register attributes, the permission is coded as xhal::utils::NodePermission (bit 0: read, bit 1: write)
+   *
+   * The address is the real (bus) address of the register. Descriptors are literal types, so the value extraction
+   * is folded at compile time for constant registers.
+   */
+  struct RegisterDesc
+  {
+    uint32_t address;
+    uint32_t mask;
+    uint8_t shift;
+    uint8_t width;
+    uint8_t permission;
+
+    constexpr bool isReadable() const {return permission & 1;}
+    constexpr bool isWritable() const {return permission & 2;}
+    /**
+     * @brief returns the register value from the full register word
+     */
+    constexpr uint32_t extract(uint32_t word) const {return (word & mask) >> shift;}
+    /**
+     * @brief returns the full register word with the register value replaced
+     */
+    constexpr uint32_t insert(uint32_t word, uint32_t value) const {return (word & ~mask) | ((value << shift) & mask);}
+    /**
+     * @brief returns the register value from a block of words read from the base address
+     */
+    constexpr uint32_t get(const uint32_t * block, uint32_t base) const {return extract(block[(address - base) >> 2]);}
+  };
+
+  /**
+   * @class Register
+   * @brief register descriptor as a type, to be used with XHALInterface::read<Reg>() and write<Reg>()
+   *
+   * Made from a constant RegisterDesc with the XHAL_REGISTER() macro, e.g.
+   * using BoardId = XHAL_REGISTER(regs::GEM_AMC.GEM_SYSTEM.BOARD_ID);
+   */
+  template<uint32_t Address, uint32_t Mask, uint8_t Permission>
+  struct Register
+  {
+    static constexpr uint32_t address = Address;
+    static constexpr uint32_t mask = Mask;
+    static constexpr uint8_t shift = maskShift(Mask);
+    static constexpr uint8_t width = maskWidth(Mask);
+    static constexpr uint8_t permission = Permission;
+
+    static constexpr RegisterDesc desc() {return RegisterDesc{address, mask, shift, width, permission};}
+    static constexpr uint32_t extract(uint32_t word) {return (word & mask) >> shift;}
+    static constexpr uint32_t insert(uint32_t word, uint32_t value) {return (word & ~mask) | ((value << shift) & mask);}
+  };
+
+  template<uint32_t A, uint32_t M, uint8_t P> constexpr uint32_t Register<A, M, P>::address;
+  template<uint32_t A, uint32_t M, uint8_t P> constexpr uint32_t Register<A, M, P>::mask;
+  template<uint32_t A, uint32_t M, uint8_t P> constexpr uint8_t Register<A, M, P>::shift;
+  template<uint32_t A, uint32_t M, uint8_t P> constexpr uint8_t Register<A, M, P>::width;
+  template<uint32_t A, uint32_t M, uint8_t P> constexpr uint8_t Register<A, M, P>::permission;
+}
+
+/**
+ * @brief converts a constant register descriptor to an xhal::Register type
+ */
+#define XHAL_REGISTER(DESC) ::xhal::Register<(DESC).address, (DESC).mask, (DESC).permission>
+
+#endif  // XHALREGISTER_H
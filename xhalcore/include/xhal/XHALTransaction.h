@@ -0,0 +1,120 @@
+/**
+ * @file XHALTransaction.h
+ * Register writes collected and sent with as few requests as possible
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHALTRANSACTION_H
+#define XHALTRANSACTION_H
+
+#include <map>
+#include <string>
+#include "xhal/XHALInterface.h"
+
+namespace xhal {
+  /**
+   * @class Transaction
+   * @brief collects register writes and sends them on commit()
+   *
+   * Masked fields of the same 32-bit word are merged into one word, the last write of a field wins. On commit() the
+   * runs of consecutive whole words are written by multi-word memory.write requests, and the words with partially
+   * written masks by a single batched read-modify-write, see XHALInterface::rmwRegs(). The whole-word blocks are
+   * written first, in address order, then the partially written words, in address order as well. This is not the
+   * order of the calls: writes that depend on each other go to separate commits.
+   * Not thread safe, the interface must outlive the transaction.
+   */
+  class Transaction
+  {
+    public:
+      /**
+       * @brief requests issued by a commit
+       */
+      struct Stats
+      {
+        /**
+         * @brief number of register writes committed
+         */
+        size_t writes;
+        /**
+         * @brief number of distinct words written
+         */
+        size_t words;
+        /**
+         * @brief read-modify-write requests for the words of the partially written masks
+         */
+        size_t rmwRequests;
+        /**
+         * @brief memory.write requests
+         */
+        size_t writeRequests;
+
+        size_t roundTrips() const {return rmwRequests + writeRequests;}
+      };
+
+      explicit Transaction(XHALInterface& xhal) : m_interface(xhal), m_writes(0) {}
+
+      /**
+       * @brief adds a write of the FW register by its name, the mask is applied
+       * throws xhal::utils::Exception if the register is not found
+       */
+      void write(const std::string& regName, uint32_t value);
+      /**
+       * @brief adds a write of the FW register described by a generated descriptor
+       */
+      void write(const RegisterDesc& reg, uint32_t value);
+      /**
+       * @brief adds a write of the FW register given as a type, see XHAL_REGISTER()
+       */
+      template<typename Reg>
+      void write(uint32_t value)
+      {
+        static_assert(Reg::permission & 2, "register is not writable");
+        add(Reg::address, Reg::mask, Reg::insert(0, value));
+      }
+      /**
+       * @brief adds a write of the whole word at the address
+       */
+      void writeReg(uint32_t address, uint32_t value) {add(address, 0xFFFFFFFF, value);}
+
+      /**
+       * @brief returns number of words to be written
+       */
+      size_t size() const {return m_words.size();}
+      bool empty() const {return m_words.empty();}
+      /**
+       * @brief drops the pending writes
+       */
+      void clear();
+      /**
+       * @brief sends the pending writes
+       *
+       * The pending writes are kept if a request fails, xhal::utils::Exception is thrown then.
+       * @return number of requests issued, also available from lastCommit()
+       */
+      Stats commit();
+      /**
+       * @brief returns the requests issued by the last successful commit
+       */
+      const Stats& lastCommit() const {return m_last;}
+
+    private:
+      /**
+       * @brief bits of a word to be written
+       */
+      struct Word
+      {
+        uint32_t mask;
+        uint32_t value;
+      };
+
+      XHALInterface& m_interface;
+      std::map<uint32_t, Word> m_words;
+      size_t m_writes;
+      Stats m_last = Stats();
+
+      void add(uint32_t address, uint32_t mask, uint32_t value);
+  };
+}
+#endif
@@ -42,9 +42,33 @@ DLLEXPORT uint32_t deinit();                //disconnect
 DLLEXPORT uint32_t init(char * hostname);   //connect
 DLLEXPORT uint32_t getReg(uint32_t address);
 DLLEXPORT uint32_t putReg(uint32_t address, uint32_t value);
+DLLEXPORT uint32_t putRegMasked(uint32_t address, uint32_t mask, uint32_t value);   //writes the value under the mask in one remote read-modify-write, read and write on older boards; returns 0 on success, 1 on failure
+DLLEXPORT uint32_t putRegsMasked(uint32_t* addresses, uint32_t* masks, uint32_t* values, ssize_t size); //batched putRegMasked, returns 0 on success, 1 on failure
 DLLEXPORT uint32_t getList(uint32_t* addresses, uint32_t* result, ssize_t size);
 DLLEXPORT uint32_t getBlock(uint32_t address, uint32_t* result, ssize_t size);
-DLLEXPORT uint32_t update_atdb(char * xmlfilename);
+DLLEXPORT uint32_t getPlanned(uint32_t* addresses, uint32_t* result, ssize_t size); //merges consecutive addresses into block reads, see xhal::utils::ReadPlan
+DLLEXPORT uint32_t update_atdb(char * xmlfilename); //sends changed records only, falls back to reloading the whole table on the board
+/*
+ * Delta update of the board register database from the address table fingerprints, see xhal::utils::NodeFingerprint.
+ * The board side of the two methods below is not implemented yet by the utils module, until then update_atdb()
+ * always falls back to utils.update_address_table.
+ * Keys are the register database keys, i.e. the full node names without the root node ("GEM_AMC.OH.OH0"), the
+ * empty key stands for the root. Hashes are sent as two words, low word first.
+ *
+ * utils.getATDBFingerprint
+ *   request:  at_xml (string), names (string array, nodes whose children are compared)
+ *   response: fingerprint (2 words, table fingerprint, optional), children (string array, name tokens of the
+ *             children of all the requested nodes, concatenated), counts (word array, number of children per
+ *             requested node), record_hashes and subtree_hashes (2 words per child), error (string) on failure
+ * utils.updateATDBDelta
+ *   request:  at_xml (string), fingerprint (2 words, new table fingerprint),
+ *             names, addresses, masks, permissions (string/word/word/string arrays, new or changed register
+ *             records with real addresses and permission names "r", "w" or "rw"),
+ *             fp_names (string array), fp_hashes (4 words per name: record hash then subtree hash), new node
+ *             fingerprints, removed (string array, keys of the subtrees to delete)
+ *   response: error (string) on failure
+ */
+DLLEXPORT uint32_t sync_atdb(char * xmlfilename);
 DLLEXPORT uint32_t getRegInfoDB(char * regName);
 uint32_t count_1bits(uint32_t x); //https://stackoverflow.com/questions/4244274/how-do-i-count-the-number-of-zero-bits-in-an-integer
 
@@ -0,0 +1,210 @@
+/**
+ * @file XHALATDB.h
+ * LMDB register database built from the flattened address table, with fixed-size binary records
+ * which are read in place from the memory map
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALATDB_H
+#define XHAL_UTILS_XHALATDB_H
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <lmdb.h>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @brief register database record, stored as is as the value of the node name key
+     */
+    struct ATDBRecord
+    {
+      static const uint8_t FLAG_MODULE = 0x1;
+      static const uint8_t FLAG_CACHEABLE = 0x2;
+
+      uint32_t address;
+      uint32_t realAddress;
+      uint32_t mask;
+      uint32_t size;
+      int32_t warnMinValue;
+      int32_t errorMinValue;
+      uint8_t permission;
+      uint8_t mode;
+      uint8_t flags;
+      uint8_t level;
+      uint32_t reserved;
+
+      NodePermission getPermission() const {return static_cast<NodePermission>(permission);}
+      NodeMode getMode() const {return static_cast<NodeMode>(mode);}
+      bool isModule() const {return flags & FLAG_MODULE;}
+      bool isCacheable() const {return flags & FLAG_CACHEABLE;}
+    };
+
+    /**
+     * @class XHALATDBEnvironment
+     * @brief LMDB environment of a register database, opened once per process and shared by its users
+     *
+     * LMDB does not allow the same environment to be opened twice in a process, so the builders and readers of a
+     * path acquire the same instance, keyed by the canonical path, and the environment is closed when the last one
+     * releases it. The database handles are opened with the environment and stay valid for its lifetime.
+     * A read-only environment cannot be shared with a builder: xhal::utils::Exception is thrown in that case.
+     */
+    class XHALATDBEnvironment
+    {
+      public:
+        /**
+         * @brief returns the environment of the path, opening it if it is not in use in the process
+         *
+         * Throws xhal::utils::Exception if it cannot be opened or, when opened read-only, has no register database
+         * @param path LMDB environment directory
+         * @param writable opens the environment for writing and creates the databases
+         * @param mapSize minimal map size of a writable environment
+         */
+        static std::shared_ptr<XHALATDBEnvironment> acquire(const std::string& path, bool writable, size_t mapSize = 0);
+        ~XHALATDBEnvironment();
+
+        MDB_env * env() const {return m_env;}
+        MDB_dbi nodes() const {return m_nodes;}
+        MDB_dbi meta() const {return m_meta;}
+        bool writable() const {return m_writable;}
+        /**
+         * @brief grows the map, waits for the read transactions of the process to end
+         */
+        void resize(size_t mapSize);
+        /**
+         * @brief held shared by the read transactions, exclusively while the map is resized
+         */
+        std::shared_timed_mutex& mapMutex() {return m_mapMutex;}
+
+      private:
+        XHALATDBEnvironment(const std::string& path) : m_path(path), m_env(nullptr), m_writable(false) {}
+        XHALATDBEnvironment(const XHALATDBEnvironment&) = delete;
+        XHALATDBEnvironment& operator=(const XHALATDBEnvironment&) = delete;
+
+        std::string m_path;
+        MDB_env * m_env;
+        MDB_dbi m_nodes;
+        MDB_dbi m_meta;
+        bool m_writable;
+        std::shared_timed_mutex m_mapMutex;
+
+        /**
+         * @brief opens the environment and its databases
+         */
+        void open(bool writable, size_t mapSize);
+    };
+
+    /**
+     * @class XHALATDBBuilder
+     * @brief writes the nodes of the flattened address table to an LMDB environment
+     *
+     * The records go to the "xhal_nodes" database, keyed by the full node names without the name of the root node,
+     * e.g. "GEM_AMC.GEM_SYSTEM.BOARD_ID" as looked up on the board. The keys are sorted before insertion and appended
+     * to the B-tree (MDB_APPEND), which fills the pages completely. The previous content is replaced in the same transaction, so readers see
+     * either the old or the new database. The map size is derived from the table size and grown if needed.
+     * The "xhal_meta" database holds the format version, the root node name and the address table content hash.
+     */
+    class XHALATDBBuilder
+    {
+      public:
+        /**
+         * @brief Record format version, must be incremented on any layout change
+         */
+        static const uint32_t VERSION = 1;
+
+        /**
+         * @brief Default constructor
+         * @param path LMDB environment directory, created if needed
+         */
+        XHALATDBBuilder(const std::string& path);
+
+        ~XHALATDBBuilder(){}
+
+        /**
+         * @brief builds the database, throws xhal::utils::Exception on failure
+         * @param hash content hash of the address table, recorded to detect a stale database
+         * @param store flattened node store
+         * @return number of records written
+         */
+        size_t build(uint64_t hash, const NodeStore & store);
+
+      private:
+        std::string m_path;
+
+        /**
+         * @brief writes all the records in a single transaction, returns MDB_MAP_FULL if the map is too small
+         * @param keys sorted keys with the index of their node
+         */
+        int write(XHALATDBEnvironment& env, uint64_t hash, const std::string& root,
+                  const std::vector<std::pair<std::string, uint32_t> >& keys, const NodeStore & store);
+    };
+
+    /**
+     * @class XHALATDBReader
+     * @brief read-only access to the register database
+     *
+     * The environment is opened read-only, or shared with the other readers and builders of the process, see
+     * XHALATDBEnvironment. Lookups are a B-tree search in the memory map and a copy of the fixed-size record, without
+     * any parsing. Each lookup runs in its own short read transaction, renewed from a handle kept reset in between,
+     * so that the reader does not pin old pages and always sees the latest content. Not thread safe: use one reader
+     * per thread.
+     */
+    class XHALATDBReader
+    {
+      public:
+        /**
+         * @brief opens the database, throws xhal::utils::Exception if it is missing or has a different format version
+         * @param path LMDB environment directory
+         */
+        XHALATDBReader(const std::string& path);
+        ~XHALATDBReader();
+
+        /**
+         * @brief looks up the record of the node
+         * @param name node name without the root node name
+         * @param length name length
+         * @param record set to the node record
+         * @return false if the node is not found
+         */
+        bool find(const char * name, size_t length, ATDBRecord& record) const;
+        bool find(const std::string & name, ATDBRecord& record) const {return find(name.data(), name.size(), record);}
+        /**
+         * @brief returns number of records
+         */
+        size_t size() const;
+        /**
+         * @brief returns name of the root node of the address table
+         */
+        const std::string& getRootName() const {return m_root;}
+        /**
+         * @brief returns content hash of the address table the database was built from
+         */
+        uint64_t contentHash() const {return m_hash;}
+        /**
+         * @brief reads the metadata again, e.g. after the database was rebuilt
+         */
+        void refresh();
+
+      private:
+        std::shared_ptr<XHALATDBEnvironment> m_env;
+        // reset between the lookups
+        MDB_txn * m_txn;
+        std::string m_root;
+        uint64_t m_hash;
+
+        /**
+         * @brief reads and checks the metadata
+         */
+        void readMeta();
+    };
+  }
+}
+#endif
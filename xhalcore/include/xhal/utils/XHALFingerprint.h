@@ -0,0 +1,59 @@
+/**
+ * @file XHALFingerprint.h
+ * Hash tree over the flattened address table, used to find the records which differ between two copies of the table
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALFINGERPRINT_H
+#define XHAL_UTILS_XHALFINGERPRINT_H
+
+#include <vector>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @class NodeFingerprint
+     * @brief Merkle style fingerprint of the node store
+     *
+     * Every node gets a record hash, over its name token, address, mask and permission, and a subtree hash,
+     * over its record hash and the subtree hashes of its children in token order. Two tables with equal subtree
+     * hashes for a node have identical subtrees below it, so a comparison only descends where the hashes differ.
+     * The fingerprint of the table combines the subtree hashes of the top level nodes.
+     */
+    class NodeFingerprint
+    {
+      public:
+        /**
+         * @brief computes the hashes of all the nodes, the child index of the store must be built
+         */
+        explicit NodeFingerprint(const NodeStore & store);
+
+        /**
+         * @brief returns fingerprint of the whole table
+         */
+        uint64_t root() const {return m_root;}
+        /**
+         * @brief returns hash of the node record
+         */
+        uint64_t record(uint32_t i) const {return m_record[i];}
+        /**
+         * @brief returns hash of the node subtree, including the node record
+         */
+        uint64_t subtree(uint32_t i) const {return m_subtree[i];}
+        /**
+         * @brief hashes one node record
+         */
+        static uint64_t recordHash(const char * token, uint32_t address, uint32_t mask, NodePermission permission);
+
+      private:
+        std::vector<uint64_t> m_record;
+        std::vector<uint64_t> m_subtree;
+        uint64_t m_root;
+    };
+  }
+}
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file XHALHash.h
+ * Lightweight non-cryptographic hashing helpers used to fingerprint address tables
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_HASH_H
+#define XHAL_UTILS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @brief FNV-1a 64 bit offset basis, i.e. the hash of an empty buffer
+     */
+    const uint64_t FNV1A64_INIT = 0xcbf29ce484222325ULL;
+
+    /**
+     * @brief updates FNV-1a 64 bit hash with the content of the buffer
+     * @param data pointer to the buffer
+     * @param size buffer size in bytes
+     * @param hash hash value to continue from
+     */
+    inline uint64_t fnv1a64(const void * data, size_t size, uint64_t hash = FNV1A64_INIT)
+    {
+      const unsigned char * p = static_cast<const unsigned char *>(data);
+      for (size_t i = 0; i < size; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    /**
+     * @brief updates FNV-1a 64 bit hash with the content of the string
+     */
+    inline uint64_t fnv1a64(const std::string & s, uint64_t hash = FNV1A64_INIT)
+    {
+      return fnv1a64(s.data(), s.size(), hash);
+    }
+
+    /**
+     * @brief fast 64 bit hash of a buffer processing 8 bytes at a time (MurmurHash64A)
+     *
+     * Used for in-memory hash indices, where the byte-wise FNV-1a would dominate the lookup time
+     */
+    inline uint64_t hash64(const void * data, size_t size, uint64_t seed = 0x9e3779b97f4a7c15ULL)
+    {
+      const uint64_t m = 0xc6a4a7935bd1e995ULL;
+      const int r = 47;
+      uint64_t h = seed ^ (size * m);
+      const unsigned char * p = static_cast<const unsigned char *>(data);
+      const unsigned char * end = p + (size & ~(size_t)7);
+      for (; p != end; p += 8) {
+        uint64_t k;
+        std::memcpy(&k, p, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+      }
+      switch (size & 7) {
+        case 7: h ^= uint64_t(p[6]) << 48; // fall through
+        case 6: h ^= uint64_t(p[5]) << 40; // fall through
+        case 5: h ^= uint64_t(p[4]) << 32; // fall through
+        case 4: h ^= uint64_t(p[3]) << 24; // fall through
+        case 3: h ^= uint64_t(p[2]) << 16; // fall through
+        case 2: h ^= uint64_t(p[1]) << 8;  // fall through
+        case 1: h ^= uint64_t(p[0]);
+                h *= m;
+      }
+      h ^= h >> r;
+      h *= m;
+      h ^= h >> r;
+      return h;
+    }
+  }
+}
+#endif
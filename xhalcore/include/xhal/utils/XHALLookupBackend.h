@@ -0,0 +1,118 @@
+/**
+ * @file XHALLookupBackend.h
+ * Register name lookup backends: the XML address table parsed in memory or the LMDB register database
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALLOOKUPBACKEND_H
+#define XHAL_UTILS_XHALLOOKUPBACKEND_H
+
+#include <memory>
+#include <string>
+#include <experimental/optional>
+
+#include "xhal/utils/XHALXMLNode.h"
+
+namespace xhal {
+  namespace utils {
+    class XHALXMLParser;
+    class XHALATDBReader;
+
+    /**
+     * @class XHALLookupBackend
+     * @brief resolves register names to their address table attributes
+     */
+    class XHALLookupBackend
+    {
+      public:
+        virtual ~XHALLookupBackend(){}
+
+        /**
+         * @brief creates the backend matching the address table path: XHALATDBBackend for an LMDB environment
+         * (path ending with ".mdb"), XHALXMLBackend otherwise
+         */
+        static std::unique_ptr<XHALLookupBackend> create(const std::string& addressTable);
+
+        /**
+         * @brief parses or opens the address table, throws xhal::utils::Exception on failure
+         */
+        virtual void load() = 0;
+        /**
+         * @brief sets amount of logging/debugging information to display, see XHALXMLParser::setLogLevel()
+         */
+        virtual void setLogLevel(int loglevel) = 0;
+        /**
+         * @brief looks up register real address and mask by its full name, returns false if not found
+         */
+        virtual bool findRegister(const std::string& name, uint32_t& address, uint32_t& mask) = 0;
+        /**
+         * @brief returns node object by its full name or nothing if name is not found
+         */
+        virtual std::experimental::optional<Node> getNode(const std::string& name) = 0;
+    };
+
+    /**
+     * @class XHALXMLBackend
+     * @brief parses the XML address table (or its cache image) into memory
+     *
+     * The parsed table comes from XHALTableRegistry, so all the backends of the process using the same address table
+     * share a single read-only copy and can be loaded from several threads.
+     */
+    class XHALXMLBackend : public XHALLookupBackend
+    {
+      public:
+        XHALXMLBackend(const std::string& xmlFile);
+        ~XHALXMLBackend();
+
+        void load();
+        /**
+         * @brief only applies to the parse done by load(), the table may already be parsed and is shared
+         */
+        void setLogLevel(int loglevel) {m_loglevel = loglevel;}
+        bool findRegister(const std::string& name, uint32_t& address, uint32_t& mask);
+        std::experimental::optional<Node> getNode(const std::string& name);
+        /**
+         * @brief returns the shared parsed table, null before load()
+         */
+        std::shared_ptr<const XHALXMLParser> getTable() const {return m_table;}
+
+      private:
+        std::string m_xmlFile;
+        int m_loglevel;
+        std::shared_ptr<const XHALXMLParser> m_table;
+    };
+
+    /**
+     * @class XHALATDBBackend
+     * @brief looks the names up in the LMDB register database built by xhal-atdb
+     *
+     * The database is memory-mapped read-only, so there is no parsing and the pages are shared through
+     * the page cache by all the processes of the host. Names may include the root node name, like with the
+     * XML backend. Descriptions are not stored in the database.
+     */
+    class XHALATDBBackend : public XHALLookupBackend
+    {
+      public:
+        XHALATDBBackend(const std::string& path);
+        ~XHALATDBBackend();
+
+        void load();
+        void setLogLevel(int loglevel) {}
+        bool findRegister(const std::string& name, uint32_t& address, uint32_t& mask);
+        std::experimental::optional<Node> getNode(const std::string& name);
+
+      private:
+        std::string m_path;
+        std::string m_prefix;
+        std::unique_ptr<XHALATDBReader> m_reader;
+
+        /**
+         * @brief returns the database key of the node name, i.e. without the root node name
+         */
+        std::string key(const std::string& name) const;
+    };
+  }
+}
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file XHALNodePattern.h
+ * Compiled node name patterns for hierarchical register queries
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALNODEPATTERN_H
+#define XHAL_UTILS_XHALNODEPATTERN_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @class NodePattern
+     * @brief dotted node name pattern, each component matched against one level of the node tree
+     *
+     * Component syntax:
+     * - literal characters match themselves
+     * - '*' matches any (possibly empty) sequence of characters, '?' matches a single character
+     * - "[lo-hi]" matches a decimal index in the inclusive range, "[a,b,lo-hi]" a list of indices and ranges
+     * - a "**" component matches any number (possibly zero) of levels
+     *
+     * The pattern is not anchored at the root: "GEM_AMC.OH.OH3.FPGA" matches "top.GEM_AMC.OH.OH3.FPGA" and
+     * "*.FW_VERSION" all FW_VERSION nodes below the root. A trailing '.' selects all descendants of the matched
+     * nodes, e.g. "GEM_AMC.OH.OH3." is everything below OH3.
+     */
+    class NodePattern
+    {
+      public:
+        /**
+         * @brief compiles the pattern, throws xhal::utils::Exception if it is malformed
+         */
+        explicit NodePattern(const std::string & pattern);
+
+        /**
+         * @brief returns number of components
+         */
+        size_t size() const {return m_components.size();}
+        /**
+         * @brief returns true if the component is "**"
+         */
+        bool isAnyDepth(size_t c) const {return m_components[c].anyDepth;}
+        /**
+         * @brief returns literal characters every token matching the component starts with
+         */
+        const std::string & prefix(size_t c) const {return m_components[c].prefix;}
+        /**
+         * @brief returns true if the matched nodes are replaced by their descendants (trailing '.')
+         */
+        bool descendants() const {return m_descendants;}
+        /**
+         * @brief checks whether the name token matches the component
+         */
+        bool matches(size_t c, const char * token, size_t length) const;
+
+      private:
+        struct Segment
+        {
+          enum Type {LITERAL, ANY, ONE, INDEX} type;
+          std::string literal;
+          std::vector<std::pair<uint32_t, uint32_t> > ranges;
+        };
+        struct Component
+        {
+          std::vector<Segment> segments;
+          std::string prefix;
+          bool anyDepth;
+        };
+
+        std::vector<Component> m_components;
+        bool m_descendants;
+
+        static bool match(const Segment * segment, const Segment * end, const char * token, size_t length);
+        static Component compile(const std::string & pattern, size_t begin, size_t end);
+    };
+  }
+}
+#endif
@@ -0,0 +1,781 @@
+/**
+ * @file XHALNodeStore.h
+ * Compact flat storage of the parsed address table: structure of arrays with interned name tokens
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALNODESTORE_H
+#define XHAL_UTILS_XHALNODESTORE_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xhal/utils/XHALXMLNode.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @brief Register access permission, coded from the address table "permission" attribute
+     */
+    enum class NodePermission : uint8_t
+    {
+      NONE      = 0,
+      READ      = 1,
+      WRITE     = 2,
+      READWRITE = 3
+    };
+
+    /**
+     * @brief Register access mode, coded from the address table "mode" attribute
+     */
+    enum class NodeMode : uint8_t
+    {
+      SINGLE          = 0,
+      BLOCK           = 1,
+      FIFO            = 2,
+      INCREMENTAL     = 3,
+      NON_INCREMENTAL = 4
+    };
+
+    /**
+     * @brief converts permission attribute value to its code, unknown values are mapped to NONE
+     */
+    NodePermission parsePermission(const char * s);
+    /**
+     * @brief returns permission attribute value as written in the address table
+     */
+    const char * permissionName(NodePermission permission);
+    /**
+     * @brief converts mode attribute value to its code, unknown values are mapped to SINGLE
+     */
+    NodeMode parseMode(const char * s);
+    /**
+     * @brief returns mode attribute value as written in the address table
+     */
+    const char * modeName(NodeMode mode);
+
+    /**
+     * @class Column
+     * @brief contiguous array which either owns its elements or refers to an external (e.g. memory mapped) buffer
+     *
+     * Only owned columns can be modified.
+     */
+    template<typename T>
+    class Column
+    {
+      public:
+        Column() : m_data(nullptr), m_size(0) {}
+        Column(const Column& other) : m_owned(other.m_owned), m_data(other.m_data), m_size(other.m_size) {relink(other);}
+        Column(Column&& other) : m_owned(std::move(other.m_owned)), m_data(other.m_data), m_size(other.m_size) {other.attach(nullptr, 0);}
+        Column& operator=(Column&& other)
+        {
+          m_owned = std::move(other.m_owned);
+          m_data = other.m_data;
+          m_size = other.m_size;
+          other.attach(nullptr, 0);
+          return *this;
+        }
+        Column& operator=(const Column& other)
+        {
+          m_owned = other.m_owned;
+          m_data = other.m_data;
+          m_size = other.m_size;
+          relink(other);
+          return *this;
+        }
+
+        const T& operator[](size_t i) const {return m_data[i];}
+        const T * data() const {return m_data;}
+        size_t size() const {return m_size;}
+        bool empty() const {return m_size == 0;}
+        bool owned() const {return m_data == nullptr || m_data == m_owned.data();}
+
+        void push_back(const T& value)
+        {
+          m_owned.push_back(value);
+          relink();
+        }
+        void resize(size_t n, const T& value = T())
+        {
+          m_owned.resize(n, value);
+          relink();
+        }
+        void reserve(size_t n) {m_owned.reserve(n); relink();}
+        void shrink_to_fit()
+        {
+          if (!owned()) return;
+          m_owned.shrink_to_fit();
+          relink();
+        }
+        void clear()
+        {
+          std::vector<T>().swap(m_owned);
+          relink();
+        }
+        /**
+         * @brief returns mutable element, only valid for owned columns
+         */
+        T& at(size_t i) {return m_owned[i];}
+        /**
+         * @brief refers the column to an external buffer, releasing owned elements
+         */
+        void attach(const T * data, size_t size)
+        {
+          std::vector<T>().swap(m_owned);
+          m_data = data;
+          m_size = size;
+        }
+        /**
+         * @brief copies external buffer content into owned storage
+         */
+        void detach()
+        {
+          if (owned()) return;
+          m_owned.assign(m_data, m_data + m_size);
+          relink();
+        }
+        /**
+         * @brief returns number of heap bytes owned by the column
+         */
+        size_t memoryFootprint() const {return m_owned.capacity() * sizeof(T);}
+
+      private:
+        std::vector<T> m_owned;
+        const T * m_data;
+        size_t m_size;
+
+        void relink()
+        {
+          m_data = m_owned.data();
+          m_size = m_owned.size();
+        }
+        void relink(const Column& other)
+        {
+          if (other.owned()) relink();
+        }
+    };
+
+    /**
+     * @class StringPool
+     * @brief stores every distinct string once, strings are referred to by their id
+     */
+    class StringPool
+    {
+      public:
+        StringPool() {}
+
+        /**
+         * @brief returns id of the string, adding it to the pool if needed
+         */
+        uint32_t intern(const char * s, size_t length);
+        uint32_t intern(const std::string & s) {return intern(s.data(), s.size());}
+        /**
+         * @brief same as intern(s, length), with the hash64() of the string computed by the caller
+         */
+        uint32_t intern(const char * s, size_t length, uint64_t hash);
+        /**
+         * @brief returns NUL terminated string by its id
+         */
+        const char * get(uint32_t id) const {return m_blob.data() + m_offsets[id];}
+        /**
+         * @brief returns length of the string by its id
+         */
+        size_t length(uint32_t id) const {return m_offsets[id+1] - m_offsets[id] - 1;}
+        /**
+         * @brief returns number of strings in the pool
+         */
+        uint32_t size() const {return m_offsets.empty() ? 0 : m_offsets.size() - 1;}
+        size_t memoryFootprint() const {return m_blob.memoryFootprint() + m_offsets.memoryFootprint() + m_slots.memoryFootprint();}
+
+      private:
+        friend class NodeStore;
+        Column<char> m_blob;
+        Column<uint32_t> m_offsets;
+        Column<uint32_t> m_slots;
+
+        void rehash(size_t capacity);
+    };
+
+    class AddressMatches;
+    class NodeFragment;
+    class NodePattern;
+    class NodeRef;
+    class NodeIterator;
+
+    /**
+     * @class NodeRange
+     * @brief contiguous range of node indices, valid as long as the store is not modified
+     */
+    class NodeRange
+    {
+      public:
+        NodeRange(const uint32_t * first, const uint32_t * last) : m_first(first), m_last(last) {}
+        const uint32_t * begin() const {return m_first;}
+        const uint32_t * end() const {return m_last;}
+        size_t size() const {return m_last - m_first;}
+        bool empty() const {return m_first == m_last;}
+      private:
+        const uint32_t * m_first;
+        const uint32_t * m_last;
+    };
+
+    /**
+     * @class NodeStore
+     * @brief flattened address table stored as a structure of arrays
+     *
+     * Nodes are referred to by their index. Node names are not stored as strings: each node keeps the interned
+     * token of its last name component and the index of its parent, so the full name is reconstructed on demand.
+     * Name lookups go through an open addressing hash index of the full names.
+     * Descriptions live in a separate pool which is not touched unless requested.
+     */
+    class NodeStore
+    {
+      public:
+        /**
+         * @brief Index value meaning "no node"
+         */
+        static const uint32_t NO_NODE = 0xFFFFFFFF;
+        /**
+         * @brief Description id meaning "no description"
+         */
+        static const uint32_t NO_DESCRIPTION = 0xFFFFFFFF;
+
+        /**
+         * @brief attributes of a single node, used when adding nodes to the store
+         */
+        struct Attributes
+        {
+          Attributes():
+            address(0), real_address(0), size(1), mask(0xFFFFFFFF),
+            permission(NodePermission::NONE), mode(NodeMode::SINGLE), isModule(false), isCacheable(false),
+            warn_min_value(-1), error_min_value(-1) {}
+          uint32_t address;
+          uint32_t real_address;
+          uint32_t size;
+          uint32_t mask;
+          NodePermission permission;
+          NodeMode mode;
+          bool isModule;
+          bool isCacheable;
+          int32_t warn_min_value;
+          int32_t error_min_value;
+        };
+
+        NodeStore();
+        ~NodeStore(){}
+
+        /**
+         * @brief removes all nodes
+         */
+        void clear();
+        /**
+         * @brief pre-allocates space for n nodes
+         */
+        void reserve(size_t n);
+        /**
+         * @brief releases unused capacity, to be called once the store is filled
+         */
+        void shrink();
+        /**
+         * @brief drops the descriptions, the child index and the tree index, keeping what name and address lookups need
+         *
+         * Used to make the smallest image for the embedded targets, the name index is also shrunk to the smallest
+         * size keeping it at most half full.
+         * The hierarchical queries no longer find anything until buildChildIndex() and buildTreeIndex() are called again.
+         */
+        void compact();
+        /**
+         * @brief appends a node to the store
+         * @param parent parent node index or NO_NODE for the root
+         * @param token last component of the node name
+         * @param tokenLength token length
+         * @param attributes node attributes
+         * @param description node description, may be empty
+         * @return new node index or, if a node with the same full name already exists, its index
+         */
+        uint32_t addNode(uint32_t parent, const char * token, size_t tokenLength, const Attributes & attributes, const std::string & description);
+        /**
+         * @brief appends all nodes of the fragment, in order, as if added one by one with addNode()
+         * @param fragment nodes prepared outside of the store, its prefix must be the full name of parent
+         * @param parent node the fragment top level nodes are attached to, NO_NODE for the root
+         */
+        void append(const NodeFragment & fragment, uint32_t parent);
+        /**
+         * @brief removes the nodes with indices in [first, end), the indices of the other nodes are unchanged
+         *
+         * The removed nodes keep their slots but are no longer found, indexed nor iterated.
+         * Invalidates the address, child and tree indices.
+         */
+        void remove(uint32_t first, uint32_t end);
+        /**
+         * @brief returns number of removed nodes still holding their slots
+         */
+        uint32_t removedCount() const;
+        /**
+         * @brief renumbers the nodes in document order, dropping the removed ones and the strings only they used
+         *
+         * All the node indices change, the indices must be built again.
+         * @param remap filled with the new index of every old node, NO_NODE for the removed ones
+         */
+        void pack(std::vector<uint32_t> & remap);
+        /**
+         * @brief returns position of the node in the document order of its siblings, its index unless set with setPosition()
+         */
+        uint32_t position(uint32_t i) const {return m_position.empty() ? i : m_position[i];}
+        /**
+         * @brief places the node among its siblings as if it had the index position, before the node of that index
+         *
+         * Puts the nodes appended for a reparsed part of the document back in place. Invalidates the tree index.
+         */
+        void setPosition(uint32_t i, uint32_t position);
+
+        /**
+         * @brief returns number of nodes
+         */
+        uint32_t size() const {return m_parent.size();}
+        /**
+         * @brief returns handle to the node, see NodeRef
+         */
+        NodeRef ref(uint32_t i) const;
+        /**
+         * @brief iteration over handles to all nodes, in index order
+         */
+        NodeIterator begin() const;
+        NodeIterator end() const;
+        /**
+         * @brief returns index of the node with given full name or NO_NODE
+         */
+        uint32_t find(const char * name, size_t length) const;
+        uint32_t find(const char * name) const {return find(name, std::strlen(name));}
+        uint32_t find(const std::string & name) const {return find(name.data(), name.size());}
+
+        uint32_t address(uint32_t i) const {return m_address[i];}
+        uint32_t realAddress(uint32_t i) const {return m_realAddress[i];}
+        uint32_t mask(uint32_t i) const {return m_mask[i];}
+        uint32_t nodeSize(uint32_t i) const {return m_size[i];}
+        int level(uint32_t i) const {return m_level[i];}
+        NodePermission permission(uint32_t i) const {return static_cast<NodePermission>(m_permission[i]);}
+        NodeMode mode(uint32_t i) const {return static_cast<NodeMode>(m_mode[i]);}
+        bool isModule(uint32_t i) const {return m_flags[i] & FLAG_MODULE;}
+        bool isCacheable(uint32_t i) const {return m_flags[i] & FLAG_CACHEABLE;}
+        bool isRemoved(uint32_t i) const {return m_flags[i] & FLAG_REMOVED;}
+        int warnMinValue(uint32_t i) const {return m_warnMin[i];}
+        int errorMinValue(uint32_t i) const {return m_errorMin[i];}
+        uint32_t parent(uint32_t i) const {return m_parent[i];}
+        /**
+         * @brief returns last component of the node name
+         */
+        const char * token(uint32_t i) const {return m_tokens.get(m_token[i]);}
+        /**
+         * @brief returns full hierarchical node name
+         */
+        std::string name(uint32_t i) const;
+        /**
+         * @brief appends full hierarchical node name to the string
+         */
+        void appendName(uint32_t i, std::string & out) const;
+        /**
+         * @brief returns node description, empty string if there is none
+         */
+        const char * description(uint32_t i) const {return m_description[i] == NO_DESCRIPTION ? "" : m_descriptions.get(m_description[i]);}
+        /**
+         * @brief materializes node as a standalone Node object
+         */
+        Node toNode(uint32_t i) const;
+        /**
+         * @brief fills existing Node object with the node attributes
+         * @param i node index
+         * @param node object to fill
+         * @param name full node name if already known by the caller (e.g. after find()), avoids rebuilding it
+         */
+        void toNode(uint32_t i, Node & node, const char * name = nullptr) const;
+
+        /**
+         * @brief returns number of 32-bit words covered by the node: size for block (incremental) nodes, 1 otherwise
+         */
+        uint32_t span(uint32_t i) const
+        {
+          return (mode(i) == NodeMode::BLOCK || mode(i) == NodeMode::INCREMENTAL) && m_size[i] > 1 ? m_size[i] : 1;
+        }
+        /**
+         * @brief (re)builds the sorted interval indices used for reverse address lookups
+         *
+         * Only registers (nodes with a permission) are indexed, sorted by their start address. The sorted order is
+         * the in-order walk of an implicit balanced search tree, each position keeps the highest address covered
+         * in its subtree so that lookups skip the subtrees ending below the address. Must be called once the store
+         * is filled, adding nodes afterwards invalidates the indices.
+         */
+        void buildAddressIndex();
+        /**
+         * @brief returns all registers covering the word address, in address then document order
+         *
+         * Masked fields sharing the same 32-bit word are all returned. O(log N) per match, whatever the block
+         * sizes, does not allocate.
+         */
+        AddressMatches findByAddress(uint32_t address) const;
+        /**
+         * @brief returns all registers covering the real (bus) address, see findByAddress()
+         */
+        AddressMatches findByRealAddress(uint32_t realAddress) const;
+        /**
+         * @brief (re)builds the index of the node children sorted by token, used by the hierarchical queries
+         *
+         * The node tree with sorted edges is a trie of the name components, queries descend it and binary search
+         * the literal token prefixes. Adding nodes afterwards invalidates the index.
+         */
+        void buildChildIndex();
+        /**
+         * @brief (re)builds the first child / next sibling links, in document order, and the subtree address ranges
+         *
+         * Siblings are linked in index order, except for the nodes moved with setPosition().
+         * Adding nodes afterwards invalidates the links.
+         */
+        void buildTreeIndex();
+        /**
+         * @brief builds all indices, see buildAddressIndex(), buildChildIndex() and buildTreeIndex()
+         */
+        void buildIndices() {buildAddressIndex(); buildChildIndex(); buildTreeIndex();}
+        /**
+         * @brief returns first child of the node in document order, the first root node for NO_NODE,
+         * NO_NODE if there is none or the tree index is not built
+         */
+        uint32_t firstChild(uint32_t i) const
+        {
+          if (m_firstChild.empty()) return NO_NODE;
+          return i == NO_NODE ? 0 : m_firstChild[i];
+        }
+        /**
+         * @brief returns next node with the same parent in document order or NO_NODE
+         */
+        uint32_t nextSibling(uint32_t i) const {return m_nextSibling.empty() ? NO_NODE : m_nextSibling[i];}
+        /**
+         * @brief returns lowest word address covered by the registers of the subtree (including the node itself),
+         * 0xFFFFFFFF if the subtree has no register
+         */
+        uint32_t subtreeMinAddress(uint32_t i) const {return m_subtreeMin.empty() ? 0xFFFFFFFF : m_subtreeMin[i];}
+        /**
+         * @brief returns highest word address covered by the registers of the subtree, 0 if the subtree has no register
+         */
+        uint32_t subtreeMaxAddress(uint32_t i) const {return m_subtreeMax.empty() ? 0 : m_subtreeMax[i];}
+        /**
+         * @brief returns children of the node sorted by token, the root nodes for NO_NODE
+         *
+         * The range is empty if the child index is not built.
+         */
+        NodeRange children(uint32_t i) const;
+        /**
+         * @brief appends indices of all descendants of the node, using the child index
+         */
+        void appendDescendants(uint32_t i, std::vector<uint32_t> & out) const;
+        /**
+         * @brief returns the nodes matching the pattern, in address then document order, using the child index
+         */
+        std::vector<uint32_t> findNodes(const NodePattern & pattern) const;
+
+        /**
+         * @brief returns number of heap bytes used by the store (memory mapped images are not included)
+         */
+        size_t memoryFootprint() const;
+
+        /**
+         * @brief appends binary image of the store to the buffer
+         *
+         * The image is position independent and aligned to 8 bytes, it can be used in place with attach()
+         */
+        void serialize(std::string & out) const;
+        /**
+         * @brief makes the store refer to the binary image, without copying it
+         * @param data image start, must be 8 bytes aligned
+         * @param size image size
+         * @param keepAlive optional handle keeping the image memory valid for the store lifetime
+         * @return false if the image is malformed, in which case the store is left empty. Besides the column sizes,
+         * the node, token and description indices are checked to be within their columns, the parents to precede
+         * their children and the hash tables to be at most half full, so that a corrupted image cannot make
+         * the lookups read out of bounds or loop.
+         */
+        bool attach(const char * data, size_t size, std::shared_ptr<const void> keepAlive = nullptr);
+        /**
+         * @brief copies attached image content to owned memory, making the store modifiable
+         */
+        void detach();
+
+      private:
+        static const uint8_t FLAG_MODULE = 0x1;
+        static const uint8_t FLAG_REMOVED = 0x2;
+        static const uint8_t FLAG_CACHEABLE = 0x4;
+
+        Column<uint32_t> m_address;
+        Column<uint32_t> m_realAddress;
+        Column<uint32_t> m_mask;
+        Column<uint32_t> m_size;
+        Column<int32_t> m_warnMin;
+        Column<int32_t> m_errorMin;
+        Column<uint32_t> m_parent;
+        Column<uint32_t> m_token;
+        Column<uint32_t> m_description;
+        Column<uint8_t> m_level;
+        Column<uint8_t> m_permission;
+        Column<uint8_t> m_mode;
+        Column<uint8_t> m_flags;
+        // empty until setPosition() is called
+        Column<uint32_t> m_position;
+        Column<uint64_t> m_slots;
+        Column<uint32_t> m_byAddress;
+        Column<uint32_t> m_byRealAddress;
+        Column<uint32_t> m_byAddressEnd;
+        Column<uint32_t> m_byRealAddressEnd;
+        Column<uint32_t> m_childOffsets;
+        Column<uint32_t> m_children;
+        Column<uint32_t> m_firstChild;
+        Column<uint32_t> m_nextSibling;
+        Column<uint32_t> m_subtreeMin;
+        Column<uint32_t> m_subtreeMax;
+        StringPool m_tokens;
+        StringPool m_descriptions;
+        std::shared_ptr<const void> m_keepAlive;
+
+        std::string m_scratch;
+
+        /**
+         * @brief adds node with precomputed hashes of the token, of the full name and of the description,
+         * the store must be detached
+         */
+        uint32_t insertNode(uint32_t parent, const char * token, size_t tokenLength, uint64_t tokenHash, uint64_t nameHash,
+                            const Attributes & attributes, const char * description, size_t descriptionLength, uint64_t descriptionHash);
+        /**
+         * @brief checks whether the full name of the node equals to the string
+         */
+        bool nameEquals(uint32_t i, const char * name, size_t length) const;
+        /**
+         * @brief inserts node into the name index
+         */
+        void indexName(uint32_t i, uint64_t hash);
+        void rehash(size_t capacity);
+        /**
+         * @brief adds the nodes below i matching the pattern from component c on
+         */
+        void collectMatches(uint32_t i, size_t c, const NodePattern & pattern, std::vector<uint32_t> & out) const;
+        /**
+         * @brief calls f(column) for each column of the store in image order
+         */
+        template<typename Self, typename F> static void forEachColumn(Self & self, F f);
+        /**
+         * @brief checks the offsets and the hash table of an attached string pool
+         */
+        static bool validPool(const StringPool & pool);
+        /**
+         * @brief checks that the node indices of the attached columns are within the store
+         */
+        bool validIndices() const;
+        /**
+         * @brief returns highest (real) address covered by the register
+         */
+        uint32_t lastAddress(uint32_t i, bool real) const;
+        /**
+         * @brief returns true if sibling a comes before sibling b in document order
+         */
+        bool siblingBefore(uint32_t a, uint32_t b) const;
+        friend class AddressMatches;
+    };
+
+    /**
+     * @class NodeRef
+     * @brief handle to a node of the store: the attributes are read from the store columns, nothing is copied
+     *
+     * Valid as long as the store is not modified. A default constructed handle refers to no node and converts to false.
+     */
+    class NodeRef
+    {
+      public:
+        NodeRef() : m_store(nullptr), m_index(NodeStore::NO_NODE) {}
+        NodeRef(const NodeStore * store, uint32_t i) : m_store(store), m_index(i) {}
+
+        explicit operator bool() const {return m_index != NodeStore::NO_NODE;}
+        bool operator==(const NodeRef & other) const {return m_store == other.m_store && m_index == other.m_index;}
+        bool operator!=(const NodeRef & other) const {return !(*this == other);}
+
+        uint32_t index() const {return m_index;}
+        const NodeStore & store() const {return *m_store;}
+
+        std::string name() const {return m_store->name(m_index);}
+        void appendName(std::string & out) const {m_store->appendName(m_index, out);}
+        const char * token() const {return m_store->token(m_index);}
+        const char * description() const {return m_store->description(m_index);}
+        uint32_t address() const {return m_store->address(m_index);}
+        uint32_t realAddress() const {return m_store->realAddress(m_index);}
+        uint32_t mask() const {return m_store->mask(m_index);}
+        uint32_t size() const {return m_store->nodeSize(m_index);}
+        int level() const {return m_store->level(m_index);}
+        NodePermission permission() const {return m_store->permission(m_index);}
+        NodeMode mode() const {return m_store->mode(m_index);}
+        bool isModule() const {return m_store->isModule(m_index);}
+        bool isCacheable() const {return m_store->isCacheable(m_index);}
+        int warnMinValue() const {return m_store->warnMinValue(m_index);}
+        int errorMinValue() const {return m_store->errorMinValue(m_index);}
+        /**
+         * @brief returns handle to the parent node, converting to false for a root node
+         */
+        NodeRef parent() const {return NodeRef(m_store, m_store->parent(m_index));}
+        /**
+         * @brief returns children indices sorted by token, see NodeStore::children()
+         */
+        NodeRange children() const {return m_store->children(m_index);}
+        /**
+         * @brief returns handles to the first child and to the next sibling in document order, see NodeStore::firstChild()
+         */
+        NodeRef firstChild() const {return NodeRef(m_store, m_store->firstChild(m_index));}
+        NodeRef nextSibling() const {return NodeRef(m_store, m_store->nextSibling(m_index));}
+        uint32_t subtreeMinAddress() const {return m_store->subtreeMinAddress(m_index);}
+        uint32_t subtreeMaxAddress() const {return m_store->subtreeMaxAddress(m_index);}
+        /**
+         * @brief materializes the node as a standalone Node object
+         */
+        Node toNode() const {return m_store->toNode(m_index);}
+
+      private:
+        const NodeStore * m_store;
+        uint32_t m_index;
+    };
+
+    /**
+     * @class NodeIterator
+     * @brief forward iterator over the node handles of a store, removed nodes are skipped
+     */
+    class NodeIterator
+    {
+      public:
+        NodeIterator(const NodeStore * store, uint32_t i) : m_store(store), m_index(i) {skip();}
+        NodeRef operator*() const {return NodeRef(m_store, m_index);}
+        NodeIterator& operator++() {++m_index; skip(); return *this;}
+        bool operator==(const NodeIterator& other) const {return m_index == other.m_index;}
+        bool operator!=(const NodeIterator& other) const {return m_index != other.m_index;}
+      private:
+        const NodeStore * m_store;
+        uint32_t m_index;
+        void skip() {while (m_index < m_store->size() && m_store->isRemoved(m_index)) ++m_index;}
+    };
+
+    inline NodeRef NodeStore::ref(uint32_t i) const {return NodeRef(this, i);}
+    inline NodeIterator NodeStore::begin() const {return NodeIterator(this, 0);}
+    inline NodeIterator NodeStore::end() const {return NodeIterator(this, size());}
+
+    /**
+     * @class AddressMatches
+     * @brief lightweight range of node indices matching an address, iterated without allocation
+     *
+     * Holds pointers into the store interval index, valid as long as the store is not modified.
+     */
+    class AddressMatches
+    {
+      public:
+        class iterator
+        {
+          public:
+            iterator(const AddressMatches * range, uint32_t pos) : m_range(range), m_pos(pos) {}
+            uint32_t operator*() const {return m_range->m_order[m_pos];}
+            iterator& operator++() {m_pos = m_range->next(m_pos + 1); return *this;}
+            bool operator==(const iterator& other) const {return m_pos == other.m_pos;}
+            bool operator!=(const iterator& other) const {return m_pos != other.m_pos;}
+          private:
+            const AddressMatches * m_range;
+            uint32_t m_pos;
+        };
+
+        /**
+         * @param order registers sorted by (real) address
+         * @param maxLast highest address covered in the implicit search tree under each position, see NodeStore::buildAddressIndex()
+         * @param size number of indexed registers
+         * @param last end of the registers starting at or below the address
+         */
+        AddressMatches(const NodeStore * store, const uint32_t * order, const uint32_t * maxLast, uint32_t size, uint32_t last,
+                       uint32_t address, bool real):
+          m_store(store), m_order(order), m_maxLast(maxLast), m_size(size), m_last(last), m_address(address), m_real(real) {}
+
+        iterator begin() const {return iterator(this, next(0));}
+        iterator end() const {return iterator(this, m_last);}
+        bool empty() const {return begin() == end();}
+
+      private:
+        const NodeStore * m_store;
+        const uint32_t * m_order;
+        const uint32_t * m_maxLast;
+        uint32_t m_size;
+        uint32_t m_last;
+        uint32_t m_address;
+        bool m_real;
+
+        /**
+         * @brief returns first position from the given one whose register covers the address, m_last if there is none
+         */
+        uint32_t next(uint32_t from) const;
+        /**
+         * @brief same as next() within the subtree of the positions [first, last), NO_NODE if there is none
+         */
+        uint32_t search(uint32_t first, uint32_t last, uint32_t from) const;
+    };
+
+    /**
+     * @class NodeFragment
+     * @brief nodes prepared outside of the store, e.g. by a worker thread, to be added with NodeStore::append()
+     *
+     * The name and string hashes are computed when the nodes are added to the fragment,
+     * so that appending the fragment to the store only costs the index insertions.
+     */
+    class NodeFragment
+    {
+      public:
+        /**
+         * @brief Default constructor
+         * @param prefix full name of the store node the fragment will be attached to, empty for the root
+         */
+        NodeFragment(const std::string & prefix = "") : m_prefix(prefix) {}
+
+        /**
+         * @brief appends a node to the fragment, same as NodeStore::addNode()
+         * @param parent parent node index in the fragment, NO_NODE for the fragment top level nodes
+         * @return node index in the fragment
+         */
+        uint32_t addNode(uint32_t parent, const char * token, size_t tokenLength, const NodeStore::Attributes & attributes, const std::string & description);
+        /**
+         * @brief returns number of nodes
+         */
+        uint32_t size() const {return m_nodes.size();}
+        /**
+         * @brief exchanges the content with another fragment
+         */
+        void swap(NodeFragment & other)
+        {
+          m_prefix.swap(other.m_prefix);
+          m_nodes.swap(other.m_nodes);
+          m_names.swap(other.m_names);
+          m_descriptions.swap(other.m_descriptions);
+        }
+
+      private:
+        friend class NodeStore;
+        struct Entry
+        {
+          NodeStore::Attributes attributes;
+          uint32_t parent;
+          uint32_t name;
+          uint32_t nameLength;
+          uint32_t tokenLength;
+          uint32_t description;
+          uint32_t descriptionLength;
+          uint64_t nameHash;
+          uint64_t tokenHash;
+          uint64_t descriptionHash;
+        };
+        std::string m_prefix;
+        std::vector<Entry> m_nodes;
+        std::string m_names;
+        std::string m_descriptions;
+    };
+  }
+}
+#endif
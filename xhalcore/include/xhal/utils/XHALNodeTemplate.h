@@ -0,0 +1,198 @@
+/**
+ * @file XHALNodeTemplate.h
+ * Compiled address table elements. Generate blocks are recorded once as a template and expanded
+ * into the node store, large blocks are expanded on several threads.
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALNODETEMPLATE_H
+#define XHAL_UTILS_XHALNODETEMPLATE_H
+
+#include <string>
+#include <vector>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @brief converts string representation of hex (0x prefix), binary (0b prefix) or decimal number to an integer
+     */
+    uint32_t parseNumber(const char * s);
+
+    /**
+     * @class XMLAttributes
+     * @brief values of the address table attributes of one element, as read by the parsers
+     */
+    struct XMLAttributes
+    {
+      /**
+       * @brief attributes recognized by the parsers
+       */
+      enum Name
+      {
+        ID, ADDRESS, DESCRIPTION, PERMISSION, MODE, SIZE, MASK, FW_IS_MODULE,
+        WARN_MIN_THRESHOLD, ERROR_MIN_THRESHOLD, SW_CACHE,
+        GENERATE, GENERATE_SIZE, GENERATE_ADDRESS_STEP, GENERATE_IDX_VAR,
+        COUNT
+      };
+      /**
+       * @brief attribute names as written in the address table, indexed by Name
+       */
+      static const char * const NAMES[COUNT];
+
+      XMLAttributes() : present(0) {}
+
+      std::string values[COUNT];
+      uint32_t present;
+
+      /**
+       * @brief removes all values, keeping the allocated memory
+       */
+      void clear()
+      {
+        for (int a = 0; a < COUNT; ++a) values[a].clear();
+        present = 0;
+      }
+      /**
+       * @brief marks the attribute present once its value is written, empty values are treated as missing
+       */
+      void set(Name a) {if (!values[a].empty()) present |= 1u << a;}
+      bool has(Name a) const {return present & (1u << a);}
+      const std::string& get(Name a) const {return values[a];}
+    };
+
+    /**
+     * @class NodeTemplate
+     * @brief address table element with its attributes parsed once, and its subtree
+     *
+     * The id is compiled to a list of literal parts and generate index references, so that node names are
+     * produced in a single pass. The same template is expanded for every iteration of the generate blocks.
+     */
+    class NodeTemplate
+    {
+      public:
+        /**
+         * @brief minimal number of nodes produced by a generate block for it to be expanded on several threads
+         */
+        static const uint32_t PARALLEL_MIN_NODES = 1024;
+
+        NodeTemplate() {assign(XMLAttributes());}
+        explicit NodeTemplate(const XMLAttributes& attributes) {assign(attributes);}
+
+        /**
+         * @brief resets the template to a single element, keeping the allocated memory
+         */
+        void assign(const XMLAttributes& attributes);
+        /**
+         * @brief appends child element, the returned reference is valid until the next addChild() call on this template
+         */
+        NodeTemplate& addChild(const XMLAttributes& attributes);
+        /**
+         * @brief returns true if the element is a generate block
+         */
+        bool isGenerate() const {return m_generate;}
+        /**
+         * @brief resolves ${VAR} references in the subtree against the enclosing generate blocks,
+         * to be called once the subtree is complete
+         */
+        void compile();
+        /**
+         * @brief returns number of nodes the expansion of the subtree produces
+         */
+        uint64_t expandedSize() const;
+        /**
+         * @brief adds the expanded subtree to the store
+         * @param store store to fill
+         * @param baseAddress address of the parent node
+         * @param parent parent node index
+         * @param threads maximum number of threads used to expand a large generate block
+         */
+        void expand(NodeStore& store, uint32_t baseAddress, uint32_t parent, unsigned int threads = 1) const;
+        /**
+         * @brief adds the element alone (not expanded, without its children) to the store
+         * @param childAddress set to the base address of the element children
+         * @return node index
+         */
+        uint32_t emit(NodeStore& store, uint32_t baseAddress, uint32_t parent, uint32_t& childAddress) const;
+        /**
+         * @brief finds a node of the expanded subtree by its name, without expanding the subtree
+         * @param name node name relative to the template parent, e.g. "VFAT17.VFATChannels.ChanReg99"
+         * @param length name length
+         * @param baseAddress address of the template parent
+         * @param attributes set to the node attributes
+         * @param description set to the node description
+         * @return depth of the node below the template parent (1 for the template element) or 0 if not found
+         */
+        int find(const char * name, size_t length, uint32_t baseAddress, NodeStore::Attributes& attributes, const std::string ** description) const;
+        /**
+         * @brief computes the addresses spanned by the registers of the expanded subtree, without expanding it
+         * only the elements with an address and a permission count, as in the reverse lookups of the node store
+         * @param baseAddress address of the template parent
+         * @param first set to the lowest address
+         * @param last set to the highest address, the words of the blocks included
+         * @return false if the subtree has no register
+         */
+        bool addressRange(uint32_t baseAddress, uint32_t& first, uint32_t& last) const;
+
+      private:
+        /**
+         * @brief literal part of the name followed by the value of a generate index, if var is not negative
+         */
+        struct NamePart
+        {
+          std::string literal;
+          int var;
+        };
+        /**
+         * @brief generate index values, indexed by generate block nesting level, and name buffer
+         */
+        struct ExpandState
+        {
+          std::vector<uint32_t> vars;
+          std::string name;
+        };
+
+        std::string m_id;
+        std::vector<NamePart> m_name;
+        NodeStore::Attributes m_attributes;
+        bool m_hasAddress;
+        uint32_t m_address;
+        std::string m_description;
+        bool m_generate;
+        uint32_t m_generateSize;
+        uint32_t m_generateAddressStep;
+        std::string m_generateIdxVar;
+        std::vector<NodeTemplate> m_children;
+
+        void compile(std::vector<std::string>& scope);
+        int find(const char * name, size_t length, uint32_t baseAddress, std::vector<uint32_t>& vars, bool isGenerated, int depth,
+                 NodeStore::Attributes& attributes, const std::string ** description) const;
+        bool addressRange(uint64_t baseAddress, bool isGenerated, uint64_t& first, uint64_t& last) const;
+        /**
+         * @brief matches the token against the compiled name, the generate index at level free (if any) is captured
+         */
+        bool matchName(const char * token, size_t length, size_t part, std::vector<uint32_t>& vars, int free) const;
+        template<typename Sink>
+        uint32_t emitTo(Sink& sink, uint32_t baseAddress, uint32_t parent, ExpandState& state, uint32_t& childAddress) const;
+        template<typename Sink>
+        void expandTo(Sink& sink, uint32_t baseAddress, uint32_t parent, ExpandState& state, bool isGenerated) const;
+    };
+
+    /**
+     * @brief generate block kept unexpanded, its nodes are resolved on demand
+     */
+    struct VirtualBlock
+    {
+      NodeTemplate element;
+      uint32_t parent;
+      uint32_t baseAddress;
+      // real addresses spanned by the registers of the block, empty if first > last
+      uint32_t firstRealAddress;
+      uint32_t lastRealAddress;
+    };
+  }
+}
+#endif
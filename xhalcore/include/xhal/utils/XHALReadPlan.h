@@ -0,0 +1,128 @@
+/**
+ * @file XHALReadPlan.h
+ * Grouping of register reads into block reads and a single list read
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALREADPLAN_H
+#define XHAL_UTILS_XHALREADPLAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @class ReadCost
+     * @brief cost model of the register read requests, in units of the transfer of one data word
+     *
+     * The defaults are rough figures for the CTP7: a round trip costs about as much as returning fifty words,
+     * an address of a list read costs as much as a data word.
+     */
+    struct ReadCost
+    {
+      /**
+       * @brief fixed cost of one RPC request
+       */
+      double request = 50.;
+      /**
+       * @brief cost of one word read and returned, including the unused words of a block
+       */
+      double word = 1.;
+      /**
+       * @brief cost of one address sent with a list read
+       */
+      double address = 1.;
+      /**
+       * @brief maximal number of unused words read to join two blocks (default: 0, no unrequested word is read)
+       *
+       * The words in between are read and dropped, which is only safe when no read sensitive register (FIFO, counter
+       * cleared on read) lies between the requested ones; callers reading plain status registers may raise it, e.g. to 8.
+       */
+      uint32_t maxGap = 0;
+      /**
+       * @brief maximal number of words of one block read, 0 for no limit
+       */
+      uint32_t maxBlock = 0;
+    };
+
+    /**
+     * @class ReadPlan
+     * @brief set of extras.blockread and one extras.listread requests reading the given registers
+     *
+     * The real addresses are sorted and deduplicated, neighbouring addresses are joined into runs as long as filling
+     * the gap is cheaper than starting another request and is allowed by ReadCost::maxGap. Every run is then read as
+     * a block or its addresses are added to the list read, whichever the cost model prefers; the plan reading all runs
+     * as blocks is kept instead when it is cheaper than paying for the list read.
+     *
+     * The plan only depends on the addresses, it does not issue any request: it is built once for a fixed set of
+     * registers (e.g. a monitoring table) and executed by XHALInterface::readPlan() or the rpc_manager getPlanned()
+     * as often as needed. All words land in one buffer of wordCount() words: the blocks first, in address order,
+     * then the list.
+     */
+    class ReadPlan
+    {
+      public:
+        /**
+         * @brief consecutive words read by one block read
+         */
+        struct Block
+        {
+          uint32_t address;
+          uint32_t count;
+          /**
+           * @brief position of the first word in the buffer
+           */
+          uint32_t offset;
+        };
+
+        ReadPlan() : m_listOffset(0), m_wordCount(0), m_cost(0.) {}
+        /**
+         * @brief plans the read of the registers at the real addresses, in any order and with repetitions
+         */
+        explicit ReadPlan(const std::vector<uint32_t>& addresses, const ReadCost& cost = ReadCost());
+
+        /**
+         * @brief returns the block reads
+         */
+        const std::vector<Block>& blocks() const {return m_blocks;}
+        /**
+         * @brief returns the addresses of the list read, empty if there is none
+         */
+        const std::vector<uint32_t>& list() const {return m_list;}
+        /**
+         * @brief returns the position of the first list read word in the buffer
+         */
+        uint32_t listOffset() const {return m_listOffset;}
+        /**
+         * @brief returns the size of the buffer
+         */
+        uint32_t wordCount() const {return m_wordCount;}
+        /**
+         * @brief returns the position in the buffer of the word of the i-th planned address
+         */
+        uint32_t index(size_t i) const {return m_index[i];}
+        const std::vector<uint32_t>& indices() const {return m_index;}
+        /**
+         * @brief returns number of RPC requests of the plan
+         */
+        size_t requestCount() const {return m_blocks.size() + (m_list.empty() ? 0 : 1);}
+        /**
+         * @brief returns the cost of the plan, see ReadCost
+         */
+        double cost() const {return m_cost;}
+
+      private:
+        std::vector<Block> m_blocks;
+        std::vector<uint32_t> m_list;
+        uint32_t m_listOffset;
+        uint32_t m_wordCount;
+        std::vector<uint32_t> m_index;
+        double m_cost;
+    };
+  }
+}
+#endif
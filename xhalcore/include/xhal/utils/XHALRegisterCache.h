@@ -0,0 +1,114 @@
+/**
+ * @file XHALRegisterCache.h
+ * Client side cache of register values
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALREGISTERCACHE_H
+#define XHAL_UTILS_XHALREGISTERCACHE_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @class RegisterCache
+     * @brief values of the registers read by name, kept according to a per register policy
+     *
+     * A register is cached forever if it is read only (permission="r") and marked sw_cache="true" in the address
+     * table, e.g. board IDs and firmware versions. Rules set for name prefixes override this: a time to live, or no
+     * caching at all. The longest matching prefix wins, the prefixes are plain string prefixes.
+     * The policy of a register is resolved once, when it is first stored.
+     * Entries are invalidated by address when the words are written, or by name prefix.
+     * Not thread safe.
+     */
+    class RegisterCache
+    {
+      public:
+        typedef std::chrono::steady_clock Clock;
+
+        enum class Policy : uint8_t {NEVER, FOREVER, TTL};
+
+        RegisterCache() : m_hits(0), m_misses(0) {}
+
+        /**
+         * @brief caches the registers under the prefix for the given time, never if the time is 0
+         * the entries already stored are dropped
+         */
+        void setTTL(const std::string& prefix, std::chrono::milliseconds ttl);
+        /**
+         * @brief returns the policy of a register with the given attributes
+         */
+        Policy policy(const std::string& name, NodePermission permission, bool isCacheable, std::chrono::milliseconds& ttl) const;
+
+        /**
+         * @brief returns true and sets the value if the register value is cached and not expired, counts a hit then
+         */
+        bool get(const std::string& name, uint32_t& value);
+        /**
+         * @brief stores the value read from a register already known to the cache
+         * @return false if the register is not known, insert() is needed then
+         */
+        bool update(const std::string& name, uint32_t value);
+        /**
+         * @brief stores the value read from a register, resolving its policy
+         */
+        void insert(const std::string& name, uint32_t address, uint32_t value, NodePermission permission, bool isCacheable);
+
+        /**
+         * @brief invalidates the registers in the words [address, address + 4 * count)
+         */
+        void invalidate(uint32_t address, uint32_t count = 1);
+        /**
+         * @brief invalidates the registers whose names start with the prefix, all of them for an empty prefix
+         */
+        void invalidate(const std::string& prefix);
+        /**
+         * @brief drops all entries and resets the counters
+         */
+        void clear();
+
+        /**
+         * @brief number of reads answered from the cache
+         */
+        size_t hits() const {return m_hits;}
+        /**
+         * @brief number of reads of cacheable registers that went to the board
+         */
+        size_t misses() const {return m_misses;}
+        /**
+         * @brief number of registers holding a value
+         */
+        size_t size() const;
+
+      private:
+        struct Entry
+        {
+          uint32_t address;
+          Policy policy;
+          std::chrono::milliseconds ttl;
+          Clock::time_point expiry;
+          uint32_t value;
+          bool valid;
+        };
+
+        std::unordered_map<std::string, Entry> m_entries;
+        // entries of the cached registers by address, to invalidate them on writes
+        std::multimap<uint32_t, Entry*> m_byAddress;
+        std::map<std::string, std::chrono::milliseconds> m_rules;
+        size_t m_hits;
+        size_t m_misses;
+
+        void store(Entry& entry, uint32_t value);
+    };
+  }
+}
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file XHALSharedTable.h
+ * Flattened address table published in POSIX shared memory, so that all the processes of a host
+ * map the same read-only copy instead of parsing the XML each.
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALSHAREDTABLE_H
+#define XHAL_UTILS_XHALSHAREDTABLE_H
+
+#include <string>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @class XHALSharedTable
+     * @brief publishes node store images in named shared memory segments and attaches node stores to them
+     *
+     * Every publication goes to a new read-only data segment <name>.<generation> holding the node store image,
+     * which is position independent. A small control segment <name> holds the generation of the current image,
+     * published atomically once the image is complete. Readers compare it with the generation they mapped to detect
+     * a republished table; the data segment of an older generation is unlinked but stays valid for its readers
+     * until they unmap it.
+     */
+    class XHALSharedTable
+    {
+      public:
+        /**
+         * @brief Default constructor
+         * @param xmlFile address table file name, the segment name is derived from its canonical path
+         */
+        XHALSharedTable(const std::string& xmlFile);
+
+        ~XHALSharedTable();
+
+        /**
+         * @brief returns name of the control segment
+         */
+        const std::string& getName() const {return m_name;}
+        /**
+         * @brief returns generation of the currently published image, 0 if none
+         */
+        uint64_t generation();
+        /**
+         * @brief maps the current image and attaches the node store to it, no copy is made
+         * @param hash expected content hash of the address table
+         * @param store node store to be attached, left untouched if there is no valid image with this hash
+         * @param generation set to the generation of the mapped image
+         * @return true if the image was valid and attached
+         */
+        bool load(uint64_t hash, NodeStore * store, uint64_t& generation);
+        /**
+         * @brief publishes the node store image as the next generation
+         * @param hash content hash of the address table
+         * @param store flattened node store
+         * @param generation set to the generation of the published image
+         * @return true on success
+         */
+        bool publish(uint64_t hash, const NodeStore & store, uint64_t& generation);
+
+      private:
+        std::string m_name;
+        void * m_control;
+        bool m_writable;
+
+        /**
+         * @brief maps the control segment, read-only or writable, creating it in the latter case
+         */
+        bool mapControl(bool writable);
+        std::string dataName(uint64_t generation) const;
+    };
+  }
+}
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file XHALTableImage.h
+ * Address table loaded from a prebuilt binary image, without any XML parser
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALTABLEIMAGE_H
+#define XHAL_UTILS_XHALTABLEIMAGE_H
+
+#include <string>
+#include <experimental/optional>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @class XHALTableImage
+     * @brief read-only address table mapped from an image file built on the host by xhal-atimage
+     *
+     * This is the board runtime of libxhal_image, the xhalarm library that does not link Xerces: the image is
+     * memory-mapped and used in place, so loading costs a few system calls and the table pages are shared through
+     * the page cache.
+     * Name lookups hash the full name and compare the tokens up the parent chain.
+     * Lookups only read the store, they may run concurrently.
+     */
+    class XHALTableImage
+    {
+      public:
+        /**
+         * @brief Default constructor
+         * @param imageFile image file name
+         */
+        XHALTableImage(const std::string& imageFile);
+
+        ~XHALTableImage(){}
+
+        /**
+         * @brief maps the image, throws xhal::utils::Exception if it is missing or malformed
+         */
+        void load();
+        /**
+         * @brief looks up register real address and mask by its full name, returns false if not found
+         */
+        bool findRegister(const std::string& name, uint32_t& address, uint32_t& mask) const;
+        /**
+         * @brief returns handle to the node by its full name, converting to false if the name is not found
+         */
+        NodeRef findNode(const std::string& name) const {return m_store.ref(m_store.find(name));}
+        /**
+         * @brief returns node object by its full name or nothing if name is not found
+         */
+        std::experimental::optional<Node> getNode(const std::string& name) const;
+        /**
+         * @brief returns register containing the real (bus) address as a handle, converting to false if there is none
+         */
+        NodeRef findNodeFromAddress(uint32_t address) const;
+        /**
+         * @brief returns content hash of the address table the image was built from
+         */
+        uint64_t getContentHash() const {return m_contentHash;}
+        /**
+         * @brief returns the flattened node store
+         */
+        const NodeStore& getNodeStore() const {return m_store;}
+
+      private:
+        std::string m_imageFile;
+        uint64_t m_contentHash;
+        NodeStore m_store;
+    };
+  }
+}
+#endif
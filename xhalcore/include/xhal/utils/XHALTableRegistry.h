@@ -0,0 +1,76 @@
+/**
+ * @file XHALTableRegistry.h
+ * Process-wide registry of parsed address tables, shared by all the interfaces using the same table
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALTABLEREGISTRY_H
+#define XHAL_UTILS_XHALTABLEREGISTRY_H
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace xhal {
+  namespace utils {
+    class XHALXMLParser;
+
+    /**
+     * @class XHALTableRegistry
+     * @brief hands out read-only parsed address tables, keyed by the canonical path and the content hash of the table
+     *
+     * The first acquire() of a table parses it (or loads its cache image), the following ones return the same
+     * instance. The registry only keeps weak references: a table is released when its last user drops it.
+     * Different tables are parsed concurrently, threads acquiring a table being parsed wait for it.
+     * A table whose files changed gets a new key, users of the previous version keep it until they acquire again.
+     * The returned tables must only be used through the const methods, which are safe to call from several threads.
+     */
+    class XHALTableRegistry
+    {
+      public:
+        /**
+         * @brief returns the registry of the process
+         */
+        static XHALTableRegistry& instance();
+
+        /**
+         * @brief returns the parsed address table, parsing it if no current version is in use
+         *
+         * Throws xhal::utils::Exception if the parse fails, the next call tries again
+         * @param xmlFile address table file name
+         * @param loglevel log level of the parser if the table is parsed, see XHALXMLParser::setLogLevel()
+         */
+        std::shared_ptr<const XHALXMLParser> acquire(const std::string& xmlFile, int loglevel = 1);
+        /**
+         * @brief returns number of tables in use
+         */
+        size_t size();
+
+      private:
+        XHALTableRegistry() {}
+        XHALTableRegistry(const XHALTableRegistry&) = delete;
+        XHALTableRegistry& operator=(const XHALTableRegistry&) = delete;
+
+        typedef std::pair<std::string, uint64_t> Key;
+        struct Entry
+        {
+          std::weak_ptr<const XHALXMLParser> table;
+          std::shared_future<std::shared_ptr<const XHALXMLParser> > pending;
+        };
+
+        std::mutex m_mutex;
+        std::map<Key, Entry> m_tables;
+
+        /**
+         * @brief drops the entries of the released tables, m_mutex must be held
+         */
+        void prune();
+    };
+  }
+}
+#endif
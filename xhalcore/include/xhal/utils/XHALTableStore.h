@@ -0,0 +1,196 @@
+/**
+ * @file XHALTableStore.h
+ * Several versions of the address table held at once, with the structurally identical subtrees stored once
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALTABLESTORE_H
+#define XHAL_UTILS_XHALTABLESTORE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <experimental/optional>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    class XHALTableStore;
+
+    /**
+     * @class TableVersion
+     * @brief handle to one address table version of an XHALTableStore, converting to false if there is none
+     *
+     * Valid as long as the store exists. Lookups only read the store, they may run concurrently with each other.
+     */
+    class TableVersion
+    {
+      public:
+        TableVersion() : m_store(nullptr), m_version(0) {}
+        TableVersion(const XHALTableStore * store, uint32_t version) : m_store(store), m_version(version) {}
+
+        explicit operator bool() const {return m_store != nullptr;}
+        uint32_t index() const {return m_version;}
+        /**
+         * @brief returns the version name given to XHALTableStore::addVersion()
+         */
+        const std::string& name() const;
+        /**
+         * @brief returns number of nodes of this version
+         */
+        uint32_t nodeCount() const;
+        /**
+         * @brief looks up register real address and mask by its full name, returns false if not found
+         */
+        bool findRegister(const std::string& name, uint32_t& address, uint32_t& mask) const;
+        /**
+         * @brief returns node object by its full name or nothing if name is not found
+         */
+        std::experimental::optional<Node> getNode(const std::string& name) const;
+
+      private:
+        const XHALTableStore * m_store;
+        uint32_t m_version;
+    };
+
+    /**
+     * @class XHALTableStore
+     * @brief holds the address tables of several firmware versions, deduplicating identical subtrees
+     *
+     * Every node is reduced to a shape: its attributes except the addresses, and the shapes of its children with their
+     * address offsets from the node. Shapes are interned by content, so the OH, VFAT or GBT blocks repeated within a
+     * table and shared between versions are stored once and relocated by the address of each instance. Adding a
+     * version only costs the shapes it does not share with the previous ones, plus its top level nodes.
+     * A name lookup descends the shapes from the top level node of the version, binary searching the sorted
+     * child tokens and summing the offsets, so it costs O(depth log(children)) without any per-version name index.
+     * Boards are mapped to their version in a hash table.
+     * Not thread safe while versions or boards are being added.
+     */
+    class XHALTableStore
+    {
+      public:
+        /**
+         * @brief Version index meaning "no version"
+         */
+        static const uint32_t NO_VERSION = 0xFFFFFFFF;
+
+        XHALTableStore() {}
+        ~XHALTableStore() {}
+
+        /**
+         * @brief adds the nodes of the flattened address table as a new version, replacing a version with the same name
+         * @param version version name, e.g. the firmware version
+         * @param store node store with its child index built
+         * @return version index
+         */
+        uint32_t addVersion(const std::string& version, const NodeStore& store);
+        /**
+         * @brief parses the address table (or loads its cache image) and adds it as a new version, see addVersion()
+         *
+         * Throws xhal::utils::Exception if the table can not be parsed
+         */
+        uint32_t loadVersion(const std::string& version, const std::string& xmlFile);
+        /**
+         * @brief selects the version used by the board
+         */
+        void assignBoard(const std::string& board, uint32_t version);
+        /**
+         * @brief returns the version used by the board, converting to false if the board has none
+         */
+        TableVersion forBoard(const std::string& board) const;
+        /**
+         * @brief returns the version by its index or name, converting to false if there is none
+         */
+        TableVersion version(uint32_t version) const;
+        TableVersion version(const std::string& name) const;
+
+        /**
+         * @brief returns number of versions
+         */
+        uint32_t versionCount() const {return m_versions.size();}
+        /**
+         * @brief returns number of distinct shapes, i.e. of nodes actually stored
+         */
+        uint32_t shapeCount() const {return m_token.size();}
+        /**
+         * @brief returns number of heap bytes used by the store
+         */
+        size_t memoryFootprint() const;
+
+      private:
+        friend class TableVersion;
+
+        /**
+         * @brief top level node of a version
+         */
+        struct Root
+        {
+          uint32_t shape;
+          uint32_t address;
+          uint32_t realAddress;
+        };
+        /**
+         * @brief child shape with its word and real address offsets from the parent
+         */
+        struct Edge
+        {
+          uint32_t shape;
+          uint32_t offset;
+          uint32_t realOffset;
+        };
+        struct Version
+        {
+          std::string name;
+          uint32_t nodeCount;
+          std::vector<Root> roots;
+        };
+
+        // shape columns
+        Column<uint32_t> m_token;
+        Column<uint32_t> m_description;
+        Column<uint32_t> m_mask;
+        Column<uint32_t> m_size;
+        Column<int32_t> m_warnMin;
+        Column<int32_t> m_errorMin;
+        Column<uint8_t> m_permission;
+        Column<uint8_t> m_mode;
+        Column<uint8_t> m_flags;
+        // children of shape s are the edges [m_firstEdge[s], m_firstEdge[s+1]), sorted by token
+        Column<uint32_t> m_firstEdge;
+        Column<uint32_t> m_edgeShape;
+        Column<uint32_t> m_edgeOffset;
+        Column<uint32_t> m_edgeRealOffset;
+        StringPool m_tokens;
+        StringPool m_descriptions;
+        std::unordered_multimap<uint64_t, uint32_t> m_shapeIndex;
+
+        std::vector<Version> m_versions;
+        std::unordered_map<std::string, uint32_t> m_versionIndex;
+        std::unordered_map<std::string, uint32_t> m_boards;
+
+        /**
+         * @brief returns the shape of the store node, adding it if no identical one exists
+         * @param edges child shapes, sorted by token
+         */
+        uint32_t intern(const NodeStore& store, uint32_t i, const std::vector<Edge>& edges);
+        /**
+         * @brief resolves the full name of a node of the version
+         * @param shape set to the shape of the node
+         * @param address set to the word address of the node
+         * @param realAddress set to the real address of the node
+         * @param level set to the depth of the node
+         * @return false if the name is not found
+         */
+        bool resolve(uint32_t version, const std::string& name, uint32_t& shape, uint32_t& address, uint32_t& realAddress,
+                     int& level) const;
+        /**
+         * @brief compares the name component to a token of the pool, like std::string::compare()
+         */
+        int compareToken(const char * component, size_t length, uint32_t token) const;
+    };
+  }
+}
+#endif
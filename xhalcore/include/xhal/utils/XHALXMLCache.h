@@ -0,0 +1,104 @@
+/**
+ * @file XHALXMLCache.h
+ * Binary cache of the flattened address table. Allows to skip the XML parsing when neither the
+ * top level address table nor any of the XIncluded files have changed since the cache was written.
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALXMLCACHE_H
+#define XHAL_UTILS_XHALXMLCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "xhal/utils/XHALNodeStore.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @class XHALXMLCache
+     * @brief reads and writes versioned memory-mappable images of the flattened address table
+     *
+     * The image is keyed by a content hash of the XML file and of all the files it XIncludes (recursively).
+     * By default the image is stored next to the XML file as <xmlFile>.cache, the directory can be
+     * overridden with the XHAL_AT_CACHE_DIR environment variable.
+     */
+    class XHALXMLCache
+    {
+      public:
+        /**
+         * @brief Image format version, must be incremented on any layout change
+         */
+        static const uint32_t VERSION = 6;
+
+        /**
+         * @brief Default constructor
+         * @param xmlFile address table file name
+         */
+        XHALXMLCache(const std::string& xmlFile);
+
+        ~XHALXMLCache(){}
+
+        /**
+         * @brief returns content hash of the address table file and all the included files
+         */
+        uint64_t contentHash();
+        /**
+         * @brief returns content hash of a single file, without its included files
+         */
+        static uint64_t fileHash(const std::string& fileName);
+        /**
+         * @brief returns list of files which contributed to the content hash (valid after contentHash() call)
+         */
+        const std::vector<std::string>& getFiles() const {return m_files;}
+        /**
+         * @brief returns cache image file name
+         */
+        const std::string& getCacheFile() const {return m_cacheFile;}
+        /**
+         * @brief maps the cache image and attaches the node store to it, no copy is made
+         * @param hash expected content hash
+         * @param store node store to be attached, left untouched if the image is missing, stale or corrupted
+         * @return true if the image was valid and loaded
+         */
+        bool load(uint64_t hash, NodeStore * store);
+        /**
+         * @brief writes node store image to the cache
+         * @param hash content hash to store in the image header
+         * @param store flattened node store
+         * @return true on success
+         */
+        bool store(uint64_t hash, const NodeStore & store);
+
+        /**
+         * @brief writes the node store image to a file, e.g. to ship a prebuilt table to a board without XML parser
+         * @param fileName image file name
+         * @param hash content hash to store in the image header
+         * @param store flattened node store
+         * @return true on success
+         */
+        static bool writeImage(const std::string& fileName, uint64_t hash, const NodeStore & store);
+        /**
+         * @brief maps an image file written by writeImage() or store() and attaches the node store to it
+         * @param fileName image file name
+         * @param store node store to be attached, left untouched if the image is missing or corrupted
+         * @param hash set to the content hash stored in the image header
+         * @return true if the image was valid and loaded
+         */
+        static bool readImage(const std::string& fileName, NodeStore * store, uint64_t& hash);
+
+      private:
+        std::string m_xmlFile;
+        std::string m_cacheFile;
+        std::vector<std::string> m_files;
+
+        /**
+         * @brief updates the hash with the content of the file and recursively with the included files
+         */
+        uint64_t hashFile(const std::string& fileName, uint64_t hash, int depth);
+    };
+  }
+}
+#endif
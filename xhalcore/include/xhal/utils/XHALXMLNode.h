@@ -25,22 +25,19 @@ namespace xhal {
         /**
          * @brief Default constructor. Creates empty Node.
          */
-        Node()
+        Node():
+          address(0x0),
+          real_address(0x0),
+          mode("single"),
+          size(1),
+          mask(0xFFFFFFFF),
+          isModule(false),
+          isCacheable(false),
+          parent(nullptr),
+          level(0),
+          warn_min_value(-1),
+          error_min_value(-1)
         {
-          name="";
-          description="";
-          vhdlname = "";
-          address = 0x0;
-          real_address = 0x0;
-          permission = "";
-          mode = "single";
-          size = 1;
-          mask = 0xFFFFFFFF;
-          isModule = false;
-          parent = nullptr;
-          level = 0;
-          warn_min_value = -1;
-          error_min_value = -1;
         }
         ~Node(){}
         /**
@@ -73,7 +70,7 @@ namespace xhal {
          * @param node parent node
          * @param kids vector of nodes, must be empty when function called and will be updated with node childrem
          */
-        void getAllChildren(Node node, std::vector<Node> kids)
+        void getAllChildren(const Node& node, std::vector<Node>& kids)
         {
           if (node.children.empty())
           {
@@ -96,6 +93,10 @@ namespace xhal {
         uint32_t size;
         uint32_t mask;
         bool isModule;
+        /**
+         * @brief the value may be cached by the clients, set by sw_cache="true", see XHALInterface::enableCache()
+         */
+        bool isCacheable;
         Node *parent;
         std::vector<Node> children;
         int level;
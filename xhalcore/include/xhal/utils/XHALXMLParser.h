@@ -1,6 +1,6 @@
 /**
  * @file XHALXMLParser.h
- * XML parser for XHAL library. Parses the XML address table and store results in unordered map of (regName, Node)
+ * XML parser for XHAL library. Parses the XML address table and store results in a flat node store
  *
  * @author Mykhailo Dalchenko
  * @version 1.0 
@@ -13,7 +13,10 @@
 
 #include <string>
 #include <iostream>
+#include <list>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 #include <experimental/optional>
 
 //#include <boost/algorithm/string.hpp>
@@ -49,6 +52,11 @@
 #define FATAL(MSG) LOG4CPLUS_FATAL(m_logger, MSG)
 
 #include "xhal/utils/XHALXMLNode.h"
+#include "xhal/utils/XHALNodeStore.h"
+#include "xhal/utils/XHALNodePattern.h"
+#include "xhal/utils/XHALXMLCache.h"
+#include "xhal/utils/XHALSharedTable.h"
+#include "xhal/utils/XHALXMLStreamParser.h"
 #include "xhal/utils/Exception.h"
 
 namespace xhal {
@@ -78,52 +86,212 @@ namespace xhal {
          * 4 - TRACE
          */
         void setLogLevel(int loglevel);
+        /**
+         * @brief enables or disables the binary address table cache (enabled by default)
+         *
+         * When enabled, parseXML() loads the flattened nodes from the cache image if the content hash
+         * of the XML file and all its included files matches, otherwise parses the XML and rewrites the image
+         */
+        void setUseCache(bool useCache) {m_useCache = useCache;}
+        /**
+         * @brief selects the SAX2 streaming parser instead of the DOM parser (disabled by default)
+         *
+         * The streaming parser emits the nodes while reading the file, its peak memory usage is proportional
+         * to the tree depth instead of the document size
+         */
+        void setStreaming(bool streaming) {m_streaming = streaming;}
+        /**
+         * @brief sets maximum number of threads used to expand large generate blocks (default: number of cores)
+         */
+        void setThreads(unsigned int threads) {m_threads = threads ? threads : 1;}
+        /**
+         * @brief keeps generate blocks unexpanded (disabled by default)
+         *
+         * The blocks are stored as templates with their base address and the generated nodes are resolved by getNode()
+         * from their name, the most recently resolved ones are kept in a bounded cache.
+         * getNodeFromAddress() and getNodesFromAddress() expand the blocks whose registers span the address, findNode()
+         * and findNodeFromAddress() only see the nodes of the store, getAllNodes() expands everything.
+         * A cache image is still used when valid but none is written.
+         */
+        void setLazyExpansion(bool lazy) {m_lazy = lazy;}
+        /**
+         * @brief sets maximum number of generated nodes kept resolved in lazy expansion mode (default: 1024, 0 disables)
+         */
+        void setLazyCacheSize(size_t size);
+        /**
+         * @brief shares the flattened address table with the other processes of the host (disabled by default)
+         *
+         * parseXML() maps the image published in shared memory for this table if its content hash matches,
+         * otherwise it parses the XML (or loads the cache image) and publishes the result as the next generation.
+         * The store then refers to the shared read-only copy; it is copied on the first modification, e.g. by
+         * reparseChanged(). Not used in lazy expansion mode.
+         */
+        void setSharedMemory(bool shared) {m_sharedMemory = shared;}
+        /**
+         * @brief returns generation of the shared image the store is mapped to, 0 if it is not mapped to one
+         */
+        uint64_t sharedGeneration() const {return m_sharedGeneration;}
+        /**
+         * @brief switches to the most recent shared image if another process published a new generation
+         *
+         * Cheap when nothing changed: only the generation counter is read. Handles to the nodes of the previous
+         * image are invalidated on switch.
+         * @return true if the store was switched
+         */
+        bool refresh();
         /**
          * @brief parses XML file and creates flattened nodes tree
          */
         void parseXML();
+        /**
+         * @brief reparses the XIncluded files of the address table which changed since the last parse
+         *
+         * The streaming parser records which node range every included file produced, together with the file
+         * content hash. Only the subtrees of the changed files are rebuilt: their old nodes are removed and the new
+         * ones appended and placed back in document order, so handles to the nodes of unchanged files stay valid until
+         * the removed nodes make up half of the store; the store is then compacted and all the nodes are renumbered
+         * in document order. A change of the top level file, or a table loaded from the cache image, parsed by the
+         * DOM parser or in lazy expansion mode, leads to a full (streaming) reparse, unless the content hash of all
+         * the files is unchanged.
+         * On error an exception is thrown and the next call reparses everything.
+         * @return true if anything was reparsed
+         */
+        bool reparseChanged();
         /**
          * @brief returns node object by its name or nothing if name is not found
          */
         std::experimental::optional<xhal::utils::Node> getNode(const char* nodeName);
         /**
-         * @brief not implemented
+         * @brief returns handle to the node by its name, converting to false if the name is not found
+         *
+         * Nothing is copied, the handle is valid until the next call expanding generate blocks (parseXML(), expandAll(),
+         * getNodeFromAddress(), ...). Only nodes of the node store are found: in lazy expansion mode the generated nodes
+         * need getNode() or expandAll()
+         */
+        xhal::utils::NodeRef findNode(const char* nodeName) const {return m_store->ref(m_store->find(nodeName));}
+        xhal::utils::NodeRef findNode(const std::string& nodeName) const {return m_store->ref(m_store->find(nodeName));}
+        /**
+         * @brief returns register containing the real (bus) address as a handle, see getNodeFromAddress()
+         *
+         * Only nodes of the node store are found: in lazy expansion mode the generated registers need
+         * getNodeFromAddress() or expandAll()
+         */
+        xhal::utils::NodeRef findNodeFromAddress(const uint32_t nodeAddress) const;
+        /**
+         * @brief returns register containing the real (bus) address or nothing if no register maps it
+         *
+         * When several registers share the 32-bit word (e.g. masked fields), the full word register starting
+         * at the address is preferred, otherwise the first one in address order is returned.
+         * In lazy expansion mode the generate blocks spanning the address are expanded first.
          */
         std::experimental::optional<xhal::utils::Node> getNodeFromAddress(const uint32_t nodeAddress);
+        /**
+         * @brief returns all registers containing the real (bus) address, including masked fields and blocks
+         * see getNodeFromAddress()
+         */
+        std::vector<xhal::utils::Node> getNodesFromAddress(const uint32_t nodeAddress);
+        /**
+         * @brief returns node store indices of the nodes matching the pattern, in address order
+         *
+         * Supports prefix ("GEM_AMC.OH.OH3."), glob ("*.FW_VERSION") and index range
+         * ("OH[0-3].GEB.VFATS.VFAT*.CFG_THR_ARM_DAC") queries, see NodePattern for the syntax.
+         * Throws xhal::utils::Exception if the pattern is malformed. Generate blocks kept by the lazy
+         * expansion mode are expanded first.
+         */
+        std::vector<uint32_t> findNodes(const std::string& pattern);
+        /**
+         * @brief returns all leaf nodes below the node (the node itself if it has no children) in document order,
+         * nothing if the name is not found
+         *
+         * Generate blocks kept by the lazy expansion mode are expanded first
+         */
+        std::vector<xhal::utils::Node> getAllChildren(const char* nodeName);
         /**
          * @brief return all nodes
+         *
+         * Copies every node, iterating over the NodeRef handles of getNodeStore() does not
          */
         std::unordered_map<std::string,xhal::utils::Node> getAllNodes();
+        /**
+         * @brief expands the generate blocks kept by the lazy expansion mode into the node store
+         */
+        void expandAll();
+        /**
+         * @brief returns the flattened node store
+         */
+        const xhal::utils::NodeStore& getNodeStore() const {return *m_store;}
+        /**
+         * @brief returns content hash of the address table files the store was built from, 0 before parsing
+         */
+        uint64_t getContentHash() const {return m_contentHash;}
     
       private:
         std::string m_xmlFile;
+        bool m_useCache;
+        bool m_streaming;
+        unsigned int m_threads;
+        uint64_t m_contentHash;
+        std::vector<XMLFragment> m_fragments;
+        bool m_lazy;
+        size_t m_lazyCacheSize;
+        std::vector<VirtualBlock> m_virtual;
+        std::unordered_map<uint32_t, std::vector<size_t> > m_virtualByParent;
+        std::list<xhal::utils::Node> m_lazyCache;
+        std::unordered_map<std::string, std::list<xhal::utils::Node>::iterator> m_lazyCacheIndex;
+        bool m_sharedMemory;
+        uint64_t m_sharedGeneration;
+        std::unique_ptr<XHALSharedTable> m_shared;
         log4cplus::Logger m_logger;
-        std::unordered_map<std::string, int> m_vars;
-        std::unordered_map<std::string,xhal::utils::Node>* m_nodes;
+        xhal::utils::NodeStore* m_store;
         xercesc::DOMNode* m_root;
         xercesc::DOMNode* m_node;
         xercesc::DOMNodeList* children;
     
         /**
-         * @brief fills custom node object
+         * @brief builds the DOM of the address table and fills the node store from it
+         */
+        void parseDOM();
+        /**
+         * @brief adds the element and its subtree to the node store, generate blocks are compiled to a template and expanded
+         */
+        void makeTree(xercesc::DOMNode * node, uint32_t baseAddress, uint32_t parentNode);
+        /**
+         * @brief records the element children in the template
+         */
+        void makeTemplate(xercesc::DOMNode * node, NodeTemplate & element);
+        /**
+         * @brief parses the whole table with the streaming parser, recording the fragments
+         */
+        void reparseAll();
+        /**
+         * @brief replaces the nodes of the fragment and of its nested fragments by the result of parsing its file again
+         */
+        void reloadFragment(size_t fragment);
+        /**
+         * @brief returns index of the first fragment after the fragment and its nested fragments
+         */
+        size_t fragmentBlockEnd(size_t fragment) const;
+        /**
+         * @brief drops the removed nodes from the store and renumbers the node ranges of the fragments
          */
-        void makeTree(xercesc::DOMNode * node, std::string basename, uint32_t baseAddress, std::unordered_map<std::string,xhal::utils::Node> * nodes, xhal::utils::Node * parentNode, std::unordered_map<std::string, int> vars, bool isGenerated);
+        void packStore();
         /**
-         * @brief returns node attribute value by its name if found
+         * @brief resolves a node of the unexpanded generate blocks, most recently used first
          */
-        std::experimental::optional<std::string> getAttVal(xercesc::DOMNode * t_node, const char * attname);
+        bool getVirtualNode(const char * nodeName, xhal::utils::Node & node);
         /**
-         * @brief converts string representation of hex, binary or decimal number to an integer
+         * @brief expands the unexpanded generate blocks whose registers span the real address
+         * @return false if there was none
          */
-        unsigned int parseInt(std::string & s);
+        bool expandCovering(const uint32_t nodeAddress);
         /**
-         * @brief returns cleaned from automatic generation symbols node name
+         * @brief drops the resolved generated nodes
          */
-        std::string substituteVars(std::string & s, std::unordered_map<std::string, int> dict);
+        void clearLazyCache();
         /**
-         * @brief returns a copy of original string with all occurences of first substring replaced with second substring
+         * @brief publishes the store in shared memory and maps it back, the private copy is released
          */
-        std::string replaceAll( std::string const& original, std::string const& from, std::string const& to );
+        void publishShared(uint64_t hash);
     };
   }
 }
@@ -0,0 +1,151 @@
+/**
+ * @file XHALXMLStreamParser.h
+ * SAX2 based address table parser. Nodes are emitted into the node store as the elements stream past,
+ * no DOM is built.
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#ifndef XHAL_UTILS_XHALXMLSTREAMPARSER_H
+#define XHAL_UTILS_XHALXMLSTREAMPARSER_H
+
+#include <string>
+#include <vector>
+
+#include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/dom/DOMElement.hpp>
+
+#include "log4cplus/logger.h"
+
+#include "xhal/utils/XHALNodeTemplate.h"
+
+namespace xhal {
+  namespace utils {
+    /**
+     * @brief reads the recognized address table attributes of the SAX element, other attributes are ignored
+     */
+    void readAttributes(const xercesc::Attributes& attrs, XMLAttributes& out);
+    /**
+     * @brief reads the recognized address table attributes of the DOM element, other attributes are ignored
+     */
+    void readAttributes(const xercesc::DOMElement * element, XMLAttributes& out);
+
+    /**
+     * @brief file of the address table and the store nodes it produced
+     */
+    struct XMLFragment
+    {
+      std::string file;
+      /**
+       * @brief content hash of the file alone, see XHALXMLCache::fileHash()
+       */
+      uint64_t hash;
+      /**
+       * @brief XInclude nesting depth, 0 for the top level file
+       */
+      unsigned int depth;
+      /**
+       * @brief node and base address the root element of the file is attached to
+       */
+      uint32_t parent;
+      uint32_t parentAddress;
+      /**
+       * @brief range of node indices [first, end) emitted while parsing the file, nested fragments included
+       */
+      uint32_t first;
+      uint32_t end;
+      /**
+       * @brief false if the file is included from a generate block, its nodes then belong to the enclosing fragment
+       */
+      bool reloadable;
+    };
+
+    /**
+     * @class XHALXMLStreamParser
+     * @brief fills the node store from the SAX2 events of the address table and of the files it XIncludes
+     *
+     * Memory usage is proportional to the tree depth: only the stack of open elements is kept,
+     * except for generate blocks whose (unexpanded) subtree is recorded and expanded once closed.
+     * Xerces must be initialized by the caller.
+     */
+    class XHALXMLStreamParser : public xercesc::DefaultHandler
+    {
+      public:
+        /**
+         * @brief Default constructor
+         * @param store node store to fill, nodes are appended
+         * @param logger logger to report to
+         * @param threads maximum number of threads used to expand generate blocks
+         */
+        XHALXMLStreamParser(NodeStore * store, log4cplus::Logger logger, unsigned int threads = 1);
+
+        ~XHALXMLStreamParser(){}
+
+        /**
+         * @brief parses the address table, throws xhal::utils::Exception on error
+         */
+        void parse(const std::string& xmlFile);
+        /**
+         * @brief parses a single XIncluded file of the address table, attaching its root element to the given node
+         * @param fileName included file
+         * @param parent node the root element is attached to
+         * @param parentAddress base address of the parent children
+         * @param depth XInclude nesting depth of the file
+         */
+        void parseFragment(const std::string& fileName, uint32_t parent, uint32_t parentAddress, unsigned int depth);
+        /**
+         * @brief records the files XIncluded while parsing, with the node ranges they produced (nullptr to disable)
+         */
+        void setFragments(std::vector<XMLFragment> * fragments) {m_fragments = fragments;}
+        /**
+         * @brief keeps generate blocks unexpanded, appending them to blocks instead (nullptr to expand them)
+         */
+        void setVirtualBlocks(std::vector<VirtualBlock> * blocks) {m_virtual = blocks;}
+
+        void startElement(const XMLCh * const uri, const XMLCh * const localname, const XMLCh * const qname,
+                          const xercesc::Attributes& attrs) override;
+        void endElement(const XMLCh * const uri, const XMLCh * const localname, const XMLCh * const qname) override;
+
+      private:
+        /**
+         * @brief open element: its node index and the base address of its children
+         */
+        struct Frame
+        {
+          uint32_t node;
+          uint32_t address;
+        };
+
+        NodeStore * m_store;
+        log4cplus::Logger m_logger;
+        unsigned int m_threads;
+        std::vector<VirtualBlock> * m_virtual;
+        std::vector<XMLFragment> * m_fragments;
+        unsigned int m_depth;
+        std::vector<Frame> m_frames;
+        std::vector<std::string> m_files;
+        XMLAttributes m_attributes;
+        NodeTemplate m_element;
+        NodeTemplate m_template;
+        std::vector<NodeTemplate *> m_capture;
+        Frame m_captureParent;
+        unsigned int m_skipDepth;
+
+        /**
+         * @brief parses from the current state, reporting errors as xhal::utils::Exception
+         */
+        void parseTop(const std::string& fileName);
+        /**
+         * @brief parses a single file, called recursively for XIncludes
+         */
+        void parseFile(const std::string& fileName);
+        /**
+         * @brief handles xi:include element
+         */
+        void include(const xercesc::Attributes& attrs);
+    };
+  }
+}
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file xhal-atdb.cpp
+ * Builds the LMDB register database from the XML address table
+ *
+ * Usage: xhal-atdb [-b <lookups>] <address_table.xml> <database.mdb>
+ *   -b  after building, looks the registers up in random order and reports the lookup rate
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#include "xhal/utils/XHALXMLParser.h"
+#include "xhal/utils/XHALATDB.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+  size_t lookups = 0;
+  int arg = 1;
+  if (argc > 2 && std::strcmp(argv[1], "-b") == 0) {
+    lookups = std::strtoul(argv[2], nullptr, 10);
+    arg = 3;
+  }
+  if (argc - arg != 2) {
+    std::cerr << "Usage: " << argv[0] << " [-b <lookups>] <address_table.xml> <database.mdb>" << std::endl;
+    return 2;
+  }
+  const std::string xmlFile = argv[arg];
+  const std::string dbPath = argv[arg + 1];
+
+  try {
+    auto begin = std::chrono::high_resolution_clock::now();
+    xhal::utils::XHALXMLParser parser(xmlFile);
+    parser.setLogLevel(1);
+    parser.parseXML();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Address table parsed in " << std::chrono::duration_cast<std::chrono::milliseconds>(end-begin).count() << " ms" << std::endl;
+
+    begin = std::chrono::high_resolution_clock::now();
+    xhal::utils::XHALATDBBuilder builder(dbPath);
+    const size_t records = builder.build(parser.getContentHash(), parser.getNodeStore());
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << records << " records written to " << dbPath << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end-begin).count() << " ms" << std::endl;
+
+    if (lookups == 0) return 0;
+    xhal::utils::XHALATDBReader reader(dbPath);
+    std::vector<std::string> names;
+    const xhal::utils::NodeStore& store = parser.getNodeStore();
+    const std::string prefix = reader.getRootName().empty() ? std::string() : reader.getRootName() + ".";
+    for (auto node: store) {
+      if (node.permission() == xhal::utils::NodePermission::NONE) continue;
+      names.push_back(node.name().substr(prefix.size()));
+    }
+    if (names.empty()) return 0;
+    std::shuffle(names.begin(), names.end(), std::mt19937(42));
+    xhal::utils::ATDBRecord record;
+    size_t missing = 0;
+    begin = std::chrono::high_resolution_clock::now();
+    for (size_t n = 0; n < lookups; ++n) {
+      if (!reader.find(names[n % names.size()], record)) ++missing;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    const double seconds = std::chrono::duration<double>(end-begin).count();
+    std::cout << lookups << " lookups in " << seconds * 1e3 << " ms, " << lookups / seconds << " lookups/s" << std::endl;
+    if (missing) {
+      std::cerr << missing << " registers not found in the database" << std::endl;
+      return 1;
+    }
+  } catch (xhal::utils::Exception& e) {
+    std::cerr << "Caught exception: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file xhal-atimage.cpp
+ * Builds the binary image of the address table loaded by XHALTableImage on the boards, which have no XML parser
+ *
+ * Usage: xhal-atimage [-f] [-m <bytes>] <address_table.xml> <image.xat>
+ *   -f  keeps the descriptions and the hierarchical query indices, which are dropped by default
+ *   -m  fails if the image is larger than the memory budget
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#include "xhal/utils/XHALXMLParser.h"
+#include "xhal/utils/XHALTableImage.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <sys/stat.h>
+
+int main(int argc, char** argv)
+{
+  bool full = false;
+  size_t budget = 0;
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+    if (std::strcmp(argv[arg], "-f") == 0) full = true;
+    else if (std::strcmp(argv[arg], "-m") == 0 && arg + 1 < argc) budget = std::strtoul(argv[++arg], nullptr, 10);
+    else break;
+  }
+  if (argc - arg != 2) {
+    std::cerr << "Usage: " << argv[0] << " [-f] [-m <bytes>] <address_table.xml> <image.xat>" << std::endl;
+    return 2;
+  }
+  const std::string xmlFile = argv[arg];
+  const std::string imageFile = argv[arg + 1];
+
+  try {
+    xhal::utils::XHALXMLParser parser(xmlFile);
+    parser.setLogLevel(1);
+    parser.parseXML();
+    xhal::utils::NodeStore store = parser.getNodeStore();
+    if (!full) store.compact();
+    if (!xhal::utils::XHALXMLCache::writeImage(imageFile, parser.getContentHash(), store)) {
+      std::cerr << "Cannot write " << imageFile << std::endl;
+      return 1;
+    }
+
+    // check that the board will load it
+    xhal::utils::XHALTableImage image(imageFile);
+    image.load();
+    struct stat st;
+    stat(imageFile.c_str(), &st);
+    std::cout << image.getNodeStore().size() << " nodes written to " << imageFile << ", " << st.st_size << " bytes" << std::endl;
+    if (budget && (size_t)st.st_size > budget) {
+      std::cerr << "Image exceeds the memory budget of " << budget << " bytes" << std::endl;
+      return 1;
+    }
+  } catch (xhal::utils::Exception& e) {
+    std::cerr << "Caught exception: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,306 @@
+/**
+ * @file xhal-reggen.cpp
+ * Generates a C++ header of constexpr register descriptors from the XML address table
+ *
+ * Usage: xhal-reggen [-n <namespace>] <address_table.xml> <output.h>
+ *
+ * Every node with children becomes a struct, every leaf an xhal::RegisterDesc. Sibling nodes named <prefix>0 to
+ * <prefix>N-1 with the same structure (typically produced by generate blocks) become an array member <prefix>[N],
+ * so that registers are indexable, e.g. regs::GEM_AMC.OH.OH[n].GEB.VFATS.VFAT[m].CFG_THR_ARM_DAC.
+ * Each struct also carries the base address and the number of words covered by its registers, so that it can be
+ * filled from a single block read with RegisterDesc::get().
+ *
+ * @author Mykhailo Dalchenko
+ * @version 1.0
+ */
+
+#include "xhal/utils/XHALXMLParser.h"
+#include "xhal/XHALRegister.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  const uint32_t NO_NODE = xhal::utils::NodeStore::NO_NODE;
+
+  /*
+   * Member of a generated struct: a single node, or an array of nodes of the same type
+   */
+  struct Member
+  {
+    std::string name;
+    std::vector<uint32_t> nodes;
+    bool isArray;
+  };
+
+  class Generator
+  {
+    public:
+      explicit Generator(const xhal::utils::NodeStore & store) : m_store(store), m_typeOf(store.size(), std::string()) {}
+
+      void run(const std::string & ns, const std::string & guard, std::ostream & out);
+
+    private:
+      const xhal::utils::NodeStore & m_store;
+      std::vector<std::string> m_typeOf;
+      std::map<std::string, std::string> m_typeBySignature;
+      std::set<std::string> m_typeNames;
+      std::vector<std::string> m_definitions;
+      std::map<uint32_t, std::vector<Member> > m_members;
+
+      static std::string identifier(const std::string & token);
+      bool isStruct(uint32_t i) const {return !m_store.children(i).empty();}
+      std::string memberType(uint32_t i) const {return isStruct(i) ? m_typeOf[i] : "xhal::RegisterDesc";}
+      void compileType(uint32_t i, const std::string & path);
+      std::vector<Member> groupMembers(uint32_t i) const;
+      void writeValue(uint32_t i, int indent, std::ostream & out) const;
+      void writeRegister(uint32_t i, std::ostream & out) const;
+  };
+
+  std::string Generator::identifier(const std::string & token)
+  {
+    static const std::set<std::string> keywords = {
+      "alignas", "alignof", "and", "asm", "auto", "bool", "break", "case", "catch", "char", "class", "const",
+      "constexpr", "continue", "default", "delete", "do", "double", "else", "enum", "explicit", "export", "extern",
+      "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "not",
+      "operator", "or", "private", "protected", "public", "register", "return", "short", "signed", "sizeof", "static",
+      "struct", "switch", "template", "this", "throw", "true", "try", "typedef", "union", "unsigned", "using",
+      "virtual", "void", "volatile", "while", "xor", "base", "words", "reg_"
+    };
+    std::string id;
+    for (char c: token) id.push_back(std::isalnum(static_cast<unsigned char>(c)) ? c : '_');
+    if (id.empty() || std::isdigit(static_cast<unsigned char>(id[0]))) id.insert(0, "n");
+    if (keywords.count(id)) id.push_back('_');
+    return id;
+  }
+
+  std::vector<Member> Generator::groupMembers(uint32_t i) const
+  {
+    // candidate arrays: tokens <prefix><index> with a decimal index without leading zeros
+    std::map<std::string, std::vector<std::pair<uint32_t, uint32_t> > > indexed;
+    std::set<std::string> plain;
+    for (auto c: m_store.children(i)) {
+      const char * token = m_store.token(c);
+      size_t length = std::strlen(token);
+      size_t digits = length;
+      while (digits > 0 && std::isdigit(static_cast<unsigned char>(token[digits - 1]))) --digits;
+      plain.insert(identifier(token));
+      if (digits == 0 || digits == length || (token[digits] == '0' && digits + 1 < length) || length - digits > 9) continue;
+      indexed[std::string(token, digits)].push_back(std::make_pair(std::strtoul(token + digits, nullptr, 10), c));
+    }
+
+    std::vector<Member> members;
+    std::set<uint32_t> grouped;
+    for (auto& candidate: indexed) {
+      auto& elements = candidate.second;
+      const std::string name = identifier(candidate.first);
+      if (elements.size() < 2 || plain.count(name)) continue;
+      std::sort(elements.begin(), elements.end());
+      bool isArray = true;
+      for (size_t n = 0; n < elements.size() && isArray; ++n) {
+        isArray = elements[n].first == n && memberType(elements[n].second) == memberType(elements[0].second);
+      }
+      if (!isArray) continue;
+      Member member;
+      member.name = name;
+      member.isArray = true;
+      for (auto const& e: elements) {
+        member.nodes.push_back(e.second);
+        grouped.insert(e.second);
+      }
+      members.push_back(member);
+    }
+    for (auto c: m_store.children(i)) {
+      if (grouped.count(c)) continue;
+      Member member;
+      member.name = identifier(m_store.token(c));
+      member.isArray = false;
+      member.nodes.push_back(c);
+      members.push_back(member);
+    }
+    std::sort(members.begin(), members.end(), [](const Member & a, const Member & b) {return a.name < b.name;});
+    return members;
+  }
+
+  void Generator::compileType(uint32_t i, const std::string & path)
+  {
+    std::vector<Member> members = groupMembers(i);
+    const bool hasReg = m_store.permission(i) != xhal::utils::NodePermission::NONE;
+    // the types of the members identify their structure, so the signature does not need to be recursive
+    std::ostringstream signature;
+    signature << (hasReg ? "r" : "") << "{";
+    for (auto const& m: members) {
+      signature << m.name << ":" << memberType(m.nodes[0]);
+      if (m.isArray) signature << "[" << m.nodes.size() << "]";
+      signature << ";";
+    }
+    signature << "}";
+    auto found = m_typeBySignature.find(signature.str());
+    if (found != m_typeBySignature.end()) {
+      m_typeOf[i] = found->second;
+      m_members[i] = members;
+      return;
+    }
+
+    std::string name = path + "_t";
+    for (int n = 2; m_typeNames.count(name); ++n) name = path + "_" + std::to_string(n) + "_t";
+    m_typeNames.insert(name);
+    m_typeBySignature[signature.str()] = name;
+    m_typeOf[i] = name;
+    m_members[i] = members;
+
+    std::ostringstream definition;
+    definition << "  struct " << name << std::endl << "  {" << std::endl;
+    definition << "    uint32_t base;" << std::endl << "    uint32_t words;" << std::endl;
+    if (hasReg) definition << "    xhal::RegisterDesc reg_;" << std::endl;
+    for (auto const& m: members) {
+      definition << "    " << memberType(m.nodes[0]) << " " << m.name;
+      if (m.isArray) definition << "[" << m.nodes.size() << "]";
+      definition << ";" << std::endl;
+    }
+    definition << "  };" << std::endl;
+    m_definitions.push_back(definition.str());
+  }
+
+  void Generator::writeRegister(uint32_t i, std::ostream & out) const
+  {
+    const uint32_t mask = m_store.mask(i);
+    char buffer[96];
+    std::snprintf(buffer, sizeof(buffer), "{0x%08xu, 0x%08xu, %u, %u, %u}", m_store.realAddress(i), mask,
+                  xhal::maskShift(mask), xhal::maskWidth(mask), static_cast<unsigned>(m_store.permission(i)));
+    out << buffer;
+  }
+
+  void Generator::writeValue(uint32_t i, int indent, std::ostream & out) const
+  {
+    if (!isStruct(i)) {
+      writeRegister(i, out);
+      return;
+    }
+    // block covered by the registers of the subtree
+    uint32_t first = 0xFFFFFFFF, last = 0;
+    std::vector<uint32_t> nodes(1, i);
+    m_store.appendDescendants(i, nodes);
+    for (auto n: nodes) {
+      if (m_store.permission(n) == xhal::utils::NodePermission::NONE) continue;
+      first = std::min(first, m_store.realAddress(n));
+      last = std::max(last, m_store.realAddress(n));
+    }
+    const std::string pad(indent + 2, ' ');
+    char buffer[64];
+    if (first > last) std::snprintf(buffer, sizeof(buffer), "0x00000000u, 0");
+    else std::snprintf(buffer, sizeof(buffer), "0x%08xu, %u", first, (last - first) / 4 + 1);
+    out << "{" << buffer;
+    if (m_store.permission(i) != xhal::utils::NodePermission::NONE) {
+      out << ", ";
+      writeRegister(i, out);
+    }
+    for (auto const& m: m_members.at(i)) {
+      out << "," << std::endl << pad << "/* " << m.name << " */ ";
+      if (m.isArray) {
+        out << "{";
+        for (size_t n = 0; n < m.nodes.size(); ++n) {
+          if (n) out << "," << std::endl << pad << "  ";
+          writeValue(m.nodes[n], indent + 4, out);
+        }
+        out << "}";
+      } else {
+        writeValue(m.nodes[0], indent + 2, out);
+      }
+    }
+    out << "}";
+  }
+
+  void Generator::run(const std::string & ns, const std::string & guard, std::ostream & out)
+  {
+    // a single top level node is the table root, its children become the top level objects
+    std::vector<uint32_t> top;
+    for (auto r: m_store.children(NO_NODE)) top.push_back(r);
+    if (top.size() == 1 && isStruct(top[0])) {
+      const uint32_t root = top[0];
+      top.assign(m_store.children(root).begin(), m_store.children(root).end());
+    }
+
+    // children follow their parent in the store, so a backward pass defines the member types first
+    std::vector<uint32_t> order;
+    for (auto t: top) {
+      order.push_back(t);
+      m_store.appendDescendants(t, order);
+    }
+    std::sort(order.begin(), order.end());
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+      if (!isStruct(*it)) continue;
+      // type named after the path of the first node of this structure, without the array indices
+      std::string path;
+      uint32_t n = *it;
+      for (; std::find(top.begin(), top.end(), n) == top.end(); n = m_store.parent(n)) {
+        std::string token = identifier(m_store.token(n));
+        while (token.size() > 1 && std::isdigit(static_cast<unsigned char>(token.back()))) token.pop_back();
+        path = "_" + token + path;
+      }
+      compileType(*it, identifier(m_store.token(n)) + path);
+    }
+
+    out << "/**" << std::endl
+        << " * @file Generated by xhal-reggen from the address table, do not edit" << std::endl
+        << " */" << std::endl
+        << "#ifndef " << guard << std::endl
+        << "#define " << guard << std::endl << std::endl
+        << "#include \"xhal/XHALRegister.h\"" << std::endl << std::endl
+        << "namespace " << ns << " {" << std::endl;
+    for (auto const& d: m_definitions) out << d << std::endl;
+    for (auto t: top) {
+      out << "  constexpr " << memberType(t) << " " << identifier(m_store.token(t)) << " = ";
+      writeValue(t, 2, out);
+      out << ";" << std::endl << std::endl;
+    }
+    out << "}" << std::endl << "#endif  // " << guard << std::endl;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::string ns = "regs";
+  int arg = 1;
+  if (argc > 2 && std::strcmp(argv[1], "-n") == 0) {
+    ns = argv[2];
+    arg = 3;
+  }
+  if (argc - arg != 2) {
+    std::cerr << "Usage: " << argv[0] << " [-n <namespace>] <address_table.xml> <output.h>" << std::endl;
+    return 2;
+  }
+  const std::string xmlFile = argv[arg];
+  const std::string output = argv[arg + 1];
+
+  std::string guard;
+  const size_t slash = output.find_last_of('/');
+  for (char c: output.substr(slash == std::string::npos ? 0 : slash + 1)) {
+    guard.push_back(std::isalnum(static_cast<unsigned char>(c)) ? std::toupper(static_cast<unsigned char>(c)) : '_');
+  }
+
+  try {
+    xhal::utils::XHALXMLParser parser(xmlFile);
+    parser.setLogLevel(1);
+    parser.parseXML();
+    std::ofstream out(output);
+    if (!out) {
+      std::cerr << "Cannot write " << output << std::endl;
+      return 1;
+    }
+    Generator(parser.getNodeStore()).run(ns, guard, out);
+  } catch (xhal::utils::Exception& e) {
+    std::cerr << "Caught exception: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,210 @@
+#include "xhal/XHALAsyncClient.h"
+
+#include <sys/socket.h>
+
+const uint64_t xhal::AsyncRPCClient::ANY_KEY;
+
+void xhal::AsyncRPCClient::Connection::interrupt()
+{
+  // the blocked call_method() returns with an exception, the socket is closed by disconnect()
+  if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+}
+
+xhal::AsyncRPCClient::AsyncRPCClient(size_t depth) :
+  m_depth(depth ? depth : 1),
+  m_inFlight(0),
+  m_sequence(0),
+  m_connected(false),
+  m_stop(false)
+{
+}
+
+xhal::AsyncRPCClient::~AsyncRPCClient()
+{
+  disconnect();
+}
+
+void xhal::AsyncRPCClient::connect(const std::string& host, uint16_t port)
+{
+  std::lock_guard<std::mutex> calling(m_callMutex);
+  if (m_connected) return;
+  // a connection may have been lost
+  close();
+  try {
+    for (size_t i = 0; i < m_depth; ++i) {
+      m_workers.emplace_back(new Worker());
+      m_workers.back()->rpc.connect(host, port);
+    }
+  } catch (wisc::RPCSvc::RPCException &e) {
+    close();
+    throw;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_connected = true;
+  m_stop = false;
+  for (auto& worker: m_workers) worker->thread = std::thread(&AsyncRPCClient::run, this, std::ref(*worker));
+}
+
+void xhal::AsyncRPCClient::disconnect()
+{
+  std::lock_guard<std::mutex> calling(m_callMutex);
+  close();
+}
+
+void xhal::AsyncRPCClient::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_connected = false;
+    for (auto& worker: m_workers) {
+      worker->rpc.interrupt();
+      worker->wake.notify_one();
+    }
+  }
+  m_changed.notify_all();
+  for (auto& worker: m_workers) {
+    if (worker->thread.joinable()) worker->thread.join();
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  failQueued(std::make_exception_ptr(wisc::RPCSvc::NotConnectedException("Connection closed")));
+  for (auto& worker: m_workers) {
+    try {
+      worker->rpc.disconnect();
+    } catch (wisc::RPCSvc::RPCException &e) {
+    }
+  }
+  m_workers.clear();
+}
+
+bool xhal::AsyncRPCClient::loadModule(const std::string& module, const std::string& moduleVersion)
+{
+  std::lock_guard<std::mutex> calling(m_callMutex);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_connected) throw wisc::RPCSvc::NotConnectedException("Not connected");
+    m_changed.wait(lock, [this] {return m_inFlight == 0;});
+  }
+  // the threads only use their connection while they execute a request
+  bool loaded = true;
+  for (auto& worker: m_workers) loaded = worker->rpc.load_module(module, moduleVersion) && loaded;
+  return loaded;
+}
+
+std::future<wisc::RPCMsg> xhal::AsyncRPCClient::call(const wisc::RPCMsg& request, uint64_t key)
+{
+  Pending pending;
+  std::future<wisc::RPCMsg> result = pending.promise.get_future();
+  send(request, std::move(pending), key);
+  return result;
+}
+
+uint64_t xhal::AsyncRPCClient::call(const wisc::RPCMsg& request, Callback callback, uint64_t key)
+{
+  Pending pending;
+  pending.callback = std::move(callback);
+  return send(request, std::move(pending), key);
+}
+
+uint64_t xhal::AsyncRPCClient::send(const wisc::RPCMsg& request, Pending&& pending, uint64_t key)
+{
+  pending.request = request;
+  std::lock_guard<std::mutex> calling(m_callMutex);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_changed.wait(lock, [this] {return m_inFlight < m_depth || !m_connected;});
+  if (!m_connected) throw wisc::RPCSvc::NotConnectedException("Not connected");
+  Worker* worker = nullptr;
+  if (key != ANY_KEY) {
+    worker = m_workers[getConnection(key)].get();
+  } else {
+    for (auto& w: m_workers) {
+      if (!worker || w->queue.size() + w->busy < worker->queue.size() + worker->busy) worker = w.get();
+    }
+  }
+  const uint64_t sequence = m_sequence++;
+  pending.sequence = sequence;
+  worker->queue.push_back(std::move(pending));
+  ++m_inFlight;
+  lock.unlock();
+  worker->wake.notify_one();
+  return sequence;
+}
+
+void xhal::AsyncRPCClient::flush()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_changed.wait(lock, [this] {return m_inFlight == 0;});
+}
+
+size_t xhal::AsyncRPCClient::getConnection(uint64_t key) const
+{
+  // keys are usually byte addresses: consecutive words go round robin, the higher bytes are folded in so that
+  // the registers of generate blocks (power of two address steps) are spread too
+  key >>= 2;
+  key ^= key >> 8;
+  key ^= key >> 16;
+  key ^= key >> 32;
+  return key % m_depth;
+}
+
+size_t xhal::AsyncRPCClient::getInFlight() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_inFlight;
+}
+
+void xhal::AsyncRPCClient::run(Worker& worker)
+{
+  while (true) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    worker.wake.wait(lock, [&] {return !worker.queue.empty() || m_stop;});
+    if (m_stop) return;
+    Pending pending = std::move(worker.queue.front());
+    worker.queue.pop_front();
+    worker.busy = true;
+    lock.unlock();
+
+    wisc::RPCMsg response;
+    std::exception_ptr error;
+    bool lost = false;
+    try {
+      response = worker.rpc.call_method(pending.request);
+    } catch (wisc::RPCSvc::RPCErrorException &e) {
+      error = std::current_exception();
+    } catch (wisc::RPCSvc::RPCException &e) {
+      // the connection is unusable, so are the requests queued behind
+      error = std::current_exception();
+      lost = true;
+    } catch (...) {
+      error = std::make_exception_ptr(wisc::RPCSvc::RPCException("Corrupt response message"));
+    }
+    complete(pending, response, error);
+
+    lock.lock();
+    worker.busy = false;
+    --m_inFlight;
+    if (lost && !m_stop) {
+      m_connected = false;
+      failQueued(error);
+    }
+    lock.unlock();
+    m_changed.notify_all();
+  }
+}
+
+void xhal::AsyncRPCClient::failQueued(std::exception_ptr error)
+{
+  for (auto& worker: m_workers) {
+    for (auto& pending: worker->queue) complete(pending, wisc::RPCMsg(), error);
+    m_inFlight -= worker->queue.size();
+    worker->queue.clear();
+  }
+  m_changed.notify_all();
+}
+
+void xhal::AsyncRPCClient::complete(Pending& pending, const wisc::RPCMsg& response, std::exception_ptr error)
+{
+  if (pending.callback) pending.callback(pending.sequence, response, error);
+  else if (error) pending.promise.set_exception(error);
+  else pending.promise.set_value(response);
+}
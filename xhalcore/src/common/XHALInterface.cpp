@@ -2,7 +2,11 @@
 
 xhal::XHALInterface::XHALInterface(const std::string& board_domain_name, const std::string& address_table_filename):
   m_board_domain_name(board_domain_name),
-  m_address_table_filename(address_table_filename)
+  m_address_table_filename(address_table_filename),
+  m_cacheEnabled(false),
+  m_pipelineDepth(8),
+  m_rmwSupport(Support::UNKNOWN),
+  m_rmwListSupport(Support::UNKNOWN)
 {
 }
 
@@ -17,11 +21,13 @@ void xhal::XHALInterface::init()
   m_logger.setLogLevel(log4cplus::INFO_LOG_LEVEL);
   INFO("XHAL Logger tuned up");
 
-  m_parser = new xhal::utils::XHALXMLParser(m_address_table_filename);
+  m_backend = xhal::utils::XHALLookupBackend::create(m_address_table_filename);
   DEBUG("Address table name " << m_address_table_filename);
-  m_parser->setLogLevel(2);
-  m_parser->parseXML();
+  m_backend->setLogLevel(2);
+  m_backend->load();
 
+  m_rmwSupport = Support::UNKNOWN;
+  m_rmwListSupport = Support::UNKNOWN;
   try {
 		rpc.connect(m_board_domain_name);
 	}
@@ -49,71 +55,89 @@ void xhal::XHALInterface::setLogLevel(int loglevel)
   {
     case 0:
       m_logger.setLogLevel(log4cplus::ERROR_LOG_LEVEL);
-      m_parser->setLogLevel(0);
+      m_backend->setLogLevel(0);
       break;
     case 1:
       m_logger.setLogLevel(log4cplus::WARN_LOG_LEVEL);
-      m_parser->setLogLevel(1);
+      m_backend->setLogLevel(1);
       break;
     case 2:
       m_logger.setLogLevel(log4cplus::INFO_LOG_LEVEL);
-      m_parser->setLogLevel(2);
+      m_backend->setLogLevel(2);
       break;
     case 3:
       m_logger.setLogLevel(log4cplus::DEBUG_LOG_LEVEL);
-      m_parser->setLogLevel(3);
+      m_backend->setLogLevel(3);
       break;
     case 4:
       m_logger.setLogLevel(log4cplus::TRACE_LOG_LEVEL);
-      m_parser->setLogLevel(4);
+      m_backend->setLogLevel(4);
       break;
   }
 }
 
-uint32_t xhal::XHALInterface::readReg(std::string regName)
+void xhal::XHALInterface::findRegister(const std::string& regName, uint32_t& address, uint32_t& mask)
 {
-  if (auto t_node = m_parser->getNode(regName.c_str()))
+  if (m_backend->findRegister(regName, address, mask)) return;
+  ERROR("Register not found in address table!");
+  throw xhal::utils::Exception(("XHAL XML exception: can't find node " + regName).c_str());
+}
+
+void xhal::XHALInterface::enableCache(bool enable)
+{
+  m_cacheEnabled = enable;
+  if (!enable) m_cache.clear();
+}
+
+uint32_t xhal::XHALInterface::readReg(const std::string& regName)
+{
+  uint32_t address, mask, cached;
+  if (m_cacheEnabled && m_cache.get(regName, cached))
   {
-    m_node = t_node.value();
-	  req = wisc::RPCMsg("memory.read");
-    req.set_word("address", m_node.real_address);
-    req.set_word("count", 1);
-    try {
-      rsp = rpc.call_method(req);
+    DEBUG("Register " << regName << " read from cache");
+    return cached;
+  }
+  findRegister(regName, address, mask);
+  req = wisc::RPCMsg("memory.read");
+  req.set_word("address", address);
+  req.set_word("count", 1);
+  try {
+    rsp = rpc.call_method(req);
+  }
+  STANDARD_CATCH;
+  uint32_t result;
+  if (rsp.get_key_exists("error"))
+  {
+    ERROR("RPC response returned error, readReg failed"); 
+    throw xhal::utils::Exception("Error during register access");
+  } else {
+    try{
+      ASSERT(rsp.get_word_array_size("data") == 1);
+      rsp.get_word_array("data", &result);
     }
     STANDARD_CATCH;
-    uint32_t result;
-    if (rsp.get_key_exists("error"))
-    {
-      ERROR("RPC response returned error, readReg failed"); 
-      throw xhal::utils::Exception("Error during register access");
-    } else {
-      try{
-        ASSERT(rsp.get_word_array_size("data") == 1);
-        rsp.get_word_array("data", &result);
-      }
-      STANDARD_CATCH;
-    }
-    DEBUG("RESULT: " << std::hex << result);
-    DEBUG("Node mask: " << std::hex << m_node.mask);
-    uint32_t mask = m_node.mask;
-    result = result & mask;
-    DEBUG("RESULT after applying mask: " << std::hex << result);
-    for (int i = 0; i < 32; i++)
+  }
+  DEBUG("RESULT: " << std::hex << result);
+  DEBUG("Node mask: " << std::hex << mask);
+  result = result & mask;
+  DEBUG("RESULT after applying mask: " << std::hex << result);
+  for (int i = 0; i < 32; i++)
+  {
+    if (mask & 1) 
     {
-      if (mask & 1) 
-      {
-        break;
-      }else {
-        mask = mask >> 1;
-        result = result >> 1;
-      }
+      break;
+    }else {
+      mask = mask >> 1;
+      result = result >> 1;
     }
-    return result;
-  } else {
-    ERROR("Register not found in address table!");
-    throw xhal::utils::Exception(strcat("XHAL XML exception: can't find node", regName.c_str()));
   }
+  if (m_cacheEnabled && !m_cache.update(regName, result))
+  {
+    // the node is only needed the first time the register is read
+    auto node = m_backend->getNode(regName);
+    if (node) m_cache.insert(regName, address, result, xhal::utils::parsePermission(node->permission.c_str()), node->isCacheable);
+  }
+  return result;
 }
 
 uint32_t xhal::XHALInterface::readReg(uint32_t address)
@@ -151,57 +175,347 @@ uint32_t xhal::XHALInterface::readReg(uint32_t address)
   return result;
 }
 
-void xhal::XHALInterface::writeReg(std::string regName, uint32_t value)
+xhal::AsyncRPCClient& xhal::XHALInterface::async()
 {
-  if (auto t_node = m_parser->getNode(regName.c_str()))
+  if (m_async) return *m_async;
+  std::unique_ptr<xhal::AsyncRPCClient> client(new xhal::AsyncRPCClient(m_pipelineDepth));
+  try {
+    client->connect(m_board_domain_name);
+    ASSERT(client->loadModule("memory", "memory v1.0.1"));
+  }
+  catch (wisc::RPCSvc::RPCException &e) {
+    ERROR("Caught exception: " << e.message.c_str());
+    throw xhal::utils::Exception(("RPC exception: " + e.message).c_str());
+  }
+  DEBUG("Asynchronous connections open, depth " << m_pipelineDepth);
+  m_async = std::move(client);
+  return *m_async;
+}
+
+namespace {
+  /**
+   * @brief converts the failure of an asynchronous request to the exception thrown by the synchronous methods
+   */
+  std::exception_ptr asyncError(const wisc::RPCMsg& response, std::exception_ptr error)
   {
-    m_node = t_node.value();
-    if (m_node.mask == 0xFFFFFFFF)
-    {
-      req = wisc::RPCMsg("memory.write");
-      req.set_word("address", m_node.real_address);
-      req.set_word("count", 1);
-      req.set_word("data", value);
+    if (error) {
       try {
-      	rsp = rpc.call_method(req);
-      }
-      STANDARD_CATCH;
-      if (rsp.get_key_exists("error"))
-      {
-        ERROR("RPC response returned error, writeReg failed"); 
-        throw xhal::utils::Exception("Error during register access");
+        std::rethrow_exception(error);
+      } catch (wisc::RPCSvc::RPCException &e) {
+        return std::make_exception_ptr(xhal::utils::Exception(("RPC exception: " + e.message).c_str()));
       }
-    } else {
-      uint32_t current_val = this->readReg(m_node.real_address);
-      int shift_amount = 0;
-      uint32_t mask = m_node.mask;
-      for (int i = 0; i < 32; i++)
-      {
-        if (mask & 1) 
-        {
-          break;
-        } else {
-          shift_amount +=1;
-          mask = mask >> 1;
+    }
+    if (response.get_key_exists("error")) return std::make_exception_ptr(xhal::utils::Exception("Error during register access"));
+    return std::exception_ptr();
+  }
+}
+
+std::future<uint32_t> xhal::XHALInterface::readRegAsync(const std::string& regName)
+{
+  auto result = std::make_shared<std::promise<uint32_t> >();
+  uint32_t address, mask, cached;
+  if (m_cacheEnabled && m_cache.get(regName, cached))
+  {
+    result->set_value(cached);
+    return result->get_future();
+  }
+  findRegister(regName, address, mask);
+  wisc::RPCMsg request("memory.read");
+  request.set_word("address", address);
+  request.set_word("count", 1);
+  try {
+    // runs on a thread of the client, must not touch the interface; the accesses to a word are kept in order
+    async().call(request, [result, mask](uint64_t, const wisc::RPCMsg& response, std::exception_ptr error) {
+      std::exception_ptr failure = asyncError(response, error);
+      if (!failure) {
+        try {
+          if (response.get_word_array_size("data") != 1) throw xhal::utils::Exception("Unexpected RPC response size");
+          uint32_t word;
+          response.get_word_array("data", &word);
+          result->set_value((word & mask) >> maskShift(mask));
+          return;
+        } catch (wisc::RPCMsg::BadKeyException &e) {
+          failure = std::make_exception_ptr(xhal::utils::Exception(("RPC exception: " + e.key).c_str()));
+        } catch (xhal::utils::Exception &e) {
+          failure = std::current_exception();
         }
       }
-      uint32_t val_to_write = value << shift_amount;
-      val_to_write = (val_to_write & m_node.mask) | (current_val & ~m_node.mask);
-      req = wisc::RPCMsg("memory.write");
-      req.set_word("address", m_node.real_address);
-      req.set_word_array("data", &val_to_write,1);
-      try {
-      	rsp = rpc.call_method(req);
-      }
-      STANDARD_CATCH;
-      if (rsp.get_key_exists("error"))
-      {
-        ERROR("RPC response returned error, writeReg failed"); 
-        throw xhal::utils::Exception("Error during register access");
-      }
+      result->set_exception(failure);
+    }, address);
+  }
+  STANDARD_CATCH;
+  return result->get_future();
+}
+
+std::future<void> xhal::XHALInterface::writeRegAsync(const std::string& regName, uint32_t value)
+{
+  auto result = std::make_shared<std::promise<void> >();
+  uint32_t address, mask;
+  findRegister(regName, address, mask);
+  m_cache.invalidate(address);
+  wisc::RPCMsg request;
+  if (mask == 0xFFFFFFFF)
+  {
+    request = wisc::RPCMsg("memory.write");
+    request.set_word("address", address);
+    request.set_word_array("data", &value, 1);
+  } else if (m_rmwSupport != Support::YES) {
+    // the fallback to a read and a write needs the synchronous connection, after the requests already in flight
+    if (m_async) m_async->flush();
+    try {
+      rmwReg(address, ~mask, (value << maskShift(mask)) & mask);
+      result->set_value();
+    } catch (xhal::utils::Exception &e) {
+      result->set_exception(std::current_exception());
     }
+    return result->get_future();
   } else {
+    request = wisc::RPCMsg("memory.rmw");
+    request.set_word("address", address);
+    request.set_word("and_mask", ~mask);
+    request.set_word("or_value", (value << maskShift(mask)) & mask);
+  }
+  try {
+    async().call(request, [result](uint64_t, const wisc::RPCMsg& response, std::exception_ptr error) {
+      std::exception_ptr failure = asyncError(response, error);
+      if (failure) result->set_exception(failure);
+      else result->set_value();
+    }, address);
+  }
+  STANDARD_CATCH;
+  return result->get_future();
+}
+
+void xhal::XHALInterface::writeReg(uint32_t address, uint32_t value)
+{
+  m_cache.invalidate(address);
+  req = wisc::RPCMsg("memory.write");
+  req.set_word("address", address);
+  req.set_word_array("data", &value, 1);
+  try {
+    rsp = rpc.call_method(req);
+  }
+  STANDARD_CATCH;
+  if (rsp.get_key_exists("error"))
+  {
+    ERROR("RPC response returned error, writeReg failed");
+    throw xhal::utils::Exception("Error during register access");
+  }
+}
+
+bool xhal::XHALInterface::callOptional(Support& support)
+{
+  if (support == Support::NO) return false;
+  try {
+    rsp = rpc.call_method(req);
+  }
+  catch (wisc::RPCSvc::RPCErrorException &e) {
+    WARN("Board does not support " << req.get_method() << " (" << e.message << "), falling back to read and write");
+    support = Support::NO;
+    return false;
+  }
+  catch (wisc::RPCSvc::RPCException &e) {
+    ERROR("Caught exception: " << e.message.c_str());
+    throw xhal::utils::Exception(("RPC exception: " + e.message).c_str());
+  }
+  support = Support::YES;
+  return true;
+}
+
+uint32_t xhal::XHALInterface::readModifyWrite(uint32_t address, uint32_t andMask, uint32_t orValue)
+{
+  const uint32_t previous = readReg(address);
+  writeReg(address, (previous & andMask) | orValue);
+  return previous;
+}
+
+uint32_t xhal::XHALInterface::rmwReg(uint32_t address, uint32_t andMask, uint32_t orValue)
+{
+  m_cache.invalidate(address);
+  req = wisc::RPCMsg("memory.rmw");
+  req.set_word("address", address);
+  req.set_word("and_mask", andMask);
+  req.set_word("or_value", orValue);
+  if (!callOptional(m_rmwSupport)) return readModifyWrite(address, andMask, orValue);
+  uint32_t result;
+  if (rsp.get_key_exists("error"))
+  {
+    ERROR("RPC response returned error, rmwReg failed");
+    throw xhal::utils::Exception("Error during register access");
+  } else {
+    try{
+      ASSERT(rsp.get_word_array_size("data") == 1);
+      rsp.get_word_array("data", &result);
+    }
+    STANDARD_CATCH;
+  }
+  return result;
+}
+
+void xhal::XHALInterface::rmwRegs(const uint32_t* addresses, const uint32_t* andMasks, const uint32_t* orValues,
+                                  uint32_t* previous, uint32_t count)
+{
+  for (uint32_t i = 0; i < count; ++i) m_cache.invalidate(addresses[i]);
+  req = wisc::RPCMsg("extras.rmwlist");
+  req.set_word_array("addresses", const_cast<uint32_t*>(addresses), count);
+  req.set_word_array("and_masks", const_cast<uint32_t*>(andMasks), count);
+  req.set_word_array("or_values", const_cast<uint32_t*>(orValues), count);
+  req.set_word("count", count);
+  if (!callOptional(m_rmwListSupport))
+  {
+    for (uint32_t i = 0; i < count; ++i) previous[i] = rmwReg(addresses[i], andMasks[i], orValues[i]);
+    return;
+  }
+  if (rsp.get_key_exists("error"))
+  {
+    ERROR("RPC response returned error, rmwRegs failed");
+    throw xhal::utils::Exception("Error during register access");
+  } else {
+    try{
+      ASSERT(rsp.get_word_array_size("data") == count);
+      rsp.get_word_array("data", previous);
+    }
+    STANDARD_CATCH;
+  }
+}
+
+void xhal::XHALInterface::readBlock(uint32_t address, uint32_t* data, uint32_t count)
+{
+  req = wisc::RPCMsg("extras.blockread");
+  req.set_word("address", address);
+  req.set_word("count", count);
+  try {
+    rsp = rpc.call_method(req);
+  }
+  STANDARD_CATCH;
+  if (rsp.get_key_exists("error"))
+  {
+    ERROR("RPC response returned error, readBlock failed");
+    throw xhal::utils::Exception("Error during register access");
+  } else {
+    try{
+      ASSERT(rsp.get_word_array_size("data") == count);
+      rsp.get_word_array("data", data);
+    }
+    STANDARD_CATCH;
+  }
+}
+
+void xhal::XHALInterface::writeBlock(uint32_t address, const uint32_t* data, uint32_t count)
+{
+  m_cache.invalidate(address, count);
+  req = wisc::RPCMsg("memory.write");
+  req.set_word("address", address);
+  req.set_word_array("data", const_cast<uint32_t*>(data), count);
+  try {
+    rsp = rpc.call_method(req);
+  }
+  STANDARD_CATCH;
+  if (rsp.get_key_exists("error"))
+  {
+    ERROR("RPC response returned error, writeBlock failed");
+    throw xhal::utils::Exception("Error during register access");
+  }
+}
+
+void xhal::XHALInterface::readList(const uint32_t* addresses, uint32_t* data, uint32_t count)
+{
+  req = wisc::RPCMsg("extras.listread");
+  req.set_word_array("addresses", const_cast<uint32_t*>(addresses), count);
+  req.set_word("count", count);
+  try {
+    rsp = rpc.call_method(req);
+  }
+  STANDARD_CATCH;
+  if (rsp.get_key_exists("error"))
+  {
+    ERROR("RPC response returned error, readList failed");
+    throw xhal::utils::Exception("Error during register access");
+  } else {
+    try{
+      ASSERT(rsp.get_word_array_size("data") == count);
+      rsp.get_word_array("data", data);
+    }
+    STANDARD_CATCH;
+  }
+}
+
+xhal::RegisterDesc xhal::XHALInterface::getRegister(const std::string& regName)
+{
+  auto node = m_backend->getNode(regName);
+  if (!node)
+  {
     ERROR("Register not found in address table!");
-    throw xhal::utils::Exception(strcat("XHAL XML exception: can't find node", regName.c_str()));
+    throw xhal::utils::Exception(("XHAL XML exception: can't find node " + regName).c_str());
+  }
+  const uint8_t permission = static_cast<uint8_t>(xhal::utils::parsePermission(node->permission.c_str()));
+  return RegisterDesc{node->real_address, node->mask, maskShift(node->mask), maskWidth(node->mask), permission};
+}
+
+std::vector<uint32_t> xhal::XHALInterface::readRegs(const std::vector<std::string>& regNames)
+{
+  std::vector<RegisterDesc> regs(regNames.size());
+  for (size_t i = 0; i < regNames.size(); ++i)
+  {
+    findRegister(regNames[i], regs[i].address, regs[i].mask);
+    regs[i].shift = maskShift(regs[i].mask);
+  }
+  return readRegs(regs);
+}
+
+void xhal::XHALInterface::readPlan(const xhal::utils::ReadPlan& plan, uint32_t* words)
+{
+  DEBUG("Reading " << plan.wordCount() << " words in " << plan.blocks().size() << " blocks and "
+        << plan.list().size() << " listed words");
+  for (auto const& block: plan.blocks()) readBlock(block.address, words + block.offset, block.count);
+  if (!plan.list().empty()) readList(plan.list().data(), words + plan.listOffset(), plan.list().size());
+}
+
+std::vector<uint32_t> xhal::XHALInterface::readRegs(const std::vector<RegisterDesc>& regs)
+{
+  const size_t n = regs.size();
+  std::vector<uint32_t> values(n);
+  if (n == 0) return values;
+  std::vector<uint32_t> addresses(n);
+  for (size_t i = 0; i < n; ++i) addresses[i] = regs[i].address;
+  const xhal::utils::ReadPlan plan(addresses, m_readCost);
+  std::vector<uint32_t> words(plan.wordCount());
+  readPlan(plan, words.data());
+
+  // gather the words first so that the mask and shift loop runs over plain arrays
+  std::vector<uint32_t> gathered(n), masks(n), shifts(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    gathered[i] = words[plan.index(i)];
+    masks[i] = regs[i].mask;
+    shifts[i] = regs[i].shift;
+  }
+  for (size_t i = 0; i < n; ++i) values[i] = (gathered[i] & masks[i]) >> shifts[i];
+  return values;
+}
+
+void xhal::XHALInterface::writeReg(const std::string& regName, uint32_t value)
+{
+  uint32_t address, regMask;
+  findRegister(regName, address, regMask);
+  if (regMask == 0xFFFFFFFF)
+  {
+    m_cache.invalidate(address);
+    req = wisc::RPCMsg("memory.write");
+    req.set_word("address", address);
+    req.set_word("count", 1);
+    req.set_word("data", value);
+    try {
+    	rsp = rpc.call_method(req);
+    }
+    STANDARD_CATCH;
+    if (rsp.get_key_exists("error"))
+    {
+      ERROR("RPC response returned error, writeReg failed"); 
+      throw xhal::utils::Exception("Error during register access");
+    }
+  } else {
+    uint32_t val_to_write = (value << maskShift(regMask)) & regMask;
+    rmwReg(address, ~regMask, val_to_write);
   }
 }
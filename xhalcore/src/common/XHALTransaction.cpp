@@ -0,0 +1,73 @@
+#include "xhal/XHALTransaction.h"
+
+#include <vector>
+
+void xhal::Transaction::write(const std::string& regName, uint32_t value)
+{
+  const RegisterDesc reg = m_interface.getRegister(regName);
+  add(reg.address, reg.mask, reg.insert(0, value));
+}
+
+void xhal::Transaction::write(const RegisterDesc& reg, uint32_t value)
+{
+  add(reg.address, reg.mask, reg.insert(0, value));
+}
+
+void xhal::Transaction::add(uint32_t address, uint32_t mask, uint32_t value)
+{
+  Word & word = m_words[address];
+  word.value = (word.value & ~mask) | (value & mask);
+  word.mask |= mask;
+  ++m_writes;
+}
+
+void xhal::Transaction::clear()
+{
+  m_words.clear();
+  m_writes = 0;
+}
+
+xhal::Transaction::Stats xhal::Transaction::commit()
+{
+  Stats stats = Stats();
+  stats.writes = m_writes;
+  stats.words = m_words.size();
+
+  // the map is sorted by address, consecutive whole words form one request
+  std::vector<uint32_t> block, addresses, andMasks, orValues;
+  uint32_t base = 0;
+  for (auto it = m_words.begin(); it != m_words.end(); ++it)
+  {
+    if (it->second.mask != 0xFFFFFFFF)
+    {
+      // the other bits of the word are preserved by the board
+      addresses.push_back(it->first);
+      andMasks.push_back(~it->second.mask);
+      orValues.push_back(it->second.value);
+      continue;
+    }
+    if (!block.empty() && it->first != base + 4 * block.size())
+    {
+      m_interface.writeBlock(base, block.data(), block.size());
+      ++stats.writeRequests;
+      block.clear();
+    }
+    if (block.empty()) base = it->first;
+    block.push_back(it->second.value);
+  }
+  if (!block.empty())
+  {
+    m_interface.writeBlock(base, block.data(), block.size());
+    ++stats.writeRequests;
+  }
+  if (!addresses.empty())
+  {
+    std::vector<uint32_t> previous(addresses.size());
+    m_interface.rmwRegs(addresses.data(), andMasks.data(), orValues.data(), previous.data(), addresses.size());
+    ++stats.rmwRequests;
+  }
+
+  clear();
+  m_last = stats;
+  return stats;
+}
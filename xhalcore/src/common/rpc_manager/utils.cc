@@ -1,7 +1,19 @@
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <unistd.h>
 #include "xhal/rpc/utils.h"
+#include "xhal/utils/XHALXMLParser.h"
+#include "xhal/utils/XHALFingerprint.h"
+#include "xhal/utils/XHALReadPlan.h"
 
 wisc::RPCSvc* getRPCptr(){return &rpc;}
 
+// cleared on the first RPC error from memory.rmw / extras.rmwlist, boards without them get a read and a write
+static bool rmwSupported = true;
+static bool rmwListSupported = true;
+
 DLLEXPORT uint32_t deinit()
 {
     try {
@@ -21,6 +33,8 @@ DLLEXPORT uint32_t deinit()
 
 DLLEXPORT uint32_t init(char * hostname)
 {
+    rmwSupported = true;
+    rmwListSupported = true;
     try {
         rpc.connect(hostname);
     }
@@ -49,8 +63,187 @@ DLLEXPORT uint32_t init(char * hostname)
     return 0;
 }
 
+namespace {
+    void appendHash(std::vector<uint32_t> & words, uint64_t hash)
+    {
+        words.push_back(hash & 0xffffffff);
+        words.push_back(hash >> 32);
+    }
+
+    uint64_t getHash(const std::vector<uint32_t> & words, size_t i)
+    {
+        return words[2*i] | (uint64_t(words[2*i+1]) << 32);
+    }
+
+    /*
+     * Changes sent to the board: register records, node fingerprints and removed subtrees
+     */
+    struct ATDBDelta
+    {
+        // length of the root node name and its dot, left out of the keys
+        size_t prefix;
+        std::vector<std::string> names;
+        std::vector<uint32_t> addresses;
+        std::vector<uint32_t> masks;
+        std::vector<std::string> permissions;
+        std::vector<std::string> fpNames;
+        std::vector<uint32_t> fpHashes;
+        std::vector<std::string> removed;
+
+        explicit ATDBDelta(size_t rootLength) : prefix(rootLength) {}
+
+        /*
+         * Register database key of the node, empty for the root
+         */
+        std::string key(const xhal::utils::NodeStore & store, uint32_t i) const
+        {
+            if (i == xhal::utils::NodeStore::NO_NODE) return std::string();
+            const std::string name = store.name(i);
+            return name.size() > prefix ? name.substr(prefix) : std::string();
+        }
+
+        void addNode(const xhal::utils::NodeStore & store, const xhal::utils::NodeFingerprint & fp, uint32_t i, bool record)
+        {
+            const std::string name = key(store, i);
+            if (record && store.permission(i) != xhal::utils::NodePermission::NONE) {
+                names.push_back(name);
+                addresses.push_back(store.realAddress(i));
+                masks.push_back(store.mask(i));
+                permissions.push_back(xhal::utils::permissionName(store.permission(i)));
+            }
+            fpNames.push_back(name);
+            appendHash(fpHashes, fp.record(i));
+            appendHash(fpHashes, fp.subtree(i));
+        }
+
+        void addSubtree(const xhal::utils::NodeStore & store, const xhal::utils::NodeFingerprint & fp, uint32_t i)
+        {
+            std::vector<uint32_t> nodes(1, i);
+            store.appendDescendants(i, nodes);
+            for (auto n: nodes) addNode(store, fp, n, true);
+        }
+    };
+}
+
+DLLEXPORT uint32_t sync_atdb(char * xmlfilename)
+{
+    // the name is the path of the table on the board, the host needs the same file to compute the fingerprints
+    if (access(xmlfilename, R_OK) != 0) {
+        printf("Address table %s is not readable on this host, no delta update\n", xmlfilename);
+        return 1;
+    }
+    xhal::utils::XHALXMLParser parser(xmlfilename);
+    parser.setLogLevel(0);
+    parser.parseXML();
+    const xhal::utils::NodeStore & store = parser.getNodeStore();
+    const xhal::utils::NodeFingerprint fp(store);
+
+    // a single top level node is the table root, the board keys leave it out as XHALATDBBuilder::build() does
+    uint32_t rootNode = xhal::utils::NodeStore::NO_NODE;
+    size_t roots = 0;
+    for (auto c: store.children(xhal::utils::NodeStore::NO_NODE)) {
+        rootNode = c;
+        ++roots;
+    }
+    if (roots != 1) rootNode = xhal::utils::NodeStore::NO_NODE;
+    ATDBDelta delta(rootNode == xhal::utils::NodeStore::NO_NODE ? 0 : std::strlen(store.token(rootNode)) + 1);
+
+    // walk down the subtrees whose hashes differ, one request per level of the tree
+    std::vector<uint32_t> level(1, rootNode);
+    bool top = true;
+    while (!level.empty()) {
+        std::vector<std::string> names;
+        for (auto n: level) names.push_back(delta.key(store, n));
+        req = wisc::RPCMsg("utils.getATDBFingerprint");
+        req.set_string("at_xml", xmlfilename);
+        req.set_string_array("names", names);
+        try {
+            rsp = rpc.call_method(req);
+        }
+        STANDARD_CATCH;
+
+        if (rsp.get_key_exists("error")) {
+            printf("Caught an error: %s\n", (rsp.get_string("error")).c_str());
+            return 1;
+        }
+        std::vector<std::string> tokens;
+        std::vector<uint32_t> counts, records, subtrees;
+        try {
+            if (top && rsp.get_key_exists("fingerprint")) {
+                ASSERT(rsp.get_word_array_size("fingerprint") == 2);
+                if (getHash(rsp.get_word_array("fingerprint"), 0) == fp.root()) {
+                    printf("Address table database is up to date\n");
+                    return 0;
+                }
+            }
+            tokens = rsp.get_string_array("children");
+            counts = rsp.get_word_array("counts");
+            records = rsp.get_word_array("record_hashes");
+            subtrees = rsp.get_word_array("subtree_hashes");
+        }
+        STANDARD_CATCH;
+        ASSERT(counts.size() == level.size());
+        ASSERT(records.size() == 2*tokens.size() && subtrees.size() == 2*tokens.size());
+
+        std::vector<uint32_t> next;
+        size_t first = 0;
+        for (size_t k = 0; k < level.size(); ++k) {
+            ASSERT(first + counts[k] <= tokens.size());
+            std::map<std::string, size_t> board;
+            for (size_t b = first; b < first + counts[k]; ++b) board[tokens[b]] = b;
+            for (auto c: store.children(level[k])) {
+                auto found = board.find(store.token(c));
+                if (found == board.end()) {
+                    delta.addSubtree(store, fp, c);
+                    continue;
+                }
+                const size_t b = found->second;
+                board.erase(found);
+                if (getHash(subtrees, b) == fp.subtree(c)) continue;
+                delta.addNode(store, fp, c, getHash(records, b) != fp.record(c));
+                next.push_back(c);
+            }
+            // left over board nodes are not in the table anymore
+            for (auto const& b: board) delta.removed.push_back(names[k].empty() ? b.first : names[k] + "." + b.first);
+            first += counts[k];
+        }
+        level.swap(next);
+        top = false;
+    }
+
+    std::vector<uint32_t> root;
+    appendHash(root, fp.root());
+    req = wisc::RPCMsg("utils.updateATDBDelta");
+    req.set_string("at_xml", xmlfilename);
+    req.set_word_array("fingerprint", root);
+    req.set_string_array("names", delta.names);
+    req.set_word_array("addresses", delta.addresses);
+    req.set_word_array("masks", delta.masks);
+    req.set_string_array("permissions", delta.permissions);
+    req.set_string_array("fp_names", delta.fpNames);
+    req.set_word_array("fp_hashes", delta.fpHashes);
+    req.set_string_array("removed", delta.removed);
+    try {
+        rsp = rpc.call_method(req);
+    }
+    STANDARD_CATCH;
+
+    if (rsp.get_key_exists("error")) {
+        printf("Caught an error: %s\n", (rsp.get_string("error")).c_str());
+        return 1;
+    }
+    printf("Address table database updated: %zu records changed, %zu subtrees removed\n", delta.names.size(), delta.removed.size());
+    return 0;
+}
+
 DLLEXPORT uint32_t update_atdb(char * xmlfilename)
 {
+    try {
+        if (sync_atdb(xmlfilename) == 0) return 0;
+    } catch (xhal::utils::Exception &e) {
+        printf("Caught exception: %s\n", e.what());
+    }
+    printf("Delta update of the address table database failed, sending the whole table\n");
     req = wisc::RPCMsg("utils.update_address_table");
     req.set_string("at_xml", xmlfilename);
     try {
@@ -158,6 +351,21 @@ DLLEXPORT uint32_t getList(uint32_t* addresses, uint32_t* result, ssize_t size)
     return 0;
 }
 
+DLLEXPORT uint32_t getPlanned(uint32_t* addresses, uint32_t* result, ssize_t size)
+{
+    const xhal::utils::ReadPlan plan(std::vector<uint32_t>(addresses, addresses + size));
+    std::vector<uint32_t> words(plan.wordCount());
+    for (auto const& block: plan.blocks()) {
+        if (getBlock(block.address, words.data() + block.offset, block.count)) return 1;
+    }
+    if (!plan.list().empty()) {
+        std::vector<uint32_t> list(plan.list());
+        if (getList(list.data(), words.data() + plan.listOffset(), list.size())) return 1;
+    }
+    for (ssize_t i = 0; i < size; ++i) result[i] = words[plan.index(i)];
+    return 0;
+}
+
 DLLEXPORT uint32_t putReg(uint32_t address, uint32_t value)
 {
     req = wisc::RPCMsg("memory.write");
@@ -172,6 +380,105 @@ DLLEXPORT uint32_t putReg(uint32_t address, uint32_t value)
     } else return value;
 }
 
+namespace {
+    /*
+     * Single word access reporting the status apart from the data: 0 on success, non zero on any failure
+     */
+    uint32_t readWord(uint32_t address, uint32_t & word)
+    {
+        req = wisc::RPCMsg("memory.read");
+        req.set_word("address", address);
+        req.set_word("count", 1);
+        try {
+            rsp = rpc.call_method(req);
+            if (rsp.get_key_exists("error") || rsp.get_word_array_size("data") != 1) return 1;
+            rsp.get_word_array("data", &word);
+        }
+        STANDARD_CATCH;
+        return 0;
+    }
+
+    uint32_t writeWord(uint32_t address, uint32_t value)
+    {
+        req = wisc::RPCMsg("memory.write");
+        req.set_word("address", address);
+        req.set_word_array("data", &value, 1);
+        try {
+            rsp = rpc.call_method(req);
+        }
+        STANDARD_CATCH;
+        return rsp.get_key_exists("error") ? 1 : 0;
+    }
+}
+
+DLLEXPORT uint32_t putRegMasked(uint32_t address, uint32_t mask, uint32_t value)
+{
+    uint32_t shift = 0;
+    while (shift < 32 && !((mask >> shift) & 1)) ++shift;
+    const uint32_t orValue = shift < 32 ? (value << shift) & mask : 0;
+    if (mask == 0xFFFFFFFF) return writeWord(address, orValue) ? 1 : 0;
+    if (rmwSupported) {
+        req = wisc::RPCMsg("memory.rmw");
+        req.set_word("address", address);
+        req.set_word("and_mask", ~mask);
+        req.set_word("or_value", orValue);
+        try {
+            rsp = rpc.call_method(req);
+            return rsp.get_key_exists("error") ? 1 : 0;
+        }
+        catch (wisc::RPCSvc::RPCErrorException &e) {
+            printf("memory.rmw is not supported (%s), falling back to read and write\n", e.message.c_str());
+            rmwSupported = false;
+        }
+        catch (wisc::RPCSvc::RPCException &e) {
+            printf("Caught exception: %s\n", e.message.c_str());
+            return 1;
+        }
+    }
+    // the other fields of the word are only written back if it was read
+    uint32_t word;
+    if (readWord(address, word)) return 1;
+    return writeWord(address, (word & ~mask) | orValue) ? 1 : 0;
+}
+
+DLLEXPORT uint32_t putRegsMasked(uint32_t* addresses, uint32_t* masks, uint32_t* values, ssize_t size)
+{
+    if (!rmwListSupported) {
+        for (ssize_t i = 0; i < size; ++i) {
+            if (putRegMasked(addresses[i], masks[i], values[i])) return 1;
+        }
+        return 0;
+    }
+    std::vector<uint32_t> andMasks(size), orValues(size);
+    for (ssize_t i = 0; i < size; ++i) {
+        uint32_t shift = 0;
+        while (shift < 32 && !((masks[i] >> shift) & 1)) ++shift;
+        andMasks[i] = ~masks[i];
+        orValues[i] = shift < 32 ? (values[i] << shift) & masks[i] : 0;
+    }
+    req = wisc::RPCMsg("extras.rmwlist");
+    req.set_word_array("addresses", addresses, size);
+    req.set_word_array("and_masks", andMasks);
+    req.set_word_array("or_values", orValues);
+    req.set_word("count", size);
+    try {
+        rsp = rpc.call_method(req);
+    }
+    catch (wisc::RPCSvc::RPCErrorException &e) {
+        printf("extras.rmwlist is not supported (%s), falling back to single writes\n", e.message.c_str());
+        rmwListSupported = false;
+        return putRegsMasked(addresses, masks, values, size);
+    }
+    catch (wisc::RPCSvc::RPCException &e) {
+        printf("Caught exception: %s\n", e.message.c_str());
+        return 1;
+    }
+    if (rsp.get_key_exists("error")) {
+        return 1;
+    }
+    return 0;
+}
+
 uint32_t count_1bits(uint32_t x)
 {
     x = x - ((x >> 1) & 0x55555555);
@@ -0,0 +1,321 @@
+#include "xhal/utils/XHALATDB.h"
+#include "xhal/utils/Exception.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace {
+  const char * const NODES_DB = "xhal_nodes";
+  const char * const META_DB = "xhal_meta";
+
+  void check(int rc, const char * what)
+  {
+    if (rc != MDB_SUCCESS) {
+      throw xhal::utils::Exception((std::string("XHALATDB: ") + what + ": " + mdb_strerror(rc)).c_str());
+    }
+  }
+
+  MDB_val toVal(const void * data, size_t size)
+  {
+    MDB_val val;
+    val.mv_data = const_cast<void *>(data);
+    val.mv_size = size;
+    return val;
+  }
+
+  /*
+   * Environments in use in the process, keyed by canonical path. An expired entry is being closed by its last user.
+   */
+  std::mutex environmentsMutex;
+  std::condition_variable environmentClosed;
+  std::map<std::string, std::weak_ptr<xhal::utils::XHALATDBEnvironment> > environments;
+
+  /*
+   * Read transaction renewed from the reset handle for the scope, the map is not resized meanwhile
+   */
+  class ReadScope
+  {
+    public:
+      ReadScope(xhal::utils::XHALATDBEnvironment & env, MDB_txn * txn) : m_lock(env.mapMutex()), m_txn(txn)
+      {
+        int rc = mdb_txn_renew(txn);
+        if (rc == MDB_MAP_RESIZED) {
+          // grown by another process, the new size is adopted by the next renewal
+          m_lock.unlock();
+          env.resize(0);
+          m_lock.lock();
+          rc = mdb_txn_renew(txn);
+        }
+        check(rc, "mdb_txn_renew");
+      }
+      ~ReadScope() {mdb_txn_reset(m_txn);}
+
+    private:
+      std::shared_lock<std::shared_timed_mutex> m_lock;
+      MDB_txn * m_txn;
+  };
+}
+
+std::shared_ptr<xhal::utils::XHALATDBEnvironment> xhal::utils::XHALATDBEnvironment::acquire(const std::string& path, bool writable, size_t mapSize)
+{
+  // the same environment reached through different paths is opened once
+  char resolved[PATH_MAX];
+  const std::string key = realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+  std::shared_ptr<XHALATDBEnvironment> env;
+  {
+    std::unique_lock<std::mutex> lock(environmentsMutex);
+    while (true) {
+      auto it = environments.find(key);
+      if (it == environments.end()) break;
+      env = it->second.lock();
+      if (env) break;
+      // LMDB must not have it open twice, wait until it is closed
+      environmentClosed.wait(lock);
+    }
+    if (!env) {
+      env.reset(new XHALATDBEnvironment(key));
+      // opened under the lock, so that the concurrent users of the path wait for it
+      try {
+        env->open(writable, mapSize);
+      } catch (...) {
+        // the destructor takes the lock
+        lock.unlock();
+        env.reset();
+        throw;
+      }
+      environments[key] = env;
+      return env;
+    }
+  }
+  if (writable && !env->writable()) {
+    throw xhal::utils::Exception(("XHALATDB: " + path + " is open read-only in this process, release its readers first").c_str());
+  }
+  if (writable) {
+    MDB_envinfo info;
+    check(mdb_env_info(env->env(), &info), "mdb_env_info");
+    if (mapSize > info.me_mapsize) env->resize(mapSize);
+  }
+  return env;
+}
+
+xhal::utils::XHALATDBEnvironment::~XHALATDBEnvironment()
+{
+  std::lock_guard<std::mutex> lock(environmentsMutex);
+  // the entry is already gone if the open failed
+  auto it = environments.find(m_path);
+  if (it != environments.end() && it->second.expired()) environments.erase(it);
+  if (m_env) mdb_env_close(m_env);
+  environmentClosed.notify_all();
+}
+
+void xhal::utils::XHALATDBEnvironment::open(bool writable, size_t mapSize)
+{
+  MDB_env * env;
+  check(mdb_env_create(&env), "mdb_env_create");
+  m_env = env;
+  check(mdb_env_set_maxdbs(env, 2), "mdb_env_set_maxdbs");
+  if (mapSize) check(mdb_env_set_mapsize(env, mapSize), "mdb_env_set_mapsize");
+  // the transactions are not bound to the thread which started them
+  check(mdb_env_open(env, m_path.c_str(), (writable ? 0 : MDB_RDONLY) | MDB_NOTLS, 0664), ("mdb_env_open " + m_path).c_str());
+  m_writable = writable;
+  // database handles opened in a committed transaction stay valid for the environment lifetime
+  MDB_txn * txn;
+  check(mdb_txn_begin(env, nullptr, writable ? 0 : MDB_RDONLY, &txn), "mdb_txn_begin");
+  const unsigned int flags = writable ? MDB_CREATE : 0;
+  int rc = mdb_dbi_open(txn, NODES_DB, flags, &m_nodes);
+  if (rc == MDB_SUCCESS) rc = mdb_dbi_open(txn, META_DB, flags, &m_meta);
+  if (rc != MDB_SUCCESS) {
+    mdb_txn_abort(txn);
+    check(rc, ("no register database in " + m_path).c_str());
+  }
+  check(mdb_txn_commit(txn), "mdb_txn_commit");
+}
+
+void xhal::utils::XHALATDBEnvironment::resize(size_t mapSize)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(m_mapMutex);
+  check(mdb_env_set_mapsize(m_env, mapSize), "mdb_env_set_mapsize");
+}
+
+xhal::utils::XHALATDBBuilder::XHALATDBBuilder(const std::string& path):
+  m_path(path)
+{
+}
+
+size_t xhal::utils::XHALATDBBuilder::build(uint64_t hash, const NodeStore & store)
+{
+  if (mkdir(m_path.c_str(), 0775) != 0 && errno != EEXIST) {
+    throw xhal::utils::Exception(("XHALATDB: cannot create " + m_path).c_str());
+  }
+
+  // a single top level node is the table root, which is left out of the keys
+  std::string root;
+  uint32_t rootIndex = NodeStore::NO_NODE;
+  size_t roots = 0;
+  for (uint32_t i = 0; i < store.size(); ++i) {
+    if (store.isRemoved(i) || store.parent(i) != NodeStore::NO_NODE) continue;
+    rootIndex = i;
+    ++roots;
+  }
+  if (roots == 1) {
+    root = store.token(rootIndex);
+  } else {
+    rootIndex = NodeStore::NO_NODE;
+  }
+  std::vector<std::pair<std::string, uint32_t> > keys;
+  keys.reserve(store.size());
+  std::string name;
+  // leaf pages are filled completely with MDB_APPEND, the pages of the replaced content are released on commit
+  size_t estimate = 1 << 20;
+  for (uint32_t i = 0; i < store.size(); ++i) {
+    if (store.isRemoved(i) || i == rootIndex) continue;
+    name.clear();
+    store.appendName(i, name);
+    keys.emplace_back(root.empty() ? name : name.substr(root.size() + 1), i);
+    estimate += (keys.back().first.size() + sizeof(ATDBRecord) + 16) * 3 / 2;
+  }
+  // same order as the default LMDB key comparison (memcmp, shorter first)
+  std::sort(keys.begin(), keys.end());
+  struct stat st;
+  if (stat((m_path + "/data.mdb").c_str(), &st) == 0) estimate += st.st_size;
+
+  std::shared_ptr<XHALATDBEnvironment> env = XHALATDBEnvironment::acquire(m_path, true, estimate);
+  int rc;
+  while ((rc = write(*env, hash, root, keys, store)) == MDB_MAP_FULL) {
+    estimate *= 2;
+    env->resize(estimate);
+  }
+  check(rc, "write");
+  return keys.size();
+}
+
+int xhal::utils::XHALATDBBuilder::write(XHALATDBEnvironment& env, uint64_t hash, const std::string& root,
+                                        const std::vector<std::pair<std::string, uint32_t> >& keys, const NodeStore & store)
+{
+  MDB_txn * txn;
+  const MDB_dbi dbi = env.nodes();
+  const MDB_dbi meta = env.meta();
+  int rc = mdb_txn_begin(env.env(), nullptr, 0, &txn);
+  if (rc == MDB_MAP_RESIZED) {
+    // grown by another process
+    env.resize(0);
+    rc = mdb_txn_begin(env.env(), nullptr, 0, &txn);
+  }
+  if (rc != MDB_SUCCESS) return rc;
+  if ((rc = mdb_drop(txn, dbi, 0)) != MDB_SUCCESS
+      || (rc = mdb_drop(txn, meta, 0)) != MDB_SUCCESS) {
+    mdb_txn_abort(txn);
+    return rc;
+  }
+  ATDBRecord record;
+  std::memset(&record, 0, sizeof(record));
+  for (auto const& key: keys) {
+    const uint32_t i = key.second;
+    record.address = store.address(i);
+    record.realAddress = store.realAddress(i);
+    record.mask = store.mask(i);
+    record.size = store.nodeSize(i);
+    record.warnMinValue = store.warnMinValue(i);
+    record.errorMinValue = store.errorMinValue(i);
+    record.permission = static_cast<uint8_t>(store.permission(i));
+    record.mode = static_cast<uint8_t>(store.mode(i));
+    record.flags = (store.isModule(i) ? ATDBRecord::FLAG_MODULE : 0) | (store.isCacheable(i) ? ATDBRecord::FLAG_CACHEABLE : 0);
+    record.level = store.level(i);
+    MDB_val k = toVal(key.first.data(), key.first.size());
+    MDB_val v = toVal(&record, sizeof(record));
+    if ((rc = mdb_put(txn, dbi, &k, &v, MDB_APPEND)) != MDB_SUCCESS) {
+      mdb_txn_abort(txn);
+      return rc;
+    }
+  }
+
+  const uint32_t version = VERSION;
+  const std::pair<const char *, MDB_val> metadata[] = {
+    {"content_hash", toVal(&hash, sizeof(hash))},
+    {"root", toVal(root.data(), root.size())},
+    {"version", toVal(&version, sizeof(version))}
+  };
+  for (auto const& m: metadata) {
+    MDB_val k = toVal(m.first, std::strlen(m.first));
+    MDB_val v = m.second;
+    if ((rc = mdb_put(txn, meta, &k, &v, MDB_APPEND)) != MDB_SUCCESS) {
+      mdb_txn_abort(txn);
+      return rc;
+    }
+  }
+  return mdb_txn_commit(txn);
+}
+
+xhal::utils::XHALATDBReader::XHALATDBReader(const std::string& path):
+  m_env(XHALATDBEnvironment::acquire(path, false)),
+  m_txn(nullptr),
+  m_hash(0)
+{
+  // the handle only holds a reader slot while it is reset
+  check(mdb_txn_begin(m_env->env(), nullptr, MDB_RDONLY, &m_txn), "mdb_txn_begin");
+  mdb_txn_reset(m_txn);
+  try {
+    readMeta();
+  } catch (...) {
+    mdb_txn_abort(m_txn);
+    throw;
+  }
+}
+
+xhal::utils::XHALATDBReader::~XHALATDBReader()
+{
+  mdb_txn_abort(m_txn);
+}
+
+void xhal::utils::XHALATDBReader::readMeta()
+{
+  ReadScope scope(*m_env, m_txn);
+  MDB_val k, v;
+  k = toVal("version", 7);
+  uint32_t version = 0;
+  if (mdb_get(m_txn, m_env->meta(), &k, &v) == MDB_SUCCESS && v.mv_size == sizeof(version)) std::memcpy(&version, v.mv_data, sizeof(version));
+  if (version != XHALATDBBuilder::VERSION) {
+    throw xhal::utils::Exception("XHALATDB: register database format version mismatch, rebuild it with xhal-atdb");
+  }
+  k = toVal("root", 4);
+  check(mdb_get(m_txn, m_env->meta(), &k, &v), "root name");
+  m_root.assign(static_cast<const char *>(v.mv_data), v.mv_size);
+  k = toVal("content_hash", 12);
+  check(mdb_get(m_txn, m_env->meta(), &k, &v), "content hash");
+  if (v.mv_size != sizeof(m_hash)) throw xhal::utils::Exception("XHALATDB: corrupted content hash");
+  std::memcpy(&m_hash, v.mv_data, sizeof(m_hash));
+}
+
+bool xhal::utils::XHALATDBReader::find(const char * name, size_t length, ATDBRecord& record) const
+{
+  ReadScope scope(*m_env, m_txn);
+  MDB_val k = toVal(name, length);
+  MDB_val v;
+  if (mdb_get(m_txn, m_env->nodes(), &k, &v) != MDB_SUCCESS || v.mv_size != sizeof(ATDBRecord)) return false;
+  // values are only 2 byte aligned in the pages
+  std::memcpy(&record, v.mv_data, sizeof(record));
+  return true;
+}
+
+size_t xhal::utils::XHALATDBReader::size() const
+{
+  ReadScope scope(*m_env, m_txn);
+  MDB_stat st;
+  check(mdb_stat(m_txn, m_env->nodes(), &st), "mdb_stat");
+  return st.ms_entries;
+}
+
+void xhal::utils::XHALATDBReader::refresh()
+{
+  readMeta();
+}
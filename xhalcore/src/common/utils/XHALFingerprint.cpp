@@ -0,0 +1,29 @@
+#include "xhal/utils/XHALFingerprint.h"
+#include "xhal/utils/XHALHash.h"
+#include "xhal/utils/Exception.h"
+
+xhal::utils::NodeFingerprint::NodeFingerprint(const NodeStore & store):
+  m_record(store.size(), 0),
+  m_subtree(store.size(), 0)
+{
+  if (store.size() > 0 && store.children(NodeStore::NO_NODE).empty()) {
+    throw xhal::utils::Exception("NodeFingerprint: the child index of the node store is not built");
+  }
+  // children always follow their parent, so a backward pass sees complete child hashes
+  for (uint32_t i = store.size(); i-- > 0;) {
+    if (store.isRemoved(i)) continue;
+    m_record[i] = recordHash(store.token(i), store.address(i), store.mask(i), store.permission(i));
+    uint64_t hash = fnv1a64(&m_record[i], sizeof(uint64_t));
+    for (auto child: store.children(i)) hash = fnv1a64(&m_subtree[child], sizeof(uint64_t), hash);
+    m_subtree[i] = hash;
+  }
+  m_root = FNV1A64_INIT;
+  for (auto top: store.children(NodeStore::NO_NODE)) m_root = fnv1a64(&m_subtree[top], sizeof(uint64_t), m_root);
+}
+
+uint64_t xhal::utils::NodeFingerprint::recordHash(const char * token, uint32_t address, uint32_t mask, NodePermission permission)
+{
+  const uint32_t values[3] = {address, mask, static_cast<uint32_t>(permission)};
+  // the terminating null separates the token from the values
+  return fnv1a64(values, sizeof(values), fnv1a64(token, std::strlen(token) + 1));
+}
@@ -0,0 +1,101 @@
+#include "xhal/utils/XHALLookupBackend.h"
+#include "xhal/utils/XHALXMLParser.h"
+#include "xhal/utils/XHALATDB.h"
+#include "xhal/utils/XHALTableRegistry.h"
+
+std::unique_ptr<xhal::utils::XHALLookupBackend> xhal::utils::XHALLookupBackend::create(const std::string& addressTable)
+{
+  std::string path = addressTable;
+  while (path.size() > 1 && path.back() == '/') path.pop_back();
+  if (path.size() > 4 && path.compare(path.size() - 4, 4, ".mdb") == 0) {
+    return std::unique_ptr<XHALLookupBackend>(new XHALATDBBackend(path));
+  }
+  return std::unique_ptr<XHALLookupBackend>(new XHALXMLBackend(addressTable));
+}
+
+xhal::utils::XHALXMLBackend::XHALXMLBackend(const std::string& xmlFile):
+  m_xmlFile(xmlFile),
+  m_loglevel(2)
+{
+}
+
+xhal::utils::XHALXMLBackend::~XHALXMLBackend()
+{
+}
+
+void xhal::utils::XHALXMLBackend::load()
+{
+  m_table = XHALTableRegistry::instance().acquire(m_xmlFile, m_loglevel);
+}
+
+bool xhal::utils::XHALXMLBackend::findRegister(const std::string& name, uint32_t& address, uint32_t& mask)
+{
+  if (!m_table) throw xhal::utils::Exception("XHALXMLBackend: address table not loaded");
+  // the shared table is fully expanded, all the nodes are in the node store
+  if (NodeRef node = m_table->findNode(name))
+  {
+    address = node.realAddress();
+    mask = node.mask();
+    return true;
+  }
+  return false;
+}
+
+std::experimental::optional<xhal::utils::Node> xhal::utils::XHALXMLBackend::getNode(const std::string& name)
+{
+  if (!m_table) throw xhal::utils::Exception("XHALXMLBackend: address table not loaded");
+  if (NodeRef node = m_table->findNode(name)) return node.toNode();
+  return {};
+}
+
+xhal::utils::XHALATDBBackend::XHALATDBBackend(const std::string& path):
+  m_path(path)
+{
+}
+
+xhal::utils::XHALATDBBackend::~XHALATDBBackend()
+{
+}
+
+void xhal::utils::XHALATDBBackend::load()
+{
+  m_reader.reset(new XHALATDBReader(m_path));
+  m_prefix = m_reader->getRootName().empty() ? std::string() : m_reader->getRootName() + ".";
+}
+
+std::string xhal::utils::XHALATDBBackend::key(const std::string& name) const
+{
+  if (!m_prefix.empty() && name.compare(0, m_prefix.size(), m_prefix) == 0) return name.substr(m_prefix.size());
+  return name;
+}
+
+bool xhal::utils::XHALATDBBackend::findRegister(const std::string& name, uint32_t& address, uint32_t& mask)
+{
+  if (!m_reader) throw xhal::utils::Exception("XHALATDBBackend: register database not loaded");
+  ATDBRecord record;
+  if (!m_reader->find(key(name), record)) return false;
+  address = record.realAddress;
+  mask = record.mask;
+  return true;
+}
+
+std::experimental::optional<xhal::utils::Node> xhal::utils::XHALATDBBackend::getNode(const std::string& name)
+{
+  if (!m_reader) throw xhal::utils::Exception("XHALATDBBackend: register database not loaded");
+  ATDBRecord record;
+  if (!m_reader->find(key(name), record)) return {};
+  Node node;
+  node.name = m_prefix.empty() || name.compare(0, m_prefix.size(), m_prefix) == 0 ? name : m_prefix + name;
+  node.address = record.address;
+  node.real_address = record.realAddress;
+  node.permission = permissionName(record.getPermission());
+  node.mode = modeName(record.getMode());
+  node.size = record.size;
+  node.mask = record.mask;
+  node.isModule = record.isModule();
+  node.isCacheable = record.isCacheable();
+  node.level = record.level;
+  node.warn_min_value = record.warnMinValue;
+  node.error_min_value = record.errorMinValue;
+  return node;
+}
@@ -0,0 +1,122 @@
+#include "xhal/utils/XHALNodePattern.h"
+#include "xhal/utils/Exception.h"
+
+#include <cstdlib>
+#include <cstring>
+
+xhal::utils::NodePattern::NodePattern(const std::string & pattern):
+  m_descendants(false)
+{
+  size_t end = pattern.size();
+  if (end > 0 && pattern[end - 1] == '.') {
+    m_descendants = true;
+    --end;
+  }
+  if (end == 0) throw xhal::utils::Exception("NodePattern: empty pattern");
+  size_t begin = 0;
+  while (true) {
+    const size_t dot = pattern.find('.', begin);
+    const size_t last = dot == std::string::npos || dot > end ? end : dot;
+    m_components.push_back(compile(pattern, begin, last));
+    if (last == end) break;
+    begin = last + 1;
+  }
+}
+
+xhal::utils::NodePattern::Component xhal::utils::NodePattern::compile(const std::string & pattern, size_t begin, size_t end)
+{
+  Component component;
+  component.anyDepth = false;
+  if (begin == end) throw xhal::utils::Exception("NodePattern: empty name component");
+  if (pattern.compare(begin, end - begin, "**") == 0) {
+    component.anyDepth = true;
+    return component;
+  }
+  for (size_t pos = begin; pos < end; ++pos) {
+    const char c = pattern[pos];
+    Segment segment;
+    if (c == '*') {
+      // consecutive stars are equivalent to a single one
+      if (!component.segments.empty() && component.segments.back().type == Segment::ANY) continue;
+      segment.type = Segment::ANY;
+    } else if (c == '?') {
+      segment.type = Segment::ONE;
+    } else if (c == '[') {
+      const size_t close = pattern.find(']', pos);
+      if (close == std::string::npos || close >= end) throw xhal::utils::Exception("NodePattern: unterminated index range");
+      segment.type = Segment::INDEX;
+      const char * p = pattern.c_str() + pos + 1;
+      const char * stop = pattern.c_str() + close;
+      while (p < stop) {
+        char * next;
+        const uint32_t lo = std::strtoul(p, &next, 10);
+        uint32_t hi = lo;
+        if (next == p) throw xhal::utils::Exception("NodePattern: malformed index range");
+        if (*next == '-') {
+          p = next + 1;
+          hi = std::strtoul(p, &next, 10);
+          if (next == p || hi < lo) throw xhal::utils::Exception("NodePattern: malformed index range");
+        }
+        segment.ranges.push_back(std::make_pair(lo, hi));
+        if (next < stop && *next != ',') throw xhal::utils::Exception("NodePattern: malformed index range");
+        p = next < stop ? next + 1 : next;
+      }
+      if (segment.ranges.empty()) throw xhal::utils::Exception("NodePattern: empty index range");
+      pos = close;
+    } else {
+      if (!component.segments.empty() && component.segments.back().type == Segment::LITERAL) {
+        component.segments.back().literal.push_back(c);
+        continue;
+      }
+      segment.type = Segment::LITERAL;
+      segment.literal.push_back(c);
+    }
+    component.segments.push_back(segment);
+  }
+  if (component.segments.front().type == Segment::LITERAL) component.prefix = component.segments.front().literal;
+  return component;
+}
+
+bool xhal::utils::NodePattern::matches(size_t c, const char * token, size_t length) const
+{
+  const Component & component = m_components[c];
+  if (component.anyDepth) return true;
+  const Segment * first = component.segments.data();
+  return match(first, first + component.segments.size(), token, length);
+}
+
+bool xhal::utils::NodePattern::match(const Segment * segment, const Segment * end, const char * token, size_t length)
+{
+  if (segment == end) return length == 0;
+  switch (segment->type) {
+    case Segment::LITERAL:
+      return length >= segment->literal.size() && std::memcmp(token, segment->literal.data(), segment->literal.size()) == 0
+        && match(segment + 1, end, token + segment->literal.size(), length - segment->literal.size());
+    case Segment::ONE:
+      return length > 0 && match(segment + 1, end, token + 1, length - 1);
+    case Segment::ANY:
+      if (segment + 1 == end) return true;
+      for (size_t n = 0; n <= length; ++n) {
+        if (match(segment + 1, end, token + n, length - n)) return true;
+      }
+      return false;
+    case Segment::INDEX:
+      {
+        // decimal number without leading zeros, as produced by the generate blocks
+        uint64_t value = 0;
+        for (size_t n = 1; n <= length && n <= 10; ++n) {
+          if (token[n - 1] < '0' || token[n - 1] > '9') break;
+          if (n > 1 && token[0] == '0') break;
+          value = value * 10 + (token[n - 1] - '0');
+          for (auto const& range: segment->ranges) {
+            if (value >= range.first && value <= range.second) {
+              if (match(segment + 1, end, token + n, length - n)) return true;
+              break;
+            }
+          }
+        }
+        return false;
+      }
+  }
+  return false;
+}
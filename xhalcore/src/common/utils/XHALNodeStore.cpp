@@ -0,0 +1,910 @@
+#include "xhal/utils/XHALNodeStore.h"
+#include "xhal/utils/XHALHash.h"
+#include "xhal/utils/XHALNodePattern.h"
+
+#include <algorithm>
+#include <type_traits>
+
+const uint32_t xhal::utils::NodeStore::NO_NODE;
+const uint32_t xhal::utils::NodeStore::NO_DESCRIPTION;
+const uint8_t xhal::utils::NodeStore::FLAG_MODULE;
+const uint8_t xhal::utils::NodeStore::FLAG_REMOVED;
+const uint8_t xhal::utils::NodeStore::FLAG_CACHEABLE;
+
+namespace {
+  const uint32_t IMAGE_MAGIC = 0x33534e58; // "XNS3"
+  const size_t IMAGE_ALIGNMENT = 8;
+  const int MAX_LEVEL = 255;
+
+  /*
+   * Image layout: ImageHeader, nColumns x ImageColumn, column data.
+   * Column data offsets are relative to the image start and aligned to IMAGE_ALIGNMENT.
+   */
+  struct ImageHeader
+  {
+    uint32_t magic;
+    uint32_t nColumns;
+  };
+
+  struct ImageColumn
+  {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t elementSize;
+  };
+
+  size_t align(size_t n)
+  {
+    return (n + IMAGE_ALIGNMENT - 1) & ~(IMAGE_ALIGNMENT - 1);
+  }
+}
+
+xhal::utils::NodePermission xhal::utils::parsePermission(const char * s)
+{
+  if (std::strcmp(s, "r") == 0) return NodePermission::READ;
+  if (std::strcmp(s, "w") == 0) return NodePermission::WRITE;
+  if (std::strcmp(s, "rw") == 0 || std::strcmp(s, "wr") == 0) return NodePermission::READWRITE;
+  return NodePermission::NONE;
+}
+
+const char * xhal::utils::permissionName(NodePermission permission)
+{
+  switch (permission) {
+    case NodePermission::READ:      return "r";
+    case NodePermission::WRITE:     return "w";
+    case NodePermission::READWRITE: return "rw";
+    default:                        return "";
+  }
+}
+
+xhal::utils::NodeMode xhal::utils::parseMode(const char * s)
+{
+  if (std::strcmp(s, "block") == 0) return NodeMode::BLOCK;
+  if (std::strcmp(s, "fifo") == 0) return NodeMode::FIFO;
+  if (std::strcmp(s, "incremental") == 0) return NodeMode::INCREMENTAL;
+  if (std::strcmp(s, "non-incremental") == 0) return NodeMode::NON_INCREMENTAL;
+  return NodeMode::SINGLE;
+}
+
+const char * xhal::utils::modeName(NodeMode mode)
+{
+  switch (mode) {
+    case NodeMode::BLOCK:           return "block";
+    case NodeMode::FIFO:            return "fifo";
+    case NodeMode::INCREMENTAL:     return "incremental";
+    case NodeMode::NON_INCREMENTAL: return "non-incremental";
+    default:                        return "single";
+  }
+}
+
+uint32_t xhal::utils::StringPool::intern(const char * s, size_t length)
+{
+  return intern(s, length, hash64(s, length));
+}
+
+uint32_t xhal::utils::StringPool::intern(const char * s, size_t length, uint64_t hash)
+{
+  if (!m_blob.owned() || !m_offsets.owned() || !m_slots.owned()) {
+    m_blob.detach();
+    m_offsets.detach();
+    m_slots.detach();
+  }
+  if (m_offsets.empty()) m_offsets.push_back(0);
+  if ((size() + 1) * 2 > m_slots.size()) rehash(std::max<size_t>(64, m_slots.size() * 2));
+
+  const size_t mask = m_slots.size() - 1;
+  size_t pos = hash & mask;
+  while (uint32_t slot = m_slots[pos]) {
+    const uint32_t id = slot - 1;
+    if (this->length(id) == length && std::memcmp(get(id), s, length) == 0) return id;
+    pos = (pos + 1) & mask;
+  }
+  const uint32_t id = size();
+  for (size_t i = 0; i < length; ++i) m_blob.push_back(s[i]);
+  m_blob.push_back('\0');
+  m_offsets.push_back(m_blob.size());
+  m_slots.at(pos) = id + 1;
+  return id;
+}
+
+void xhal::utils::StringPool::rehash(size_t capacity)
+{
+  m_slots.clear();
+  m_slots.resize(capacity, 0);
+  const size_t mask = capacity - 1;
+  for (uint32_t id = 0; id < size(); ++id) {
+    size_t pos = hash64(get(id), length(id)) & mask;
+    while (m_slots[pos]) pos = (pos + 1) & mask;
+    m_slots.at(pos) = id + 1;
+  }
+}
+
+xhal::utils::NodeStore::NodeStore()
+{
+}
+
+void xhal::utils::NodeStore::clear()
+{
+  *this = NodeStore();
+}
+
+void xhal::utils::NodeStore::reserve(size_t n)
+{
+  detach();
+  m_address.reserve(n);
+  m_realAddress.reserve(n);
+  m_mask.reserve(n);
+  m_size.reserve(n);
+  m_warnMin.reserve(n);
+  m_errorMin.reserve(n);
+  m_parent.reserve(n);
+  m_token.reserve(n);
+  m_description.reserve(n);
+  m_level.reserve(n);
+  m_permission.reserve(n);
+  m_mode.reserve(n);
+  m_flags.reserve(n);
+  size_t capacity = 64;
+  while (capacity < n * 2) capacity *= 2;
+  if (capacity > m_slots.size()) rehash(capacity);
+}
+
+void xhal::utils::NodeStore::shrink()
+{
+  // hash tables keep their power of two sizes
+  m_address.shrink_to_fit();
+  m_realAddress.shrink_to_fit();
+  m_mask.shrink_to_fit();
+  m_size.shrink_to_fit();
+  m_warnMin.shrink_to_fit();
+  m_errorMin.shrink_to_fit();
+  m_parent.shrink_to_fit();
+  m_token.shrink_to_fit();
+  m_description.shrink_to_fit();
+  m_level.shrink_to_fit();
+  m_permission.shrink_to_fit();
+  m_mode.shrink_to_fit();
+  m_flags.shrink_to_fit();
+  m_position.shrink_to_fit();
+  m_tokens.m_blob.shrink_to_fit();
+  m_tokens.m_offsets.shrink_to_fit();
+  m_descriptions.m_blob.shrink_to_fit();
+  m_descriptions.m_offsets.shrink_to_fit();
+  std::string().swap(m_scratch);
+}
+
+void xhal::utils::NodeStore::compact()
+{
+  detach();
+  m_description.clear();
+  m_description.resize(m_parent.size(), NO_DESCRIPTION);
+  m_descriptions = StringPool();
+  m_childOffsets.clear();
+  m_children.clear();
+  m_firstChild.clear();
+  m_nextSibling.clear();
+  m_subtreeMin.clear();
+  m_subtreeMax.clear();
+  // smallest name index at most half full, as attach() requires
+  size_t capacity = 64;
+  while (capacity < (size_t)m_parent.size() * 2) capacity *= 2;
+  if (capacity < m_slots.size()) rehash(capacity);
+  shrink();
+}
+
+uint32_t xhal::utils::NodeStore::addNode(uint32_t parent, const char * token, size_t tokenLength, const Attributes & attributes, const std::string & description)
+{
+  detach();
+  m_scratch.clear();
+  if (parent != NO_NODE) {
+    appendName(parent, m_scratch);
+    m_scratch.push_back('.');
+  }
+  m_scratch.append(token, tokenLength);
+  return insertNode(parent, token, tokenLength, hash64(token, tokenLength), hash64(m_scratch.data(), m_scratch.size()),
+                    attributes, description.data(), description.size(), hash64(description.data(), description.size()));
+}
+
+void xhal::utils::NodeStore::append(const NodeFragment & fragment, uint32_t parent)
+{
+  detach();
+  // fragment indices are mapped to store indices, fragment nodes may duplicate existing ones
+  std::vector<uint32_t> remap(fragment.size());
+  for (uint32_t j = 0; j < fragment.size(); ++j) {
+    const NodeFragment::Entry & entry = fragment.m_nodes[j];
+    const char * name = fragment.m_names.data() + entry.name;
+    remap[j] = insertNode(entry.parent == NO_NODE ? parent : remap[entry.parent],
+                          name + entry.nameLength - entry.tokenLength, entry.tokenLength, entry.tokenHash, entry.nameHash,
+                          entry.attributes, fragment.m_descriptions.data() + entry.description, entry.descriptionLength,
+                          entry.descriptionHash);
+  }
+}
+
+void xhal::utils::NodeStore::remove(uint32_t first, uint32_t end)
+{
+  end = std::min(end, size());
+  if (first >= end) return;
+  detach();
+  for (uint32_t i = first; i < end; ++i) m_flags.at(i) |= FLAG_REMOVED;
+  // the name index is rebuilt without the removed nodes, probe sequences must not be broken by holes
+  rehash(m_slots.size());
+  m_byAddress.clear();
+  m_byRealAddress.clear();
+  m_byAddressEnd.clear();
+  m_byRealAddressEnd.clear();
+  m_childOffsets.clear();
+  m_children.clear();
+  m_firstChild.clear();
+  m_nextSibling.clear();
+  m_subtreeMin.clear();
+  m_subtreeMax.clear();
+}
+
+uint32_t xhal::utils::NodeStore::removedCount() const
+{
+  uint32_t res = 0;
+  for (uint32_t i = 0; i < size(); ++i) {
+    if (isRemoved(i)) ++res;
+  }
+  return res;
+}
+
+void xhal::utils::NodeStore::setPosition(uint32_t i, uint32_t position)
+{
+  detach();
+  if (m_position.empty()) {
+    m_position.reserve(size());
+    for (uint32_t j = 0; j < size(); ++j) m_position.push_back(j);
+  }
+  m_position.at(i) = position;
+  m_firstChild.clear();
+  m_nextSibling.clear();
+  m_subtreeMin.clear();
+  m_subtreeMax.clear();
+}
+
+bool xhal::utils::NodeStore::siblingBefore(uint32_t a, uint32_t b) const
+{
+  // a node placed at a position comes before the node holding that index, nodes placed together keep their order
+  if (m_parent[a] != m_parent[b]) return m_parent[a] < m_parent[b];
+  const uint32_t pa = position(a);
+  const uint32_t pb = position(b);
+  if (pa != pb) return pa < pb;
+  if ((pa != a) != (pb != b)) return pa != a;
+  return a < b;
+}
+
+void xhal::utils::NodeStore::pack(std::vector<uint32_t> & remap)
+{
+  buildTreeIndex();
+  std::vector<uint32_t> stack;
+  for (uint32_t i = 0; i < size(); ++i) {
+    if (m_parent[i] == NO_NODE && !isRemoved(i)) stack.push_back(i);
+  }
+  std::sort(stack.begin(), stack.end(), [this](uint32_t a, uint32_t b) {return siblingBefore(b, a);});
+
+  // preorder walk, the children are pushed in reverse so that the first one is visited first
+  NodeStore packed;
+  packed.reserve(size() - removedCount());
+  remap.assign(size(), NO_NODE);
+  std::vector<uint32_t> children;
+  while (!stack.empty()) {
+    const uint32_t i = stack.back();
+    stack.pop_back();
+    Attributes attributes;
+    attributes.address = m_address[i];
+    attributes.real_address = m_realAddress[i];
+    attributes.size = m_size[i];
+    attributes.mask = m_mask[i];
+    attributes.permission = permission(i);
+    attributes.mode = mode(i);
+    attributes.isModule = isModule(i);
+    attributes.isCacheable = isCacheable(i);
+    attributes.warn_min_value = m_warnMin[i];
+    attributes.error_min_value = m_errorMin[i];
+    remap[i] = packed.addNode(m_parent[i] == NO_NODE ? NO_NODE : remap[m_parent[i]], token(i), m_tokens.length(m_token[i]),
+                              attributes, description(i));
+    children.clear();
+    for (uint32_t c = m_firstChild[i]; c != NO_NODE; c = m_nextSibling[c]) children.push_back(c);
+    stack.insert(stack.end(), children.rbegin(), children.rend());
+  }
+  *this = packed;
+}
+
+uint32_t xhal::utils::NodeStore::insertNode(uint32_t parent, const char * token, size_t tokenLength, uint64_t tokenHash, uint64_t nameHash,
+                                            const Attributes & attributes, const char * description, size_t descriptionLength, uint64_t descriptionHash)
+{
+  // refuse duplicated names, the first definition wins
+  if (!m_slots.empty()) {
+    const size_t mask = m_slots.size() - 1;
+    const uint32_t tag = nameHash >> 32;
+    for (size_t pos = tag & mask; m_slots[pos]; pos = (pos + 1) & mask) {
+      const uint64_t slot = m_slots[pos];
+      if ((slot >> 32) != tag) continue;
+      const uint32_t i = (slot & 0xFFFFFFFF) - 1;
+      if (m_parent[i] == parent && m_tokens.length(m_token[i]) == tokenLength
+          && std::memcmp(m_tokens.get(m_token[i]), token, tokenLength) == 0) {
+        return i;
+      }
+    }
+  }
+
+  const uint32_t i = size();
+  m_address.push_back(attributes.address);
+  m_realAddress.push_back(attributes.real_address);
+  m_mask.push_back(attributes.mask);
+  m_size.push_back(attributes.size);
+  m_warnMin.push_back(attributes.warn_min_value);
+  m_errorMin.push_back(attributes.error_min_value);
+  m_parent.push_back(parent);
+  m_token.push_back(m_tokens.intern(token, tokenLength, tokenHash));
+  m_description.push_back(descriptionLength == 0 ? NO_DESCRIPTION : m_descriptions.intern(description, descriptionLength, descriptionHash));
+  m_level.push_back(parent == NO_NODE ? 0 : std::min(MAX_LEVEL, m_level[parent] + 1));
+  m_permission.push_back(static_cast<uint8_t>(attributes.permission));
+  m_mode.push_back(static_cast<uint8_t>(attributes.mode));
+  m_flags.push_back((attributes.isModule ? FLAG_MODULE : 0) | (attributes.isCacheable ? FLAG_CACHEABLE : 0));
+  if (!m_position.empty()) m_position.push_back(i);
+  indexName(i, nameHash);
+  if (!m_byAddress.empty()) {
+    m_byAddress.clear();
+    m_byRealAddress.clear();
+    m_byAddressEnd.clear();
+    m_byRealAddressEnd.clear();
+  }
+  if (!m_childOffsets.empty()) {
+    m_childOffsets.clear();
+    m_children.clear();
+  }
+  if (!m_firstChild.empty()) {
+    m_firstChild.clear();
+    m_nextSibling.clear();
+    m_subtreeMin.clear();
+    m_subtreeMax.clear();
+  }
+  return i;
+}
+
+uint32_t xhal::utils::NodeFragment::addNode(uint32_t parent, const char * token, size_t tokenLength, const NodeStore::Attributes & attributes, const std::string & description)
+{
+  Entry entry;
+  entry.attributes = attributes;
+  entry.parent = parent;
+  entry.name = m_names.size();
+  if (parent != NodeStore::NO_NODE) {
+    const Entry & p = m_nodes[parent];
+    m_names.append(m_names, p.name, p.nameLength);
+    m_names.push_back('.');
+  } else if (!m_prefix.empty()) {
+    m_names.append(m_prefix);
+    m_names.push_back('.');
+  }
+  m_names.append(token, tokenLength);
+  entry.nameLength = m_names.size() - entry.name;
+  entry.tokenLength = tokenLength;
+  entry.nameHash = hash64(m_names.data() + entry.name, entry.nameLength);
+  entry.tokenHash = hash64(token, tokenLength);
+  entry.description = m_descriptions.size();
+  entry.descriptionLength = description.size();
+  entry.descriptionHash = hash64(description.data(), description.size());
+  m_descriptions.append(description);
+  m_nodes.push_back(entry);
+  return m_nodes.size() - 1;
+}
+
+bool xhal::utils::NodeStore::nameEquals(uint32_t i, const char * name, size_t length) const
+{
+  // raw pointers, as the char blob would otherwise force the compiler to reload the columns after each compare
+  const uint32_t * parents = m_parent.data();
+  const uint32_t * tokens = m_token.data();
+  const uint32_t * offsets = m_tokens.m_offsets.data();
+  const char * blob = m_tokens.m_blob.data();
+  while (true) {
+    const uint32_t begin = offsets[tokens[i]];
+    const size_t tokenLength = offsets[tokens[i] + 1] - begin - 1;
+    if (tokenLength > length) return false;
+    length -= tokenLength;
+    if (std::memcmp(name + length, blob + begin, tokenLength) != 0) return false;
+    i = parents[i];
+    if (i == NO_NODE) return length == 0;
+    if (length == 0 || name[length - 1] != '.') return false;
+    --length;
+  }
+}
+
+void xhal::utils::NodeStore::indexName(uint32_t i, uint64_t hash)
+{
+  if ((size_t)(i + 1) * 2 > m_slots.size()) rehash(std::max<size_t>(64, m_slots.size() * 2));
+  const size_t mask = m_slots.size() - 1;
+  const uint32_t tag = hash >> 32;
+  size_t pos = tag & mask;
+  while (m_slots[pos]) pos = (pos + 1) & mask;
+  m_slots.at(pos) = ((uint64_t)tag << 32) | (i + 1);
+}
+
+void xhal::utils::NodeStore::rehash(size_t capacity)
+{
+  Column<uint64_t> old = std::move(m_slots);
+  m_slots = Column<uint64_t>();
+  m_slots.resize(capacity, 0);
+  const size_t mask = capacity - 1;
+  for (size_t j = 0; j < old.size(); ++j) {
+    if (!old[j] || isRemoved((old[j] & 0xFFFFFFFF) - 1)) continue;
+    size_t pos = (old[j] >> 32) & mask;
+    while (m_slots[pos]) pos = (pos + 1) & mask;
+    m_slots.at(pos) = old[j];
+  }
+}
+
+uint32_t xhal::utils::NodeStore::find(const char * name, size_t length) const
+{
+  if (m_slots.empty()) return NO_NODE;
+  const uint32_t tag = hash64(name, length) >> 32;
+  const size_t mask = m_slots.size() - 1;
+  for (size_t pos = tag & mask; m_slots[pos]; pos = (pos + 1) & mask) {
+    const uint64_t slot = m_slots[pos];
+    if ((slot >> 32) != tag) continue;
+    const uint32_t i = (slot & 0xFFFFFFFF) - 1;
+    if (nameEquals(i, name, length)) return i;
+  }
+  return NO_NODE;
+}
+
+void xhal::utils::NodeStore::appendName(uint32_t i, std::string & out) const
+{
+  // first pass computes the length, second one fills the tokens from the end, so that there is a single allocation
+  size_t length = 0;
+  for (uint32_t n = i; n != NO_NODE; n = m_parent[n]) length += m_tokens.length(m_token[n]) + 1;
+  const size_t base = out.size();
+  out.resize(base + length - 1);
+  size_t pos = base + length - 1;
+  for (uint32_t n = i; n != NO_NODE; n = m_parent[n]) {
+    const size_t tokenLength = m_tokens.length(m_token[n]);
+    pos -= tokenLength;
+    std::memcpy(&out[pos], m_tokens.get(m_token[n]), tokenLength);
+    if (pos > base) out[--pos] = '.';
+  }
+}
+
+std::string xhal::utils::NodeStore::name(uint32_t i) const
+{
+  std::string res;
+  appendName(i, res);
+  return res;
+}
+
+namespace {
+  /**
+   * @brief fills the maximal last addresses of the implicit search tree over [first, last) of the sorted order
+   * the root of a range is its middle position, the left and right halves are its subtrees
+   */
+  template<typename F>
+  uint32_t buildMaxLast(std::vector<uint32_t> & maxLast, uint32_t first, uint32_t last, F lastAddress)
+  {
+    if (first >= last) return 0;
+    const uint32_t mid = first + (last - first) / 2;
+    maxLast[mid] = std::max(lastAddress(mid), std::max(buildMaxLast(maxLast, first, mid, lastAddress),
+                                                        buildMaxLast(maxLast, mid + 1, last, lastAddress)));
+    return maxLast[mid];
+  }
+}
+
+uint32_t xhal::utils::NodeStore::lastAddress(uint32_t i, bool real) const
+{
+  const uint64_t last = real ? m_realAddress[i] + (uint64_t)span(i) * 4 - 1 : m_address[i] + (uint64_t)span(i) - 1;
+  return std::min<uint64_t>(last, 0xFFFFFFFF);
+}
+
+void xhal::utils::NodeStore::buildAddressIndex()
+{
+  std::vector<uint32_t> registers;
+  for (uint32_t i = 0; i < size(); ++i) {
+    if (permission(i) == NodePermission::NONE || isRemoved(i)) continue;
+    registers.push_back(i);
+  }
+  auto fill = [](Column<uint32_t> & column, const std::vector<uint32_t> & values) {
+    column.clear();
+    column.reserve(values.size());
+    for (auto v: values) column.push_back(v);
+  };
+  // stable sort keeps the document order of registers sharing a word, e.g. masked fields
+  std::vector<uint32_t> maxLast(registers.size());
+  std::stable_sort(registers.begin(), registers.end(), [this](uint32_t a, uint32_t b) {return m_address[a] < m_address[b];});
+  fill(m_byAddress, registers);
+  buildMaxLast(maxLast, 0, registers.size(), [&](uint32_t p) {return lastAddress(registers[p], false);});
+  fill(m_byAddressEnd, maxLast);
+  std::stable_sort(registers.begin(), registers.end(), [this](uint32_t a, uint32_t b) {return m_realAddress[a] < m_realAddress[b];});
+  fill(m_byRealAddress, registers);
+  buildMaxLast(maxLast, 0, registers.size(), [&](uint32_t p) {return lastAddress(registers[p], true);});
+  fill(m_byRealAddressEnd, maxLast);
+}
+
+xhal::utils::AddressMatches xhal::utils::NodeStore::findByAddress(uint32_t address) const
+{
+  const uint32_t * first = m_byAddress.data();
+  // only the registers starting at or below the address can cover it
+  const uint32_t * last = std::upper_bound(first, first + m_byAddressEnd.size(), address,
+                                           [this](uint32_t a, uint32_t i) {return a < m_address[i];});
+  return AddressMatches(this, first, m_byAddressEnd.data(), m_byAddressEnd.size(), last - first, address, false);
+}
+
+xhal::utils::AddressMatches xhal::utils::NodeStore::findByRealAddress(uint32_t realAddress) const
+{
+  const uint32_t * first = m_byRealAddress.data();
+  const uint32_t * last = std::upper_bound(first, first + m_byRealAddressEnd.size(), realAddress,
+                                           [this](uint32_t a, uint32_t i) {return a < m_realAddress[i];});
+  return AddressMatches(this, first, m_byRealAddressEnd.data(), m_byRealAddressEnd.size(), last - first, realAddress, true);
+}
+
+uint32_t xhal::utils::AddressMatches::next(uint32_t from) const
+{
+  const uint32_t res = search(0, m_size, from);
+  return res == NodeStore::NO_NODE ? m_last : res;
+}
+
+uint32_t xhal::utils::AddressMatches::search(uint32_t first, uint32_t last, uint32_t from) const
+{
+  // subtrees out of [from, m_last) or ending below the address are skipped, O(log N) per match
+  if (first >= last || last <= from || first >= m_last) return NodeStore::NO_NODE;
+  const uint32_t mid = first + (last - first) / 2;
+  if (m_maxLast[mid] < m_address) return NodeStore::NO_NODE;
+  const uint32_t res = search(first, mid, from);
+  if (res != NodeStore::NO_NODE) return res;
+  if (mid >= from && mid < m_last && m_store->lastAddress(m_order[mid], m_real) >= m_address) return mid;
+  return search(mid + 1, last, from);
+}
+
+void xhal::utils::NodeStore::buildChildIndex()
+{
+  // children of node i are at [offsets[i], offsets[i+1]), root nodes are stored last, as children of node size()
+  const uint32_t n = size();
+  std::vector<uint32_t> offsets(n + 2, 0);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (!isRemoved(i)) ++offsets[(m_parent[i] == NO_NODE ? n : m_parent[i]) + 1];
+  }
+  for (uint32_t i = 1; i < n + 2; ++i) offsets[i] += offsets[i - 1];
+  std::vector<uint32_t> children(offsets[n + 1]);
+  std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (!isRemoved(i)) children[fill[m_parent[i] == NO_NODE ? n : m_parent[i]]++] = i;
+  }
+  for (uint32_t p = 0; p < n + 1; ++p) {
+    std::sort(children.begin() + offsets[p], children.begin() + offsets[p + 1],
+              [this](uint32_t a, uint32_t b) {return std::strcmp(token(a), token(b)) < 0;});
+  }
+  m_childOffsets.clear();
+  m_childOffsets.reserve(offsets.size());
+  for (auto o: offsets) m_childOffsets.push_back(o);
+  m_children.clear();
+  m_children.reserve(children.size());
+  for (auto c: children) m_children.push_back(c);
+}
+
+void xhal::utils::NodeStore::buildTreeIndex()
+{
+  // parents always precede their children, so a single backward pass links the children in document order
+  // and folds each subtree address range into its parent
+  const uint32_t n = size();
+  std::vector<uint32_t> firstChild(n, NO_NODE);
+  std::vector<uint32_t> nextSibling(n, NO_NODE);
+  std::vector<uint32_t> subtreeMin(n, 0xFFFFFFFF);
+  std::vector<uint32_t> subtreeMax(n, 0);
+  uint32_t firstRoot = NO_NODE;
+  for (uint32_t i = n; i-- > 0;) {
+    if (isRemoved(i)) continue;
+    if (permission(i) != NodePermission::NONE) {
+      subtreeMin[i] = std::min(subtreeMin[i], m_address[i]);
+      subtreeMax[i] = std::max(subtreeMax[i], m_address[i] + span(i) - 1);
+    }
+    const uint32_t p = m_parent[i];
+    if (p == NO_NODE) {
+      nextSibling[i] = firstRoot;
+      firstRoot = i;
+      continue;
+    }
+    nextSibling[i] = firstChild[p];
+    firstChild[p] = i;
+    subtreeMin[p] = std::min(subtreeMin[p], subtreeMin[i]);
+    subtreeMax[p] = std::max(subtreeMax[p], subtreeMax[i]);
+  }
+  auto fill = [](Column<uint32_t> & column, const std::vector<uint32_t> & values) {
+    column.clear();
+    column.reserve(values.size());
+    for (auto v: values) column.push_back(v);
+  };
+  if (!m_position.empty()) {
+    // some nodes were placed out of index order, the siblings are relinked in sorted order
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < n; ++i) {
+      if (!isRemoved(i)) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {return siblingBefore(a, b);});
+    std::fill(firstChild.begin(), firstChild.end(), NO_NODE);
+    firstRoot = NO_NODE;
+    for (size_t k = order.size(); k-- > 0;) {
+      const uint32_t i = order[k];
+      uint32_t & head = m_parent[i] == NO_NODE ? firstRoot : firstChild[m_parent[i]];
+      nextSibling[i] = head;
+      head = i;
+    }
+  }
+  fill(m_firstChild, firstChild);
+  fill(m_nextSibling, nextSibling);
+  fill(m_subtreeMin, subtreeMin);
+  fill(m_subtreeMax, subtreeMax);
+}
+
+xhal::utils::NodeRange xhal::utils::NodeStore::children(uint32_t i) const
+{
+  if (m_childOffsets.empty()) return NodeRange(nullptr, nullptr);
+  const uint32_t slot = i == NO_NODE ? size() : i;
+  const uint32_t * first = m_children.data();
+  return NodeRange(first + m_childOffsets[slot], first + m_childOffsets[slot + 1]);
+}
+
+void xhal::utils::NodeStore::appendDescendants(uint32_t i, std::vector<uint32_t> & out) const
+{
+  // the appended nodes double as the work list
+  size_t next = out.size();
+  for (auto c: children(i)) out.push_back(c);
+  while (next < out.size()) {
+    const NodeRange range = children(out[next++]);
+    out.insert(out.end(), range.begin(), range.end());
+  }
+}
+
+std::vector<uint32_t> xhal::utils::NodeStore::findNodes(const NodePattern & pattern) const
+{
+  std::vector<uint32_t> res;
+  if (m_childOffsets.empty()) return res;
+  // the pattern is not anchored at the root, a leading "**" adds nothing
+  size_t first = 0;
+  while (first < pattern.size() && pattern.isAnyDepth(first)) ++first;
+  if (first == pattern.size()) {
+    for (uint32_t i = 0; i < size(); ++i) {
+      if (!isRemoved(i)) res.push_back(i);
+    }
+  } else {
+    // the first component may match at any level, each distinct token is tested once
+    std::vector<char> tokenMatches(m_tokens.size());
+    for (uint32_t t = 0; t < m_tokens.size(); ++t) tokenMatches[t] = pattern.matches(first, m_tokens.get(t), m_tokens.length(t));
+    for (uint32_t i = 0; i < size(); ++i) {
+      if (tokenMatches[m_token[i]] && !isRemoved(i)) collectMatches(i, first + 1, pattern, res);
+    }
+  }
+  // "**" components can reach the same node through several paths
+  std::sort(res.begin(), res.end(), [this](uint32_t a, uint32_t b) {
+    return m_address[a] < m_address[b] || (m_address[a] == m_address[b] && a < b);
+  });
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  return res;
+}
+
+void xhal::utils::NodeStore::collectMatches(uint32_t i, size_t c, const NodePattern & pattern, std::vector<uint32_t> & out) const
+{
+  if (c == pattern.size()) {
+    if (pattern.descendants()) appendDescendants(i, out);
+    else out.push_back(i);
+    return;
+  }
+  const NodeRange range = children(i);
+  if (pattern.isAnyDepth(c)) {
+    collectMatches(i, c + 1, pattern, out);
+    for (auto child: range) collectMatches(child, c, pattern, out);
+    return;
+  }
+  // children are sorted by token, only those starting with the literal prefix of the component are tested
+  const std::string & prefix = pattern.prefix(c);
+  const uint32_t * it = range.begin();
+  if (!prefix.empty()) {
+    it = std::lower_bound(range.begin(), range.end(), prefix.c_str(),
+                          [this](uint32_t a, const char * p) {return std::strcmp(token(a), p) < 0;});
+  }
+  for (; it != range.end(); ++it) {
+    const char * t = token(*it);
+    if (std::strncmp(t, prefix.c_str(), prefix.size()) != 0) break;
+    if (pattern.matches(c, t, m_tokens.length(m_token[*it]))) collectMatches(*it, c + 1, pattern, out);
+  }
+}
+
+xhal::utils::Node xhal::utils::NodeStore::toNode(uint32_t i) const
+{
+  Node node;
+  toNode(i, node);
+  return node;
+}
+
+void xhal::utils::NodeStore::toNode(uint32_t i, Node & node, const char * name) const
+{
+  if (name) node.name = name;
+  else appendName(i, node.name);
+  if (m_description[i] != NO_DESCRIPTION) node.description.assign(m_descriptions.get(m_description[i]), m_descriptions.length(m_description[i]));
+  node.address = m_address[i];
+  node.real_address = m_realAddress[i];
+  node.permission = permissionName(permission(i));
+  node.mode = modeName(mode(i));
+  node.size = m_size[i];
+  node.mask = m_mask[i];
+  node.isModule = isModule(i);
+  node.isCacheable = isCacheable(i);
+  node.level = m_level[i];
+  node.warn_min_value = m_warnMin[i];
+  node.error_min_value = m_errorMin[i];
+}
+
+template<typename Self, typename F>
+void xhal::utils::NodeStore::forEachColumn(Self & self, F f)
+{
+  f(self.m_address);
+  f(self.m_realAddress);
+  f(self.m_mask);
+  f(self.m_size);
+  f(self.m_warnMin);
+  f(self.m_errorMin);
+  f(self.m_parent);
+  f(self.m_token);
+  f(self.m_description);
+  f(self.m_level);
+  f(self.m_permission);
+  f(self.m_mode);
+  f(self.m_flags);
+  f(self.m_position);
+  f(self.m_slots);
+  f(self.m_byAddress);
+  f(self.m_byRealAddress);
+  f(self.m_byAddressEnd);
+  f(self.m_byRealAddressEnd);
+  f(self.m_childOffsets);
+  f(self.m_children);
+  f(self.m_firstChild);
+  f(self.m_nextSibling);
+  f(self.m_subtreeMin);
+  f(self.m_subtreeMax);
+  f(self.m_tokens.m_blob);
+  f(self.m_tokens.m_offsets);
+  f(self.m_tokens.m_slots);
+  // descriptions are kept at the end of the image so that their pages are only faulted in when used
+  f(self.m_descriptions.m_blob);
+  f(self.m_descriptions.m_offsets);
+  f(self.m_descriptions.m_slots);
+}
+
+size_t xhal::utils::NodeStore::memoryFootprint() const
+{
+  size_t res = 0;
+  forEachColumn(*this, [&res](const auto & column) {res += column.memoryFootprint();});
+  return res;
+}
+
+void xhal::utils::NodeStore::serialize(std::string & out) const
+{
+  std::vector<ImageColumn> columns;
+  forEachColumn(*this, [&columns](const auto & column) {
+    ImageColumn c;
+    c.offset = 0;
+    c.count = column.size();
+    c.elementSize = sizeof(column[0]);
+    columns.push_back(c);
+  });
+  size_t offset = align(sizeof(ImageHeader) + columns.size() * sizeof(ImageColumn));
+  for (auto & c: columns) {
+    c.offset = offset;
+    offset = align(offset + c.count * c.elementSize);
+  }
+
+  const size_t base = out.size();
+  out.resize(base + offset, '\0');
+  ImageHeader header;
+  header.magic = IMAGE_MAGIC;
+  header.nColumns = columns.size();
+  std::memcpy(&out[base], &header, sizeof(header));
+  std::memcpy(&out[base + sizeof(header)], columns.data(), columns.size() * sizeof(ImageColumn));
+  size_t idx = 0;
+  forEachColumn(*this, [&](const auto & column) {
+    if (column.size()) std::memcpy(&out[base + columns[idx].offset], column.data(), columns[idx].count * columns[idx].elementSize);
+    ++idx;
+  });
+}
+
+bool xhal::utils::NodeStore::attach(const char * data, size_t size, std::shared_ptr<const void> keepAlive)
+{
+  clear();
+  if (size < sizeof(ImageHeader)) return false;
+  ImageHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  size_t nColumns = 0;
+  forEachColumn(*this, [&nColumns](const auto &) {++nColumns;});
+  if (header.magic != IMAGE_MAGIC || header.nColumns != nColumns
+      || sizeof(ImageHeader) + nColumns * sizeof(ImageColumn) > size) {
+    return false;
+  }
+  std::vector<ImageColumn> columns(nColumns);
+  std::memcpy(columns.data(), data + sizeof(ImageHeader), nColumns * sizeof(ImageColumn));
+
+  bool valid = true;
+  size_t idx = 0;
+  forEachColumn(*this, [&](auto & column) {
+    typedef typename std::decay<decltype(column[0])>::type T;
+    const ImageColumn & c = columns[idx++];
+    if (!valid) return;
+    if (c.elementSize != sizeof(T) || c.offset % IMAGE_ALIGNMENT || c.offset > size || c.count > (size - c.offset) / sizeof(T)) {
+      valid = false;
+      return;
+    }
+    column.attach(reinterpret_cast<const T *>(data + c.offset), c.count);
+  });
+
+  // all per node columns must have the same length and hash tables must have power of two sizes
+  const size_t n = m_parent.size();
+  valid = valid && m_address.size() == n && m_realAddress.size() == n && m_mask.size() == n && m_size.size() == n
+    && m_warnMin.size() == n && m_errorMin.size() == n && m_token.size() == n && m_description.size() == n
+    && m_level.size() == n && m_permission.size() == n && m_mode.size() == n && m_flags.size() == n
+    && (m_position.empty() || m_position.size() == n)
+    && (m_slots.size() & (m_slots.size() - 1)) == 0 && m_slots.size() >= 2 * n
+    && m_byAddress.size() == m_byRealAddress.size() && m_byAddress.size() <= n
+    && m_byAddressEnd.size() == m_byAddress.size() && m_byRealAddressEnd.size() == m_byAddress.size()
+    && ((m_childOffsets.empty() && m_children.empty())
+        || (m_childOffsets.size() == n + 2 && m_children.size() <= n && m_childOffsets[0] == 0 && m_childOffsets[n + 1] == m_children.size()))
+    && (m_firstChild.empty() || m_firstChild.size() == n) && m_nextSibling.size() == m_firstChild.size()
+    && m_subtreeMin.size() == m_firstChild.size() && m_subtreeMax.size() == m_firstChild.size()
+    && validPool(m_tokens) && validPool(m_descriptions);
+  // the indices must stay within the columns they refer to
+  valid = valid && validIndices();
+  if (!valid) {
+    clear();
+    return false;
+  }
+  m_keepAlive = keepAlive;
+  return true;
+}
+
+void xhal::utils::NodeStore::detach()
+{
+  forEachColumn(*this, [](auto & column) {column.detach();});
+  m_keepAlive.reset();
+}
+
+bool xhal::utils::NodeStore::validPool(const StringPool & pool)
+{
+  // offsets increase by the string lengths plus their NUL and end with the blob, the NUL of the last string ends the
+  // blob, so that every string is terminated within it; the hash table is at most half full
+  const Column<uint32_t> & offsets = pool.m_offsets;
+  if ((pool.m_slots.size() & (pool.m_slots.size() - 1)) != 0 || pool.m_slots.size() < (size_t)pool.size() * 2) return false;
+  if (offsets.empty()) return pool.m_blob.empty();
+  if (offsets[0] != 0 || offsets[offsets.size() - 1] != pool.m_blob.size()) return false;
+  for (size_t k = 1; k < offsets.size(); ++k) {
+    if (offsets[k] <= offsets[k - 1]) return false;
+  }
+  if (!pool.m_blob.empty() && pool.m_blob[pool.m_blob.size() - 1] != '\0') return false;
+  for (size_t k = 0; k < pool.m_slots.size(); ++k) {
+    if (pool.m_slots[k] > pool.size()) return false;
+  }
+  return true;
+}
+
+bool xhal::utils::NodeStore::validIndices() const
+{
+  const uint32_t n = size();
+  auto nodes = [n](const Column<uint32_t> & column, bool allowNone) {
+    for (size_t k = 0; k < column.size(); ++k) {
+      if (column[k] >= n && !(allowNone && column[k] == NO_NODE)) return false;
+    }
+    return true;
+  };
+  for (uint32_t i = 0; i < n; ++i) {
+    // parents precede their children, which also rules out cycles
+    if (m_parent[i] != NO_NODE && m_parent[i] >= i) return false;
+    if (m_token[i] >= m_tokens.size()) return false;
+    if (m_description[i] != NO_DESCRIPTION && m_description[i] >= m_descriptions.size()) return false;
+  }
+  for (size_t k = 0; k < m_slots.size(); ++k) {
+    if ((m_slots[k] & 0xFFFFFFFF) > n) return false;
+  }
+  if (!nodes(m_byAddress, false) || !nodes(m_byRealAddress, false) || !nodes(m_children, false)
+      || !nodes(m_firstChild, true) || !nodes(m_nextSibling, true)) {
+    return false;
+  }
+  for (size_t k = 1; k < m_childOffsets.size(); ++k) {
+    if (m_childOffsets[k] < m_childOffsets[k - 1]) return false;
+  }
+  return true;
+}
@@ -0,0 +1,303 @@
+#include "xhal/utils/XHALNodeTemplate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+  /*
+   * Appends decimal representation of the value, std::to_string would allocate a temporary
+   */
+  void appendNumber(std::string& out, uint32_t value)
+  {
+    char digits[10];
+    int n = 0;
+    do {
+      digits[n++] = '0' + value % 10;
+      value /= 10;
+    } while (value);
+    while (n) out.push_back(digits[--n]);
+  }
+}
+
+const char * const xhal::utils::XMLAttributes::NAMES[xhal::utils::XMLAttributes::COUNT] = {
+  "id", "address", "description", "permission", "mode", "size", "mask", "fw_is_module",
+  "sw_monitor_warn_min_threshold", "sw_monitor_error_min_threshold", "sw_cache",
+  "generate", "generate_size", "generate_address_step", "generate_idx_var"
+};
+
+uint32_t xhal::utils::parseNumber(const char * s)
+{
+  while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') ++s;
+  if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) return std::strtoul(s + 2, nullptr, 16);
+  if (s[0] == '0' && (s[1] == 'b' || s[1] == 'B')) return std::strtoul(s + 2, nullptr, 2);
+  return std::strtoul(s, nullptr, 10);
+}
+
+void xhal::utils::NodeTemplate::assign(const XMLAttributes& attributes)
+{
+  m_id = attributes.get(XMLAttributes::ID);
+  m_attributes = NodeStore::Attributes();
+  m_hasAddress = attributes.has(XMLAttributes::ADDRESS);
+  m_address = m_hasAddress ? parseNumber(attributes.get(XMLAttributes::ADDRESS).c_str()) : 0;
+  if (attributes.has(XMLAttributes::PERMISSION)) m_attributes.permission = parsePermission(attributes.get(XMLAttributes::PERMISSION).c_str());
+  if (attributes.has(XMLAttributes::MODE)) m_attributes.mode = parseMode(attributes.get(XMLAttributes::MODE).c_str());
+  if (attributes.has(XMLAttributes::SIZE)) m_attributes.size = parseNumber(attributes.get(XMLAttributes::SIZE).c_str());
+  if (attributes.has(XMLAttributes::MASK)) m_attributes.mask = parseNumber(attributes.get(XMLAttributes::MASK).c_str());
+  m_attributes.isModule = attributes.has(XMLAttributes::FW_IS_MODULE) && attributes.get(XMLAttributes::FW_IS_MODULE) == "true";
+  m_attributes.isCacheable = attributes.has(XMLAttributes::SW_CACHE) && attributes.get(XMLAttributes::SW_CACHE) == "true";
+  if (attributes.has(XMLAttributes::WARN_MIN_THRESHOLD)) {
+    m_attributes.warn_min_value = parseNumber(attributes.get(XMLAttributes::WARN_MIN_THRESHOLD).c_str());
+  }
+  if (attributes.has(XMLAttributes::ERROR_MIN_THRESHOLD)) {
+    m_attributes.error_min_value = parseNumber(attributes.get(XMLAttributes::ERROR_MIN_THRESHOLD).c_str());
+  }
+  m_description = attributes.get(XMLAttributes::DESCRIPTION);
+  m_generate = attributes.has(XMLAttributes::GENERATE) && attributes.get(XMLAttributes::GENERATE) == "true";
+  m_generateSize = parseNumber(attributes.get(XMLAttributes::GENERATE_SIZE).c_str());
+  m_generateAddressStep = parseNumber(attributes.get(XMLAttributes::GENERATE_ADDRESS_STEP).c_str());
+  m_generateIdxVar = attributes.get(XMLAttributes::GENERATE_IDX_VAR);
+  m_children.clear();
+  std::vector<std::string> scope;
+  compile(scope);
+}
+
+xhal::utils::NodeTemplate& xhal::utils::NodeTemplate::addChild(const XMLAttributes& attributes)
+{
+  m_children.emplace_back(attributes);
+  return m_children.back();
+}
+
+void xhal::utils::NodeTemplate::compile()
+{
+  std::vector<std::string> scope;
+  compile(scope);
+}
+
+void xhal::utils::NodeTemplate::compile(std::vector<std::string>& scope)
+{
+  // the generate index is visible in the id of the block element itself
+  if (m_generate) scope.push_back(m_generateIdxVar);
+  m_name.clear();
+  NamePart part;
+  part.var = -1;
+  size_t pos = 0;
+  while (pos < m_id.size()) {
+    const size_t begin = m_id.find("${", pos);
+    const size_t end = begin == std::string::npos ? std::string::npos : m_id.find('}', begin + 2);
+    if (end == std::string::npos) break;
+    part.literal.append(m_id, pos, begin - pos);
+    // innermost block wins, as in nested generate blocks reusing the index name
+    int var = scope.size() - 1;
+    while (var >= 0 && m_id.compare(begin + 2, end - begin - 2, scope[var]) != 0) --var;
+    if (var >= 0) {
+      part.var = var;
+      m_name.push_back(part);
+      part.literal.clear();
+      part.var = -1;
+    } else {
+      // unknown variables are left untouched
+      part.literal.append(m_id, begin, end + 1 - begin);
+    }
+    pos = end + 1;
+  }
+  if (pos < m_id.size()) part.literal.append(m_id, pos, std::string::npos);
+  if (!part.literal.empty() || m_name.empty()) m_name.push_back(part);
+  for (auto& child: m_children) child.compile(scope);
+  if (m_generate) scope.pop_back();
+}
+
+uint64_t xhal::utils::NodeTemplate::expandedSize() const
+{
+  uint64_t n = 1;
+  for (auto const& child: m_children) n += child.expandedSize();
+  return m_generate ? n * m_generateSize : n;
+}
+
+uint32_t xhal::utils::NodeTemplate::emit(NodeStore& store, uint32_t baseAddress, uint32_t parent, uint32_t& childAddress) const
+{
+  ExpandState state;
+  return emitTo(store, baseAddress, parent, state, childAddress);
+}
+
+void xhal::utils::NodeTemplate::expand(NodeStore& store, uint32_t baseAddress, uint32_t parent, unsigned int threads) const
+{
+  ExpandState state;
+  if (threads < 2 || !m_generate || m_generateSize < 2 || expandedSize() < PARALLEL_MIN_NODES) {
+    expandTo(store, baseAddress, parent, state, false);
+    return;
+  }
+  // each iteration of the block is expanded into its own fragment by the workers, meanwhile the calling thread
+  // appends the completed fragments in order, so that the store content is the same as with the serial expansion
+  const std::string prefix = parent == NodeStore::NO_NODE ? "" : store.name(parent);
+  std::vector<NodeFragment> fragments(m_generateSize, NodeFragment(prefix));
+  std::vector<std::atomic<bool> > ready(m_generateSize);
+  for (auto& r: ready) r.store(false);
+  std::atomic<uint32_t> next(0);
+  auto expandNext = [&](ExpandState& local) {
+    const uint32_t i = next++;
+    if (i >= m_generateSize) return false;
+    local.vars[0] = i;
+    expandTo(fragments[i], baseAddress + m_generateAddressStep * i, NodeStore::NO_NODE, local, true);
+    ready[i].store(true, std::memory_order_release);
+    return true;
+  };
+  auto worker = [&]() {
+    ExpandState local;
+    local.vars.push_back(0);
+    while (expandNext(local)) {}
+  };
+  std::vector<std::thread> pool;
+  const unsigned int workers = std::min<unsigned int>(threads, m_generateSize) - 1;
+  for (unsigned int t = 0; t < workers; ++t) pool.emplace_back(worker);
+
+  state.vars.push_back(0);
+  for (uint32_t i = 0; i < m_generateSize; ++i) {
+    // help the workers rather than wait for them
+    while (!ready[i].load(std::memory_order_acquire)) {
+      if (!expandNext(state)) std::this_thread::yield();
+    }
+    store.append(fragments[i], parent);
+    NodeFragment().swap(fragments[i]);
+  }
+  for (auto& t: pool) t.join();
+}
+
+int xhal::utils::NodeTemplate::find(const char * name, size_t length, uint32_t baseAddress, NodeStore::Attributes& attributes, const std::string ** description) const
+{
+  std::vector<uint32_t> vars;
+  return find(name, length, baseAddress, vars, false, 1, attributes, description);
+}
+
+int xhal::utils::NodeTemplate::find(const char * name, size_t length, uint32_t baseAddress, std::vector<uint32_t>& vars, bool isGenerated, int depth,
+                                    NodeStore::Attributes& attributes, const std::string ** description) const
+{
+  const char * dot = static_cast<const char *>(std::memchr(name, '.', length));
+  const size_t tokenLength = dot ? dot - name : length;
+  if (m_generate && !isGenerated) {
+    // the iteration is given by the index value found in the token
+    vars.push_back(0);
+    int res = 0;
+    if (matchName(name, tokenLength, 0, vars, vars.size() - 1) && vars.back() < m_generateSize) {
+      res = find(name, length, baseAddress + m_generateAddressStep * vars.back(), vars, true, depth, attributes, description);
+    }
+    vars.pop_back();
+    return res;
+  }
+  if (!isGenerated && !matchName(name, tokenLength, 0, vars, -1)) return 0;
+  const uint32_t address = m_hasAddress ? baseAddress + m_address : baseAddress;
+  if (!dot) {
+    attributes = m_attributes;
+    if (m_hasAddress) {
+      attributes.address = address;
+      attributes.real_address = (address<<2)+0x64000000;
+    }
+    *description = &m_description;
+    return depth;
+  }
+  // first definition wins, as in the expansion
+  for (auto const& child: m_children) {
+    const int res = child.find(dot + 1, length - tokenLength - 1, address, vars, false, depth + 1, attributes, description);
+    if (res) return res;
+  }
+  return 0;
+}
+
+bool xhal::utils::NodeTemplate::matchName(const char * token, size_t length, size_t part, std::vector<uint32_t>& vars, int free) const
+{
+  if (part == m_name.size()) return length == 0;
+  const std::string& literal = m_name[part].literal;
+  if (length < literal.size() || literal.compare(0, literal.size(), token, literal.size()) != 0) return false;
+  token += literal.size();
+  length -= literal.size();
+  const int var = m_name[part].var;
+  if (var < 0) return matchName(token, length, part + 1, vars, free);
+  if (var != free) {
+    std::string value;
+    appendNumber(value, vars[var]);
+    return length >= value.size() && value.compare(0, value.size(), token, value.size()) == 0
+        && matchName(token + value.size(), length - value.size(), part + 1, vars, free);
+  }
+  // decimal number without leading zeros, shortest first
+  uint64_t value = 0;
+  for (size_t n = 1; n <= length && n <= 10; ++n) {
+    if (token[n - 1] < '0' || token[n - 1] > '9') break;
+    if (n > 1 && token[0] == '0') break;
+    value = value * 10 + (token[n - 1] - '0');
+    if (value > 0xFFFFFFFF) break;
+    vars[var] = value;
+    if (matchName(token + n, length - n, part + 1, vars, free)) return true;
+  }
+  return false;
+}
+
+bool xhal::utils::NodeTemplate::addressRange(uint32_t baseAddress, uint32_t& first, uint32_t& last) const
+{
+  uint64_t low = ~uint64_t(0), high = 0;
+  if (!addressRange(baseAddress, false, low, high)) return false;
+  first = low;
+  last = std::min<uint64_t>(high, 0xFFFFFFFF);
+  return true;
+}
+
+bool xhal::utils::NodeTemplate::addressRange(uint64_t baseAddress, bool isGenerated, uint64_t& first, uint64_t& last) const
+{
+  if (m_generate && !isGenerated) {
+    if (m_generateSize == 0) return false;
+    // the iterations are the first one shifted by the address step
+    uint64_t low = ~uint64_t(0), high = 0;
+    if (!addressRange(baseAddress, true, low, high)) return false;
+    first = std::min(first, low);
+    last = std::max(last, high + (uint64_t)m_generateAddressStep * (m_generateSize - 1));
+    return true;
+  }
+  const uint64_t address = m_hasAddress ? baseAddress + m_address : baseAddress;
+  bool found = false;
+  if (m_hasAddress && m_attributes.permission != NodePermission::NONE) {
+    const bool block = (m_attributes.mode == NodeMode::BLOCK || m_attributes.mode == NodeMode::INCREMENTAL) && m_attributes.size > 1;
+    first = std::min(first, address);
+    last = std::max(last, address + (block ? m_attributes.size : 1) - 1);
+    found = true;
+  }
+  for (auto const& child: m_children) found = child.addressRange(address, false, first, last) || found;
+  return found;
+}
+
+template<typename Sink>
+uint32_t xhal::utils::NodeTemplate::emitTo(Sink& sink, uint32_t baseAddress, uint32_t parent, ExpandState& state, uint32_t& childAddress) const
+{
+  state.name.clear();
+  for (auto const& part: m_name) {
+    state.name.append(part.literal);
+    if (part.var >= 0) appendNumber(state.name, state.vars[part.var]);
+  }
+  NodeStore::Attributes attributes = m_attributes;
+  childAddress = baseAddress;
+  if (m_hasAddress) {
+    childAddress = baseAddress + m_address;
+    attributes.address = childAddress;
+    attributes.real_address = (childAddress<<2)+0x64000000;
+  }
+  return sink.addNode(parent, state.name.data(), state.name.size(), attributes, m_description);
+}
+
+template<typename Sink>
+void xhal::utils::NodeTemplate::expandTo(Sink& sink, uint32_t baseAddress, uint32_t parent, ExpandState& state, bool isGenerated) const
+{
+  if (m_generate && !isGenerated) {
+    state.vars.push_back(0);
+    for (uint32_t i = 0; i < m_generateSize; ++i) {
+      state.vars.back() = i;
+      expandTo(sink, baseAddress + m_generateAddressStep * i, parent, state, true);
+    }
+    state.vars.pop_back();
+    return;
+  }
+  uint32_t address;
+  const uint32_t node = emitTo(sink, baseAddress, parent, state, address);
+  for (auto const& child: m_children) {
+    child.expandTo(sink, address, node, state, false);
+  }
+}
@@ -0,0 +1,83 @@
+#include "xhal/utils/XHALReadPlan.h"
+
+#include <algorithm>
+
+namespace {
+  /*
+   * Sorted words [first, last] read together
+   */
+  struct Run
+  {
+    size_t first;
+    size_t last;
+    bool block;
+  };
+}
+
+xhal::utils::ReadPlan::ReadPlan(const std::vector<uint32_t>& addresses, const ReadCost& cost) :
+  m_listOffset(0),
+  m_wordCount(0),
+  m_index(addresses.size()),
+  m_cost(0.)
+{
+  if (addresses.empty()) return;
+  std::vector<uint32_t> words(addresses);
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+
+  // join the neighbours while filling the gap costs less than another request
+  std::vector<Run> runs(1, Run{0, 0, false});
+  for (size_t k = 1; k < words.size(); ++k) {
+    const uint32_t distance = words[k] - words[k - 1];
+    const uint32_t gap = distance / 4 - 1;
+    const uint32_t span = (words[k] - words[runs.back().first]) / 4 + 1;
+    if (distance % 4 == 0 && gap <= cost.maxGap && gap * cost.word < cost.request &&
+        (cost.maxBlock == 0 || span <= cost.maxBlock)) {
+      runs.back().last = k;
+    } else {
+      runs.push_back(Run{k, k, false});
+    }
+  }
+
+  // each run is a block or goes to the list, unless blocks only are cheaper than paying for the list read
+  double withList = 0., blocksOnly = 0.;
+  bool hasList = false;
+  for (auto& run: runs) {
+    const double span = (words[run.last] - words[run.first]) / 4 + 1;
+    const double blockCost = cost.request + span * cost.word;
+    const double listCost = (run.last - run.first + 1) * (cost.word + cost.address);
+    run.block = blockCost <= listCost;
+    hasList |= !run.block;
+    withList += std::min(blockCost, listCost);
+    blocksOnly += blockCost;
+  }
+  if (hasList) withList += cost.request;
+  if (hasList && blocksOnly <= withList) {
+    for (auto& run: runs) run.block = true;
+    hasList = false;
+  }
+  m_cost = hasList ? withList : blocksOnly;
+
+  // buffer position of every sorted word
+  std::vector<uint32_t> position(words.size());
+  for (auto const& run: runs) {
+    if (!run.block) continue;
+    const uint32_t base = words[run.first];
+    const uint32_t count = (words[run.last] - base) / 4 + 1;
+    for (size_t k = run.first; k <= run.last; ++k) position[k] = m_wordCount + (words[k] - base) / 4;
+    m_blocks.push_back(Block{base, count, m_wordCount});
+    m_wordCount += count;
+  }
+  m_listOffset = m_wordCount;
+  for (auto const& run: runs) {
+    if (run.block) continue;
+    for (size_t k = run.first; k <= run.last; ++k) {
+      position[k] = m_wordCount++;
+      m_list.push_back(words[k]);
+    }
+  }
+
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    m_index[i] = position[std::lower_bound(words.begin(), words.end(), addresses[i]) - words.begin()];
+  }
+}
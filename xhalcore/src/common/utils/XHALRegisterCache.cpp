@@ -0,0 +1,93 @@
+#include "xhal/utils/XHALRegisterCache.h"
+
+void xhal::utils::RegisterCache::setTTL(const std::string& prefix, std::chrono::milliseconds ttl)
+{
+  m_rules[prefix] = ttl;
+  m_entries.clear();
+  m_byAddress.clear();
+}
+
+xhal::utils::RegisterCache::Policy xhal::utils::RegisterCache::policy(const std::string& name, NodePermission permission,
+                                                                      bool isCacheable, std::chrono::milliseconds& ttl) const
+{
+  // the longest matching prefix sorts last among the candidates
+  auto it = m_rules.upper_bound(name);
+  while (it != m_rules.begin()) {
+    --it;
+    if (name.compare(0, it->first.size(), it->first) == 0) {
+      ttl = it->second;
+      return ttl.count() > 0 ? Policy::TTL : Policy::NEVER;
+    }
+  }
+  ttl = std::chrono::milliseconds(0);
+  return isCacheable && permission == NodePermission::READ ? Policy::FOREVER : Policy::NEVER;
+}
+
+bool xhal::utils::RegisterCache::get(const std::string& name, uint32_t& value)
+{
+  auto found = m_entries.find(name);
+  if (found == m_entries.end()) return false;
+  const Entry& entry = found->second;
+  if (!entry.valid || (entry.policy == Policy::TTL && Clock::now() >= entry.expiry)) return false;
+  value = entry.value;
+  ++m_hits;
+  return true;
+}
+
+bool xhal::utils::RegisterCache::update(const std::string& name, uint32_t value)
+{
+  auto found = m_entries.find(name);
+  if (found == m_entries.end()) return false;
+  store(found->second, value);
+  return true;
+}
+
+void xhal::utils::RegisterCache::insert(const std::string& name, uint32_t address, uint32_t value,
+                                        NodePermission permission, bool isCacheable)
+{
+  // registers never cached are kept too, so that their policy is not resolved again
+  Entry& entry = m_entries[name];
+  entry.address = address;
+  entry.policy = policy(name, permission, isCacheable, entry.ttl);
+  entry.valid = false;
+  if (entry.policy != Policy::NEVER) m_byAddress.insert(std::make_pair(address, &entry));
+  store(entry, value);
+}
+
+void xhal::utils::RegisterCache::store(Entry& entry, uint32_t value)
+{
+  if (entry.policy == Policy::NEVER) return;
+  ++m_misses;
+  entry.value = value;
+  entry.valid = true;
+  if (entry.policy == Policy::TTL) entry.expiry = Clock::now() + entry.ttl;
+}
+
+void xhal::utils::RegisterCache::invalidate(uint32_t address, uint32_t count)
+{
+  if (count == 0) return;
+  auto end = m_byAddress.upper_bound(address + 4 * (count - 1));
+  for (auto it = m_byAddress.lower_bound(address); it != end; ++it) it->second->valid = false;
+}
+
+void xhal::utils::RegisterCache::invalidate(const std::string& prefix)
+{
+  for (auto& entry: m_entries) {
+    if (entry.first.compare(0, prefix.size(), prefix) == 0) entry.second.valid = false;
+  }
+}
+
+void xhal::utils::RegisterCache::clear()
+{
+  m_entries.clear();
+  m_byAddress.clear();
+  m_hits = 0;
+  m_misses = 0;
+}
+
+size_t xhal::utils::RegisterCache::size() const
+{
+  size_t n = 0;
+  for (auto const& entry: m_entries) n += entry.second.valid;
+  return n;
+}
@@ -0,0 +1,190 @@
+#include "xhal/utils/XHALSharedTable.h"
+#include "xhal/utils/XHALHash.h"
+#include "xhal/utils/XHALXMLCache.h"
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  const char SHARED_MAGIC[8] = {'X','H','A','L','S','H','M','\0'};
+
+  /*
+   * Control segment. The counters are only accessed with atomic builtins, the segment may be shared
+   * by processes built from different compilation units.
+   */
+  struct ControlBlock
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t next;
+    uint64_t current;
+  };
+
+  /*
+   * Data segment layout: DataHeader followed by the NodeStore image
+   */
+  struct DataHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t contentHash;
+    uint64_t generation;
+    uint64_t storeSize;
+  };
+
+  bool writeAll(int fd, const char * data, size_t size)
+  {
+    while (size > 0) {
+      const ssize_t n = write(fd, data, size);
+      if (n <= 0) return false;
+      data += n;
+      size -= n;
+    }
+    return true;
+  }
+}
+
+xhal::utils::XHALSharedTable::XHALSharedTable(const std::string& xmlFile):
+  m_control(nullptr),
+  m_writable(false)
+{
+  // the same table reached through different paths shares one segment
+  char resolved[PATH_MAX];
+  const std::string path = realpath(xmlFile.c_str(), resolved) ? std::string(resolved) : xmlFile;
+  char name[32];
+  std::snprintf(name, sizeof(name), "/xhal_at_%016llx", (unsigned long long)fnv1a64(path));
+  m_name = name;
+}
+
+xhal::utils::XHALSharedTable::~XHALSharedTable()
+{
+  if (m_control) munmap(m_control, sizeof(ControlBlock));
+}
+
+std::string xhal::utils::XHALSharedTable::dataName(uint64_t generation) const
+{
+  return m_name + "." + std::to_string(generation);
+}
+
+bool xhal::utils::XHALSharedTable::mapControl(bool writable)
+{
+  if (m_control && (m_writable || !writable)) return true;
+  if (m_control) {
+    munmap(m_control, sizeof(ControlBlock));
+    m_control = nullptr;
+  }
+  const int fd = writable ? shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0664) : shm_open(m_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  // a new segment is zero filled, i.e. nothing published yet
+  if (fstat(fd, &st) != 0 || ((size_t)st.st_size < sizeof(ControlBlock) && (!writable || ftruncate(fd, sizeof(ControlBlock)) != 0))) {
+    close(fd);
+    return false;
+  }
+  void * control = mmap(NULL, sizeof(ControlBlock), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (control == MAP_FAILED) return false;
+  m_control = control;
+  m_writable = writable;
+  return true;
+}
+
+uint64_t xhal::utils::XHALSharedTable::generation()
+{
+  if (!mapControl(false)) return 0;
+  const ControlBlock * control = static_cast<const ControlBlock *>(m_control);
+  return __atomic_load_n(&control->current, __ATOMIC_ACQUIRE);
+}
+
+bool xhal::utils::XHALSharedTable::load(uint64_t hash, NodeStore * store, uint64_t& generation)
+{
+  const uint64_t current = this->generation();
+  const ControlBlock * control = static_cast<const ControlBlock *>(m_control);
+  if (current == 0 || std::memcmp(control->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC)) != 0
+      || control->version != XHALXMLCache::VERSION) {
+    return false;
+  }
+  // the segment may have been replaced and unlinked meanwhile, the caller then falls back to parsing
+  const int fd = shm_open(dataName(current).c_str(), O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DataHeader)) {
+    close(fd);
+    return false;
+  }
+  const size_t size = st.st_size;
+  void * image = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) return false;
+  std::shared_ptr<const void> mapping(image, [size](const void * p) {munmap(const_cast<void *>(p), size);});
+
+  const DataHeader * header = static_cast<const DataHeader *>(image);
+  const bool valid = std::memcmp(header->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC)) == 0
+                  && header->version == XHALXMLCache::VERSION
+                  && header->headerSize == sizeof(DataHeader)
+                  && header->contentHash == hash
+                  && header->generation == current
+                  && sizeof(DataHeader) + header->storeSize == size;
+  if (!valid) return false;
+
+  NodeStore loaded;
+  if (!loaded.attach(static_cast<const char *>(image) + sizeof(DataHeader), header->storeSize, mapping)) return false;
+  *store = loaded;
+  generation = current;
+  return true;
+}
+
+bool xhal::utils::XHALSharedTable::publish(uint64_t hash, const NodeStore & store, uint64_t& generation)
+{
+  if (!mapControl(true)) return false;
+  ControlBlock * control = static_cast<ControlBlock *>(m_control);
+  const uint64_t next = __atomic_add_fetch(&control->next, 1, __ATOMIC_SEQ_CST);
+
+  std::string image;
+  image.resize(sizeof(DataHeader));
+  store.serialize(image);
+  DataHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, SHARED_MAGIC, sizeof(SHARED_MAGIC));
+  header.version = XHALXMLCache::VERSION;
+  header.headerSize = sizeof(DataHeader);
+  header.contentHash = hash;
+  header.generation = next;
+  header.storeSize = image.size() - sizeof(DataHeader);
+  std::memcpy(&image[0], &header, sizeof(header));
+
+  // the image is complete and read-only before it becomes visible
+  const std::string name = dataName(next);
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) return false;
+  const bool written = writeAll(fd, image.data(), image.size()) && fchmod(fd, 0444) == 0;
+  close(fd);
+  if (!written) {
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  std::memcpy(control->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC));
+  control->version = XHALXMLCache::VERSION;
+  uint64_t previous = __atomic_load_n(&control->current, __ATOMIC_ACQUIRE);
+  while (previous < next && !__atomic_compare_exchange_n(&control->current, &previous, next, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {}
+  if (previous > next) {
+    // a concurrent publisher got a later generation out first
+    shm_unlink(name.c_str());
+    generation = previous;
+    return true;
+  }
+  // mappings of the previous generation stay valid until their readers drop them
+  if (previous != 0) shm_unlink(dataName(previous).c_str());
+  generation = next;
+  return true;
+}
@@ -0,0 +1,48 @@
+#include "xhal/utils/XHALTableImage.h"
+#include "xhal/utils/XHALXMLCache.h"
+#include "xhal/utils/Exception.h"
+
+xhal::utils::XHALTableImage::XHALTableImage(const std::string& imageFile):
+  m_imageFile(imageFile),
+  m_contentHash(0)
+{
+}
+
+void xhal::utils::XHALTableImage::load()
+{
+  if (!XHALXMLCache::readImage(m_imageFile, &m_store, m_contentHash)) {
+    throw xhal::utils::Exception(("XHALTableImage: can't load address table image " + m_imageFile).c_str());
+  }
+}
+
+bool xhal::utils::XHALTableImage::findRegister(const std::string& name, uint32_t& address, uint32_t& mask) const
+{
+  const uint32_t i = m_store.find(name);
+  if (i == NodeStore::NO_NODE) return false;
+  address = m_store.realAddress(i);
+  mask = m_store.mask(i);
+  return true;
+}
+
+std::experimental::optional<xhal::utils::Node> xhal::utils::XHALTableImage::getNode(const std::string& name) const
+{
+  const uint32_t i = m_store.find(name);
+  if (i == NodeStore::NO_NODE) return {};
+  Node node;
+  m_store.toNode(i, node, name.c_str());
+  return node;
+}
+
+xhal::utils::NodeRef xhal::utils::XHALTableImage::findNodeFromAddress(uint32_t address) const
+{
+  uint32_t best = NodeStore::NO_NODE;
+  for (auto i: m_store.findByRealAddress(address)) {
+    // same preference as XHALXMLParser::findNodeFromAddress()
+    if (m_store.realAddress(i) == address && m_store.mask(i) == 0xFFFFFFFF) {
+      best = i;
+      break;
+    }
+    if (best == NodeStore::NO_NODE) best = i;
+  }
+  return m_store.ref(best);
+}
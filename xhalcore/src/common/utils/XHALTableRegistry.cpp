@@ -0,0 +1,74 @@
+#include "xhal/utils/XHALTableRegistry.h"
+#include "xhal/utils/XHALXMLParser.h"
+
+#include <climits>
+#include <cstdlib>
+
+xhal::utils::XHALTableRegistry& xhal::utils::XHALTableRegistry::instance()
+{
+  static XHALTableRegistry registry;
+  return registry;
+}
+
+std::shared_ptr<const xhal::utils::XHALXMLParser> xhal::utils::XHALTableRegistry::acquire(const std::string& xmlFile, int loglevel)
+{
+  // the same table reached through different paths is parsed once
+  char resolved[PATH_MAX];
+  const std::string path = realpath(xmlFile.c_str(), resolved) ? std::string(resolved) : xmlFile;
+  // hashed outside of the lock, like the parse
+  const Key key(path, XHALXMLCache(path).contentHash());
+
+  std::promise<std::shared_ptr<const XHALXMLParser> > promise;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    prune();
+    Entry& entry = m_tables[key];
+    if (auto table = entry.table.lock()) return table;
+    if (entry.pending.valid()) {
+      // being parsed by another thread
+      std::shared_future<std::shared_ptr<const XHALXMLParser> > pending = entry.pending;
+      lock.unlock();
+      return pending.get();
+    }
+    // new, or released since prune()
+    entry.pending = promise.get_future().share();
+  }
+
+  try {
+    std::shared_ptr<XHALXMLParser> parser = std::make_shared<XHALXMLParser>(path);
+    parser->setLogLevel(loglevel);
+    parser->parseXML();
+    std::shared_ptr<const XHALXMLParser> table = parser;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      Entry& entry = m_tables[key];
+      entry.table = table;
+      // the waiters hold their own copy of the future
+      entry.pending = std::shared_future<std::shared_ptr<const XHALXMLParser> >();
+    }
+    promise.set_value(table);
+    return table;
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tables.erase(key);
+    }
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+}
+
+size_t xhal::utils::XHALTableRegistry::size()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  prune();
+  return m_tables.size();
+}
+
+void xhal::utils::XHALTableRegistry::prune()
+{
+  for (auto it = m_tables.begin(); it != m_tables.end();) {
+    if (!it->second.pending.valid() && it->second.table.expired()) it = m_tables.erase(it);
+    else ++it;
+  }
+}
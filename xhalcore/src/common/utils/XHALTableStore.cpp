@@ -0,0 +1,241 @@
+#include "xhal/utils/XHALTableStore.h"
+#include "xhal/utils/XHALHash.h"
+#include "xhal/utils/XHALXMLParser.h"
+
+#include <algorithm>
+
+namespace {
+  const uint8_t FLAG_MODULE = 0x1;
+  const uint8_t FLAG_CACHEABLE = 0x2;
+  const int MAX_LEVEL = 255;
+}
+
+const std::string& xhal::utils::TableVersion::name() const
+{
+  return m_store->m_versions[m_version].name;
+}
+
+uint32_t xhal::utils::TableVersion::nodeCount() const
+{
+  return m_store->m_versions[m_version].nodeCount;
+}
+
+bool xhal::utils::TableVersion::findRegister(const std::string& name, uint32_t& address, uint32_t& mask) const
+{
+  uint32_t shape, wordAddress;
+  int level;
+  if (!m_store || !m_store->resolve(m_version, name, shape, wordAddress, address, level)) return false;
+  mask = m_store->m_mask[shape];
+  return true;
+}
+
+std::experimental::optional<xhal::utils::Node> xhal::utils::TableVersion::getNode(const std::string& name) const
+{
+  uint32_t shape, address, realAddress;
+  int level;
+  if (!m_store || !m_store->resolve(m_version, name, shape, address, realAddress, level)) return {};
+  const XHALTableStore & s = *m_store;
+  Node node;
+  node.name = name;
+  if (s.m_description[shape] != NodeStore::NO_DESCRIPTION) node.description = s.m_descriptions.get(s.m_description[shape]);
+  node.address = address;
+  node.real_address = realAddress;
+  node.permission = permissionName(static_cast<NodePermission>(s.m_permission[shape]));
+  node.mode = modeName(static_cast<NodeMode>(s.m_mode[shape]));
+  node.size = s.m_size[shape];
+  node.mask = s.m_mask[shape];
+  node.isModule = s.m_flags[shape] & FLAG_MODULE;
+  node.isCacheable = s.m_flags[shape] & FLAG_CACHEABLE;
+  node.level = level;
+  node.warn_min_value = s.m_warnMin[shape];
+  node.error_min_value = s.m_errorMin[shape];
+  return node;
+}
+
+uint32_t xhal::utils::XHALTableStore::addVersion(const std::string& version, const NodeStore& store)
+{
+  if (store.size() > 0 && store.children(NodeStore::NO_NODE).empty()) {
+    throw xhal::utils::Exception("XHALTableStore: the child index of the node store is not built");
+  }
+  // children always follow their parent, so a backward pass interns the child shapes first
+  std::vector<uint32_t> shapes(store.size(), 0);
+  std::vector<Edge> edges;
+  Version v;
+  v.name = version;
+  v.nodeCount = 0;
+  for (uint32_t i = store.size(); i-- > 0;) {
+    if (store.isRemoved(i)) continue;
+    ++v.nodeCount;
+    edges.clear();
+    // the child index is sorted by token
+    for (auto child: store.children(i)) {
+      edges.push_back(Edge{shapes[child], store.address(child) - store.address(i), store.realAddress(child) - store.realAddress(i)});
+    }
+    shapes[i] = intern(store, i, edges);
+  }
+  for (auto top: store.children(NodeStore::NO_NODE)) v.roots.push_back(Root{shapes[top], store.address(top), store.realAddress(top)});
+
+  // a replaced version keeps its index, its shapes stay in the pool
+  auto found = m_versionIndex.find(version);
+  if (found != m_versionIndex.end()) {
+    m_versions[found->second] = v;
+    return found->second;
+  }
+  m_versions.push_back(v);
+  m_versionIndex[version] = m_versions.size() - 1;
+  return m_versions.size() - 1;
+}
+
+uint32_t xhal::utils::XHALTableStore::loadVersion(const std::string& version, const std::string& xmlFile)
+{
+  XHALXMLParser parser(xmlFile);
+  parser.setLogLevel(1);
+  parser.parseXML();
+  return addVersion(version, parser.getNodeStore());
+}
+
+uint32_t xhal::utils::XHALTableStore::intern(const NodeStore& store, uint32_t i, const std::vector<Edge>& edges)
+{
+  const char * token = store.token(i);
+  const char * description = store.description(i);
+  const uint32_t values[7] = {
+    store.mask(i), store.nodeSize(i), static_cast<uint32_t>(store.warnMinValue(i)), static_cast<uint32_t>(store.errorMinValue(i)),
+    static_cast<uint32_t>(store.permission(i)), static_cast<uint32_t>(store.mode(i)),
+    (store.isModule(i) ? FLAG_MODULE : 0u) | (store.isCacheable(i) ? FLAG_CACHEABLE : 0u)
+  };
+  uint64_t hash = fnv1a64(token, std::strlen(token) + 1);
+  hash = fnv1a64(description, std::strlen(description) + 1, hash);
+  hash = fnv1a64(values, sizeof(values), hash);
+  if (!edges.empty()) hash = fnv1a64(edges.data(), edges.size() * sizeof(edges[0]), hash);
+
+  auto range = m_shapeIndex.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    const uint32_t s = it->second;
+    const uint32_t first = m_firstEdge[s];
+    if (m_mask[s] != values[0] || m_size[s] != values[1] || m_warnMin[s] != store.warnMinValue(i) ||
+        m_errorMin[s] != store.errorMinValue(i) || m_permission[s] != values[4] || m_mode[s] != values[5] ||
+        m_flags[s] != values[6] || m_firstEdge[s + 1] - first != edges.size()) continue;
+    if (std::strcmp(m_tokens.get(m_token[s]), token) != 0) continue;
+    const char * other = m_description[s] == NodeStore::NO_DESCRIPTION ? "" : m_descriptions.get(m_description[s]);
+    if (std::strcmp(other, description) != 0) continue;
+    bool equal = true;
+    for (size_t e = 0; e < edges.size() && equal; ++e) {
+      equal = m_edgeShape[first + e] == edges[e].shape && m_edgeOffset[first + e] == edges[e].offset &&
+        m_edgeRealOffset[first + e] == edges[e].realOffset;
+    }
+    if (equal) return s;
+  }
+
+  const uint32_t s = m_token.size();
+  if (m_firstEdge.empty()) m_firstEdge.push_back(0);
+  m_token.push_back(m_tokens.intern(token, std::strlen(token)));
+  m_description.push_back(*description ? m_descriptions.intern(description, std::strlen(description)) : NodeStore::NO_DESCRIPTION);
+  m_mask.push_back(values[0]);
+  m_size.push_back(values[1]);
+  m_warnMin.push_back(store.warnMinValue(i));
+  m_errorMin.push_back(store.errorMinValue(i));
+  m_permission.push_back(values[4]);
+  m_mode.push_back(values[5]);
+  m_flags.push_back(values[6]);
+  for (auto const& edge: edges) {
+    m_edgeShape.push_back(edge.shape);
+    m_edgeOffset.push_back(edge.offset);
+    m_edgeRealOffset.push_back(edge.realOffset);
+  }
+  m_firstEdge.push_back(m_edgeShape.size());
+  m_shapeIndex.insert(std::make_pair(hash, s));
+  return s;
+}
+
+int xhal::utils::XHALTableStore::compareToken(const char * component, size_t length, uint32_t token) const
+{
+  const size_t tokenLength = m_tokens.length(token);
+  const int c = std::memcmp(component, m_tokens.get(token), std::min(length, tokenLength));
+  if (c != 0) return c;
+  return length < tokenLength ? -1 : (length > tokenLength ? 1 : 0);
+}
+
+bool xhal::utils::XHALTableStore::resolve(uint32_t version, const std::string& name, uint32_t& shape, uint32_t& address,
+                                          uint32_t& realAddress, int& level) const
+{
+  if (version >= m_versions.size()) return false;
+  const Version & v = m_versions[version];
+  const char * component = name.c_str();
+  const char * end = component + name.size();
+  level = 0;
+  bool found = false;
+  for (const char * next = component; component <= end; component = next + 1, ++level) {
+    next = std::find(component, end, '.');
+    const size_t length = next - component;
+    found = false;
+    if (level == 0) {
+      // few top level nodes
+      for (auto const& root: v.roots) {
+        if (compareToken(component, length, m_token[root.shape]) != 0) continue;
+        shape = root.shape;
+        address = root.address;
+        realAddress = root.realAddress;
+        found = true;
+        break;
+      }
+    } else {
+      uint32_t lo = m_firstEdge[shape], hi = m_firstEdge[shape + 1];
+      while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const int c = compareToken(component, length, m_token[m_edgeShape[mid]]);
+        if (c == 0) {
+          address += m_edgeOffset[mid];
+          realAddress += m_edgeRealOffset[mid];
+          shape = m_edgeShape[mid];
+          found = true;
+          break;
+        }
+        if (c < 0) hi = mid;
+        else lo = mid + 1;
+      }
+    }
+    if (!found) return false;
+    if (next == end) break;
+  }
+  level = std::min(level, MAX_LEVEL);
+  return found;
+}
+
+void xhal::utils::XHALTableStore::assignBoard(const std::string& board, uint32_t version)
+{
+  if (version >= m_versions.size()) throw xhal::utils::Exception("XHALTableStore: no such address table version");
+  m_boards[board] = version;
+}
+
+xhal::utils::TableVersion xhal::utils::XHALTableStore::forBoard(const std::string& board) const
+{
+  auto found = m_boards.find(board);
+  if (found == m_boards.end()) return TableVersion();
+  return TableVersion(this, found->second);
+}
+
+xhal::utils::TableVersion xhal::utils::XHALTableStore::version(uint32_t version) const
+{
+  if (version >= m_versions.size()) return TableVersion();
+  return TableVersion(this, version);
+}
+
+xhal::utils::TableVersion xhal::utils::XHALTableStore::version(const std::string& name) const
+{
+  auto found = m_versionIndex.find(name);
+  if (found == m_versionIndex.end()) return TableVersion();
+  return TableVersion(this, found->second);
+}
+
+size_t xhal::utils::XHALTableStore::memoryFootprint() const
+{
+  size_t footprint = m_token.memoryFootprint() + m_description.memoryFootprint() + m_mask.memoryFootprint()
+    + m_size.memoryFootprint() + m_warnMin.memoryFootprint() + m_errorMin.memoryFootprint()
+    + m_permission.memoryFootprint() + m_mode.memoryFootprint() + m_flags.memoryFootprint()
+    + m_firstEdge.memoryFootprint() + m_edgeShape.memoryFootprint()
+    + m_edgeOffset.memoryFootprint() + m_edgeRealOffset.memoryFootprint() + m_tokens.memoryFootprint() + m_descriptions.memoryFootprint();
+  // approximate node based hash table cost
+  footprint += m_shapeIndex.size() * (sizeof(std::pair<uint64_t, uint32_t>) + 2 * sizeof(void *));
+  for (auto const& v: m_versions) footprint += sizeof(Version) + v.name.capacity() + v.roots.capacity() * sizeof(Root);
+  return footprint;
+}
@@ -0,0 +1,201 @@
+#include "xhal/utils/XHALXMLCache.h"
+#include "xhal/utils/XHALHash.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  const char CACHE_MAGIC[8] = {'X','H','A','L','A','T','C','\0'};
+  const int MAX_INCLUDE_DEPTH = 32;
+
+  /*
+   * Image layout: CacheHeader followed by the NodeStore image.
+   * All the fields have a fixed width and are written in host byte order, so that an image built on an x86_64 host
+   * loads on the (little endian, 32-bit) Zynq, but not on a big endian machine.
+   */
+  struct CacheHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t contentHash;
+    uint64_t storeSize;
+  };
+
+  std::string dirName(const std::string& path)
+  {
+    size_t pos = path.rfind('/');
+    if (pos == std::string::npos) return "";
+    return path.substr(0, pos + 1);
+  }
+
+  std::string baseName(const std::string& path)
+  {
+    size_t pos = path.rfind('/');
+    if (pos == std::string::npos) return path;
+    return path.substr(pos + 1);
+  }
+
+  /*
+   * Extracts href attributes of all (x)include elements.
+   * A textual scan is sufficient here: the result only feeds the content hash.
+   */
+  std::vector<std::string> findIncludes(const std::string& content)
+  {
+    std::vector<std::string> hrefs;
+    size_t pos = 0;
+    while ((pos = content.find('<', pos)) != std::string::npos) {
+      ++pos;
+      if (content.compare(pos, 3, "!--") == 0) {
+        pos = content.find("-->", pos);
+        if (pos == std::string::npos) break;
+        continue;
+      }
+      size_t nameEnd = content.find_first_of(" \t\r\n/>", pos);
+      if (nameEnd == std::string::npos) break;
+      std::string tag = content.substr(pos, nameEnd - pos);
+      if (tag != "include" && (tag.size() < 8 || tag.compare(tag.size() - 8, 8, ":include") != 0)) continue;
+      size_t tagEnd = content.find('>', nameEnd);
+      if (tagEnd == std::string::npos) break;
+      size_t href = content.find("href", nameEnd);
+      if (href == std::string::npos || href > tagEnd) continue;
+      size_t quote = content.find_first_of("\"'", href);
+      if (quote == std::string::npos || quote > tagEnd) continue;
+      size_t quoteEnd = content.find(content[quote], quote + 1);
+      if (quoteEnd == std::string::npos || quoteEnd > tagEnd) continue;
+      hrefs.push_back(content.substr(quote + 1, quoteEnd - quote - 1));
+      pos = tagEnd;
+    }
+    return hrefs;
+  }
+}
+
+xhal::utils::XHALXMLCache::XHALXMLCache(const std::string& xmlFile):
+  m_xmlFile(xmlFile)
+{
+  const char * cacheDir = std::getenv("XHAL_AT_CACHE_DIR");
+  if (cacheDir && cacheDir[0] != '\0') {
+    // different tables with the same base name may share the directory, disambiguate by full path
+    char suffix[20];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx", (unsigned long long)fnv1a64(xmlFile));
+    m_cacheFile = std::string(cacheDir) + "/" + baseName(xmlFile) + suffix + ".cache";
+  } else {
+    m_cacheFile = xmlFile + ".cache";
+  }
+}
+
+uint64_t xhal::utils::XHALXMLCache::contentHash()
+{
+  m_files.clear();
+  const uint32_t version = VERSION;
+  uint64_t hash = fnv1a64(&version, sizeof(version));
+  return hashFile(m_xmlFile, hash, 0);
+}
+
+uint64_t xhal::utils::XHALXMLCache::fileHash(const std::string& fileName)
+{
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!in) return fnv1a64("<missing>", 9);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return fnv1a64(buffer.str());
+}
+
+uint64_t xhal::utils::XHALXMLCache::hashFile(const std::string& fileName, uint64_t hash, int depth)
+{
+  hash = fnv1a64(fileName, hash);
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!in || depth > MAX_INCLUDE_DEPTH) {
+    // missing file still contributes to the hash, so that its appearance invalidates the cache
+    return fnv1a64("<missing>", 9, hash);
+  }
+  m_files.push_back(fileName);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  const std::string content = buffer.str();
+  hash = fnv1a64(content, hash);
+  const std::string dir = dirName(fileName);
+  for (auto const& href: findIncludes(content)) {
+    hash = hashFile(href[0] == '/' ? href : dir + href, hash, depth + 1);
+  }
+  return hash;
+}
+
+bool xhal::utils::XHALXMLCache::load(uint64_t hash, NodeStore * store)
+{
+  NodeStore loaded;
+  uint64_t imageHash;
+  if (!readImage(m_cacheFile, &loaded, imageHash) || imageHash != hash) return false;
+  *store = loaded;
+  return true;
+}
+
+bool xhal::utils::XHALXMLCache::store(uint64_t hash, const NodeStore & store)
+{
+  return writeImage(m_cacheFile, hash, store);
+}
+
+bool xhal::utils::XHALXMLCache::readImage(const std::string& fileName, NodeStore * store, uint64_t& hash)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+    close(fd);
+    return false;
+  }
+  const size_t fileSize = st.st_size;
+  void * image = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) return false;
+  std::shared_ptr<const void> mapping(image, [fileSize](const void * p) {munmap(const_cast<void *>(p), fileSize);});
+
+  const CacheHeader * header = static_cast<const CacheHeader *>(image);
+  bool valid = std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+            && header->version == VERSION
+            && header->headerSize == sizeof(CacheHeader)
+            && sizeof(CacheHeader) + header->storeSize == fileSize;
+  if (!valid) return false;
+
+  NodeStore loaded;
+  if (!loaded.attach(static_cast<const char *>(image) + sizeof(CacheHeader), header->storeSize, mapping)) return false;
+  *store = loaded;
+  hash = header->contentHash;
+  return true;
+}
+
+bool xhal::utils::XHALXMLCache::writeImage(const std::string& fileName, uint64_t hash, const NodeStore & store)
+{
+  std::string image;
+  image.resize(sizeof(CacheHeader));
+  store.serialize(image);
+
+  CacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = VERSION;
+  header.headerSize = sizeof(CacheHeader);
+  header.contentHash = hash;
+  header.storeSize = image.size() - sizeof(CacheHeader);
+  std::memcpy(&image[0], &header, sizeof(header));
+
+  // write to a temporary file and rename, so that concurrent readers never see a partial image
+  const std::string tmpFile = fileName + "." + std::to_string(getpid()) + ".tmp";
+  std::ofstream out(tmpFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out) return false;
+  out.write(image.data(), image.size());
+  out.close();
+  if (!out || std::rename(tmpFile.c_str(), fileName.c_str()) != 0) {
+    std::remove(tmpFile.c_str());
+    return false;
+  }
+  return true;
+}
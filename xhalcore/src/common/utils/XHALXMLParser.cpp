@@ -1,8 +1,38 @@
 #include "xhal/utils/XHALXMLParser.h"
 
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+namespace {
+  // XMLPlatformUtils::Initialize() and Terminate() are reference counted but not thread safe,
+  // parsers of several threads go through these
+  std::mutex xercesMutex;
+
+  void initializeXerces()
+  {
+    std::lock_guard<std::mutex> lock(xercesMutex);
+    xercesc::XMLPlatformUtils::Initialize();
+  }
+
+  void terminateXerces()
+  {
+    std::lock_guard<std::mutex> lock(xercesMutex);
+    xercesc::XMLPlatformUtils::Terminate();
+  }
+}
+
 xhal::utils::XHALXMLParser::XHALXMLParser(const std::string& xmlFile)
 {
   m_xmlFile = xmlFile;
+  m_useCache = true;
+  m_streaming = false;
+  m_threads = std::max(1u, std::thread::hardware_concurrency());
+  m_contentHash = 0;
+  m_lazy = false;
+  m_lazyCacheSize = 1024;
+  m_sharedMemory = false;
+  m_sharedGeneration = 0;
   log4cplus::SharedAppenderPtr myAppender(new log4cplus::ConsoleAppender());
   std::auto_ptr<log4cplus::Layout> myLayout = std::auto_ptr<log4cplus::Layout>(new log4cplus::TTCCLayout());
   myAppender->setLayout( myLayout );
@@ -10,13 +40,13 @@ xhal::utils::XHALXMLParser::XHALXMLParser(const std::string& xmlFile)
   m_logger = t_logger;
   m_logger.addAppender(myAppender);
   m_logger.setLogLevel(log4cplus::INFO_LOG_LEVEL);
-  m_nodes = new std::unordered_map<std::string,Node>();
+  m_store = new NodeStore();
   //m_root = new xercesc::DOMNode();
 }
 
 xhal::utils::XHALXMLParser::~XHALXMLParser()
 {
-  if (m_nodes) delete m_nodes;
+  if (m_store) delete m_store;
   m_logger.shutdown();
 }
 
@@ -42,12 +72,49 @@ void xhal::utils::XHALXMLParser::setLogLevel(int loglevel)
   }
 }
 
+void xhal::utils::XHALXMLParser::setLazyCacheSize(size_t size)
+{
+  m_lazyCacheSize = size;
+  clearLazyCache();
+}
+
 void xhal::utils::XHALXMLParser::parseXML()
 {
+  m_virtual.clear();
+  m_virtualByParent.clear();
+  clearLazyCache();
+  m_fragments.clear();
+  XHALXMLCache cache(m_xmlFile);
+  // also kept to detect changes in reparseChanged()
+  const uint64_t hash = cache.contentHash();
+  m_contentHash = 0;
+  m_sharedGeneration = 0;
+  const bool shared = m_sharedMemory && !m_lazy;
+  if (shared) {
+    if (!m_shared) m_shared.reset(new XHALSharedTable(m_xmlFile));
+    if (m_shared->load(hash, m_store, m_sharedGeneration)) {
+      INFO("Address table mapped from shared memory " << m_shared->getName() << ", generation " << m_sharedGeneration);
+      DEBUG("Number of nodes: " << m_store->size());
+      m_contentHash = hash;
+      return;
+    }
+    DEBUG("No shared address table image for " << m_xmlFile << " in " << m_shared->getName());
+  }
+  if (m_useCache) {
+    if (cache.load(hash, m_store)) {
+      INFO("Address table loaded from cache " << cache.getCacheFile());
+      DEBUG("Number of nodes: " << m_store->size());
+      m_contentHash = hash;
+      if (shared) publishShared(hash);
+      return;
+    }
+    DEBUG("Cache " << cache.getCacheFile() << " is missing or stale, parsing XML");
+  }
+
   //
   /// Initialize XML4C system
   try {
-    xercesc::XMLPlatformUtils::Initialize();
+    initializeXerces();
     INFO("Successfully initialized XML4C system");
   } catch(const xercesc::XMLException& toCatch) {
     ERROR("Error during Xerces-c Initialization." << std::endl
@@ -57,6 +124,273 @@ void xhal::utils::XHALXMLParser::parseXML()
     return;
   }
 
+  m_store->clear();
+  try {
+    if (m_streaming) {
+      XHALXMLStreamParser streamParser(m_store, m_logger, m_threads);
+      if (m_lazy) {
+        streamParser.setVirtualBlocks(&m_virtual);
+      } else {
+        XMLFragment top;
+        top.file = m_xmlFile;
+        top.hash = XHALXMLCache::fileHash(m_xmlFile);
+        top.depth = 0;
+        top.parent = NodeStore::NO_NODE;
+        top.parentAddress = 0;
+        top.first = 0;
+        top.reloadable = true;
+        m_fragments.push_back(top);
+        streamParser.setFragments(&m_fragments);
+      }
+      streamParser.parse(m_xmlFile);
+      if (!m_fragments.empty()) m_fragments[0].end = m_store->size();
+    } else {
+      parseDOM();
+    }
+  } catch (...) {
+    m_fragments.clear();
+    terminateXerces();
+    throw;
+  }
+  m_contentHash = hash;
+  m_store->buildIndices();
+  m_store->shrink();
+  for (size_t b = 0; b < m_virtual.size(); ++b)
+  {
+    VirtualBlock& block = m_virtual[b];
+    m_virtualByParent[block.parent].push_back(b);
+    uint32_t first, last;
+    if (block.element.addressRange(block.baseAddress, first, last))
+    {
+      block.firstRealAddress = (first<<2)+0x64000000;
+      block.lastRealAddress = (last<<2)+0x64000000+3;
+    } else {
+      block.firstRealAddress = 1;
+      block.lastRealAddress = 0;
+    }
+  }
+  DEBUG("Number of nodes: " << m_store->size());
+  DEBUG("Number of unexpanded generate blocks: " << m_virtual.size());
+  DEBUG("Node store memory footprint: " << m_store->memoryFootprint() << " bytes");
+  DEBUG("Parsing done!");
+  terminateXerces();
+
+  // the store of the lazy mode is incomplete
+  if (m_useCache && m_virtual.empty()) {
+    if (cache.store(hash, *m_store)) {
+      DEBUG("Address table cache written to " << cache.getCacheFile());
+    } else {
+      WARN("Unable to write address table cache " << cache.getCacheFile());
+    }
+  }
+  if (shared && m_virtual.empty()) publishShared(hash);
+}
+
+void xhal::utils::XHALXMLParser::publishShared(uint64_t hash)
+{
+  uint64_t generation;
+  if (!m_shared) m_shared.reset(new XHALSharedTable(m_xmlFile));
+  if (!m_shared->publish(hash, *m_store, generation)) {
+    WARN("Unable to publish address table in shared memory " << m_shared->getName());
+    return;
+  }
+  DEBUG("Address table published in shared memory " << m_shared->getName() << ", generation " << generation);
+  // a concurrent publisher may have won, the image content is the same
+  m_shared->load(hash, m_store, m_sharedGeneration);
+}
+
+bool xhal::utils::XHALXMLParser::refresh()
+{
+  if (!m_shared || m_sharedGeneration == 0) return false;
+  const uint64_t generation = m_shared->generation();
+  if (generation == 0 || generation == m_sharedGeneration) return false;
+  const uint64_t hash = XHALXMLCache(m_xmlFile).contentHash();
+  uint64_t mapped;
+  if (!m_shared->load(hash, m_store, mapped)) {
+    // published from other file contents, or replaced meanwhile: picked up by the next call
+    DEBUG("Shared address table generation " << generation << " does not match " << m_xmlFile);
+    return false;
+  }
+  INFO("Address table remapped to shared memory generation " << mapped);
+  m_sharedGeneration = mapped;
+  m_contentHash = hash;
+  m_fragments.clear();
+  clearLazyCache();
+  return true;
+}
+
+bool xhal::utils::XHALXMLParser::reparseChanged()
+{
+  // another process may already have published the new table
+  if (refresh()) return true;
+  if (m_fragments.empty())
+  {
+    // no fragment information: loaded from the cache image, parsed by the DOM parser or in lazy expansion mode
+    if (XHALXMLCache(m_xmlFile).contentHash() == m_contentHash) return false;
+    INFO("Address table " << m_xmlFile << " changed, reparsing everything");
+    reparseAll();
+    return true;
+  }
+
+  // a file included from a generate block is reparsed with the nearest enclosing reloadable file
+  std::vector<size_t> targets;
+  for (size_t f = 0; f < m_fragments.size(); ++f)
+  {
+    if (XHALXMLCache::fileHash(m_fragments[f].file) == m_fragments[f].hash) continue;
+    INFO("Address table file " << m_fragments[f].file << " changed");
+    size_t t = f;
+    while (!m_fragments[t].reloadable)
+    {
+      const unsigned int depth = m_fragments[t].depth;
+      while (m_fragments[--t].depth >= depth) {}
+    }
+    targets.push_back(t);
+  }
+  if (targets.empty()) return false;
+  std::sort(targets.begin(), targets.end());
+  if (targets[0] == 0)
+  {
+    reparseAll();
+    return true;
+  }
+  // fragments nested in another reparsed fragment are reparsed with it
+  std::vector<size_t> selected;
+  for (auto t: targets)
+  {
+    if (selected.empty() || t >= fragmentBlockEnd(selected.back())) selected.push_back(t);
+  }
+
+  try {
+    initializeXerces();
+  } catch(const xercesc::XMLException& toCatch) {
+    ERROR("Error during Xerces-c Initialization." << std::endl
+          << "  Exception message:"
+          << xercesc::XMLString::transcode(toCatch.getMessage()));
+    throw xhal::utils::Exception("XHALParser: initialization failed");
+  }
+  try {
+    // backwards, so that the indices of the fragments still to be reloaded do not move
+    for (auto t = selected.rbegin(); t != selected.rend(); ++t) reloadFragment(*t);
+  } catch (...) {
+    m_fragments.clear();
+    m_contentHash = 0;
+    terminateXerces();
+    throw;
+  }
+  terminateXerces();
+  // the removed nodes are compacted once they make up half of the store, so that it does not grow on every reload
+  if (m_store->removedCount() * 2 >= m_store->size()) packStore();
+  m_store->buildIndices();
+  m_store->shrink();
+  DEBUG("Number of nodes after reparsing " << selected.size() << " fragments: " << m_store->size());
+
+  XHALXMLCache cache(m_xmlFile);
+  m_contentHash = cache.contentHash();
+  if (m_useCache && !cache.store(m_contentHash, *m_store))
+  {
+    WARN("Unable to write address table cache " << cache.getCacheFile());
+  }
+  if (m_sharedMemory && !m_lazy) publishShared(m_contentHash);
+  return true;
+}
+
+void xhal::utils::XHALXMLParser::reparseAll()
+{
+  const bool streaming = m_streaming;
+  m_streaming = true;
+  try {
+    parseXML();
+  } catch (...) {
+    m_streaming = streaming;
+    throw;
+  }
+  m_streaming = streaming;
+}
+
+void xhal::utils::XHALXMLParser::reloadFragment(size_t fragment)
+{
+  const XMLFragment target = m_fragments[fragment];
+  const size_t blockEnd = fragmentBlockEnd(fragment);
+  // the new nodes are appended, they are placed where the old ones were in the document order
+  const uint32_t position = target.first < m_store->size() ? m_store->position(target.first) : target.first;
+  DEBUG("Reparsing " << target.file);
+  // nested fragments reloaded earlier are no longer inside the range of the enclosing one
+  for (size_t f = fragment; f < blockEnd; ++f)
+  {
+    if (m_fragments[f].reloadable) m_store->remove(m_fragments[f].first, m_fragments[f].end);
+  }
+  std::vector<XMLFragment> block(1, target);
+  block[0].hash = XHALXMLCache::fileHash(target.file);
+  block[0].first = m_store->size();
+  XHALXMLStreamParser streamParser(m_store, m_logger, m_threads);
+  streamParser.setFragments(&block);
+  streamParser.parseFragment(target.file, target.parent, target.parentAddress, target.depth);
+  block[0].end = m_store->size();
+  for (uint32_t i = block[0].first; i < block[0].end; ++i)
+  {
+    if (m_store->parent(i) == target.parent) m_store->setPosition(i, position);
+  }
+  m_fragments.erase(m_fragments.begin() + fragment, m_fragments.begin() + blockEnd);
+  m_fragments.insert(m_fragments.begin() + fragment, block.begin(), block.end());
+}
+
+void xhal::utils::XHALXMLParser::packStore()
+{
+  std::vector<uint32_t> remap;
+  m_store->pack(remap);
+  // the nodes of a fragment and of its nested fragments are contiguous in document order, the nested ones reloaded
+  // earlier are out of the range of the enclosing one and are added back here
+  const uint32_t none = NodeStore::NO_NODE;
+  std::vector<uint32_t> first(m_fragments.size(), none);
+  std::vector<uint32_t> end(m_fragments.size(), 0);
+  for (size_t f = 0; f < m_fragments.size(); ++f)
+  {
+    for (uint32_t i = m_fragments[f].first; i < m_fragments[f].end && i < remap.size(); ++i)
+    {
+      if (remap[i] == none) continue;
+      first[f] = std::min(first[f], remap[i]);
+      end[f] = std::max(end[f], remap[i] + 1);
+    }
+  }
+  for (size_t f = m_fragments.size(); f-- > 0;)
+  {
+    for (size_t g = f + 1; g < fragmentBlockEnd(f); ++g)
+    {
+      first[f] = std::min(first[f], first[g]);
+      end[f] = std::max(end[f], end[g]);
+    }
+  }
+  for (size_t f = 0; f < m_fragments.size(); ++f)
+  {
+    if (first[f] == none)
+    {
+      // empty fragment, kept before the node which followed it
+      first[f] = m_store->size();
+      for (uint32_t i = m_fragments[f].first; i < remap.size(); ++i)
+      {
+        if (remap[i] != none)
+        {
+          first[f] = remap[i];
+          break;
+        }
+      }
+      end[f] = first[f];
+    }
+    m_fragments[f].first = first[f];
+    m_fragments[f].end = end[f];
+  }
+  DEBUG("Compacted the address table to " << m_store->size() << " nodes");
+}
+
+size_t xhal::utils::XHALXMLParser::fragmentBlockEnd(size_t fragment) const
+{
+  size_t end = fragment + 1;
+  while (end < m_fragments.size() && m_fragments[end].depth > m_fragments[fragment].depth) ++end;
+  return end;
+}
+
+void xhal::utils::XHALXMLParser::parseDOM()
+{
   //  Create our parser, then attach an error handler to the parser.
   //  The parser will call back to methods of the ErrorHandler if it
   //  discovers errors during the course of parsing the XML document.
@@ -107,255 +441,287 @@ void xhal::utils::XHALXMLParser::parseXML()
     // fileError = "An error occured during parsing of selected file. Please select another configuration file.";
   }
 
+  // a missing or unreadable file gives no document
+  if (!errorsOccured && (doc == NULL || doc->getDocumentElement() == NULL)) {
+    ERROR("Unable to read the address table " << m_xmlFile);
+    errorsOccured = true;
+  }
   if (!errorsOccured) {
     DEBUG("DOM tree created succesfully");
-    if (doc->getDocumentElement()!=NULL){
-      m_root = doc->getDocumentElement();
-    }
+    m_root = doc->getDocumentElement();
     DEBUG("Root node (getDocumentElement) obtained");
-    makeTree(m_root,"",0x0,m_nodes,NULL,m_vars,false);
-    DEBUG("Number of nodes: " << m_nodes->size());
+    makeTree(m_root,0x0,NodeStore::NO_NODE);
   } else{
+    if (parser) parser->release();
     throw xhal::utils::Exception("XHALParser: an error occured during parsing");
   }
-  DEBUG("Parsing done!");
   if (parser) parser->release();
-  xercesc::XMLPlatformUtils::Terminate();
 }
 
-void xhal::utils::XHALXMLParser::makeTree(xercesc::DOMNode * node, std::string baseName, uint32_t baseAddress, std::unordered_map<std::string, Node> * nodes, Node * parentNode, std::unordered_map<std::string, int> vars, bool isGenerated)
+void xhal::utils::XHALXMLParser::makeTree(xercesc::DOMNode * node, uint32_t baseAddress, uint32_t parentNode)
 {
-  DEBUG("Call makeTree");
-  unsigned int generateSize;
-  unsigned int generateAddressStep;
-  std::string generateIdxVar;
-  DEBUG("Declare some local variables");
-  if (isGenerated == false)
+  XMLAttributes attributes;
+  readAttributes(static_cast<xercesc::DOMElement*>(node), attributes);
+  if (!attributes.has(XMLAttributes::ID))
+  {
+    ERROR("Node has no id attribute");
+  }
+  NodeTemplate element(attributes);
+  if (element.isGenerate())
   {
-    DEBUG("Node is not _generated_");
-    if (auto tmp = getAttVal(node, "generate"))
+    DEBUG("Generate nodes " << attributes.get(XMLAttributes::ID));
+    makeTemplate(node, element);
+    element.compile();
+    if (m_lazy)
     {
-      if (*tmp == "true"){
-        DEBUG("Generate nodes");
-        tmp = getAttVal(node, "generate_size");
-        generateSize = parseInt(*tmp);
-        tmp = getAttVal(node, "generate_address_step");
-        generateAddressStep = parseInt(*tmp);
-        auto generateIdxVar = getAttVal(node, "generate_idx_var");
-        for (unsigned int i = 0; i < generateSize; i++)// in range(0, generateSize):
-        {
-          vars[*generateIdxVar] = i;
-          makeTree(node, baseName, baseAddress + generateAddressStep * i, nodes, parentNode, vars, true);
-        }
-        return;
-      }
+      m_virtual.push_back(VirtualBlock{std::move(element), parentNode, baseAddress});
+    } else {
+      element.expand(*m_store, baseAddress, parentNode, m_threads);
     }
-  } else {
-    DEBUG("Node is _generated_");
+    return;
   }
-  Node newNode = Node();
-  DEBUG("Create Node() object");
-  std::string name;
   uint32_t address;
-  name = baseName;
-  address = baseAddress;
-  if (baseName != "") {name += ".";}
-  if (auto tmp = getAttVal(node, "id"))
-  {
-    name.append(*tmp);
-  } else {
-    ERROR("getAttVal returned NONE, node has no id attribute");
-  }
-  //name += *getAttVal(node, "id");
-  name = substituteVars(name, vars);
-  DEBUG("Node name: " << name);
-  newNode.name = name;
-  if (auto tmp = getAttVal(node, "description"))
-  {
-    newNode.description = *tmp;
-  }
-  if (auto tmp = getAttVal(node, "address"))
-  {
-    address = baseAddress + parseInt(*tmp);
-    newNode.address = address;
-    newNode.real_address = (address<<2)+0x64000000;
-  } else {
-    TRACE("getAttVal returned NONE");
-  }
-  if (auto tmp = getAttVal(node, "permission"))
-  {
-    newNode.permission = *tmp;
-  }
-  if (auto tmp = getAttVal(node, "mode"))
-  {
-    newNode.mode = *tmp;
-  }
-  if (auto tmp = getAttVal(node, "size"))
+  uint32_t nodeIdx = element.emit(*m_store, baseAddress, parentNode, address);
+  TRACE("Node store size after insert " << m_store->size());
+  xercesc::DOMNodeList *children_ = node->getChildNodes();
+  const XMLSize_t nodeCount = children_->getLength();
+  DEBUG("Node children length: " << nodeCount);
+
+  for( XMLSize_t ix = 0 ; ix < nodeCount ; ++ix )
   {
-    newNode.size = parseInt(*tmp);
+    if (children_->item(ix)->getNodeType() == xercesc::DOMNode::ELEMENT_NODE)
+    {
+      makeTree(children_->item(ix),address,nodeIdx);
+    } else {
+      continue;
+    }
   }
-  if (auto tmp = getAttVal(node, "mask"))
+}
+
+void xhal::utils::XHALXMLParser::makeTemplate(xercesc::DOMNode * node, NodeTemplate & element)
+{
+  XMLAttributes attributes;
+  for (xercesc::DOMNode * child = node->getFirstChild(); child; child = child->getNextSibling())
   {
-    newNode.mask = parseInt(*tmp);
+    if (child->getNodeType() != xercesc::DOMNode::ELEMENT_NODE) continue;
+    readAttributes(static_cast<xercesc::DOMElement*>(child), attributes);
+    if (!attributes.has(XMLAttributes::ID))
+    {
+      ERROR("Node has no id attribute");
+    }
+    makeTemplate(child, element.addChild(attributes));
   }
-  newNode.isModule = (getAttVal(node, "fw_is_module")) && (*getAttVal(node, "fw_is_module") == "true");
-  if (auto tmp = getAttVal(node, "sw_monitor_warn_min_threshold"))
+}
+
+std::experimental::optional<xhal::utils::Node> xhal::utils::XHALXMLParser::getNode(const char* nodeName)
+{
+  DEBUG("Call getNode for argument " << nodeName);
+  TRACE("Searching node store");
+  uint32_t idx = m_store->find(nodeName);
+  std::experimental::optional<xhal::utils::Node> res;
+  if (idx != NodeStore::NO_NODE)
   {
-    newNode.warn_min_value = parseInt(*tmp);
+    // filled in place, Node has no move constructor
+    res.emplace();
+    m_store->toNode(idx, *res, nodeName);
+  } else if (!m_virtual.empty()) {
+    res.emplace();
+    if (!getVirtualNode(nodeName, *res)) res = std::experimental::nullopt;
   }
-  if (auto tmp = getAttVal(node, "sw_monitor_error_min_threshold"))
+  return res;
+}
+
+bool xhal::utils::XHALXMLParser::getVirtualNode(const char * nodeName, xhal::utils::Node & node)
+{
+  const std::string name(nodeName);
+  auto cached = m_lazyCacheIndex.find(name);
+  if (cached != m_lazyCacheIndex.end())
   {
-    newNode.warn_min_value = parseInt(*tmp);
+    m_lazyCache.splice(m_lazyCache.begin(), m_lazyCache, cached->second);
+    node = *cached->second;
+    return true;
   }
-
-  //nodes->push_back(newNode);
-  nodes->insert(std::make_pair(newNode.name,newNode));
-  //TRACE("Node vector size after push_back: " << nodes->size());
-  TRACE("Node map size after insert " << nodes->size());
-  if (parentNode)
+  // the generated node hangs below the deepest node of the store its name starts with
+  uint32_t parent = NodeStore::NO_NODE;
+  size_t pos = name.size();
+  while (pos > 0)
   {
-    parentNode->addChild(newNode);
-    newNode.parent = parentNode;
-    newNode.level = parentNode->level+1;
+    pos = name.rfind('.', pos - 1);
+    if (pos == std::string::npos)
+    {
+      pos = 0;
+      break;
+    }
+    parent = m_store->find(name.c_str(), pos);
+    if (parent != NodeStore::NO_NODE)
+    {
+      ++pos;
+      break;
+    }
   }
-  xercesc::DOMNodeList *children_ = node->getChildNodes();
-  const XMLSize_t nodeCount = children_->getLength();
-  DEBUG("Node children length: " << nodeCount);
-
-  for( XMLSize_t ix = 0 ; ix < nodeCount ; ++ix )
+  auto blocks = m_virtualByParent.find(parent);
+  if (blocks == m_virtualByParent.end()) return false;
+  NodeStore::Attributes attributes;
+  const std::string * description = nullptr;
+  for (auto b: blocks->second)
   {
-    if (children_->item(ix)->getNodeType() == xercesc::DOMNode::ELEMENT_NODE)
+    const VirtualBlock& block = m_virtual[b];
+    const int depth = block.element.find(name.data() + pos, name.size() - pos, block.baseAddress, attributes, &description);
+    if (depth == 0) continue;
+    TRACE("Resolved generated node " << name);
+    node.name = name;
+    node.description = *description;
+    node.address = attributes.address;
+    node.real_address = attributes.real_address;
+    node.permission = permissionName(attributes.permission);
+    node.mode = modeName(attributes.mode);
+    node.size = attributes.size;
+    node.mask = attributes.mask;
+    node.isModule = attributes.isModule;
+    node.isCacheable = attributes.isCacheable;
+    node.level = std::min(255, (parent == NodeStore::NO_NODE ? -1 : m_store->level(parent)) + depth);
+    node.warn_min_value = attributes.warn_min_value;
+    node.error_min_value = attributes.error_min_value;
+    if (m_lazyCacheSize > 0)
     {
-      makeTree(children_->item(ix),name,address,nodes,&newNode,vars,false);
-    } else {
-      continue;
+      if (m_lazyCache.size() >= m_lazyCacheSize)
+      {
+        m_lazyCacheIndex.erase(m_lazyCache.back().name);
+        m_lazyCache.pop_back();
+      }
+      m_lazyCache.push_front(node);
+      m_lazyCacheIndex[name] = m_lazyCache.begin();
     }
+    return true;
   }
+  return false;
 }
 
-std::experimental::optional<std::string> xhal::utils::XHALXMLParser::getAttVal(xercesc::DOMNode * t_node_, const char * attname)
+void xhal::utils::XHALXMLParser::clearLazyCache()
 {
-  TRACE("Call getAttVal for attribute " << attname);
-  XMLCh * tmp = xercesc::XMLString::transcode(attname);
-  xercesc::DOMElement* t_node = static_cast<xercesc::DOMElement*>(t_node_);
-  TRACE("tmp: " << tmp);
-  TRACE("successfull call of getAttribute: " << t_node->getAttribute(tmp));
-  char * tmp2 = xercesc::XMLString::transcode(t_node->getAttribute(tmp));
-  TRACE("tmp2: " << tmp2);
-  if (tmp2[0]!='\0')
-  {
-    std::string value = tmp2;
-    xercesc::XMLString::release(&tmp);
-    xercesc::XMLString::release(&tmp2);
-    TRACE("result " << value);
-    return value;
-  } else
+  m_lazyCache.clear();
+  m_lazyCacheIndex.clear();
+}
+
+void xhal::utils::XHALXMLParser::expandAll()
+{
+  if (m_virtual.empty()) return;
+  DEBUG("Expanding " << m_virtual.size() << " generate blocks");
+  for (auto const& block: m_virtual)
   {
-    TRACE("Attribute not found");
-    xercesc::XMLString::release(&tmp);
-    xercesc::XMLString::release(&tmp2);
-    return {};
+    block.element.expand(*m_store, block.baseAddress, block.parent, m_threads);
   }
+  m_virtual.clear();
+  m_virtualByParent.clear();
+  clearLazyCache();
+  m_store->buildIndices();
+  m_store->shrink();
+  DEBUG("Number of nodes: " << m_store->size());
 }
 
-unsigned int xhal::utils::XHALXMLParser::parseInt(std::string & s)
+bool xhal::utils::XHALXMLParser::expandCovering(const uint32_t nodeAddress)
 {
-  TRACE("Call parseInt for argument " << s);
-  std::stringstream converter(s);
-  uint32_t value;
-  if (s.find("0x") != std::string::npos) {
-    converter >> std::hex >> value;
-    TRACE("result " << value);
-    return value;
-  } else if (s.find("0b") != std::string::npos) {
-    TRACE("result " << std::stoi(s,nullptr,2));
-    return std::stoi(s,nullptr,2);
-  } else {
-    converter >> std::dec >> value;
-    TRACE("result " << value);
-    return value;
+  auto covers = [nodeAddress](const VirtualBlock& block) {
+    return block.firstRealAddress <= nodeAddress && nodeAddress <= block.lastRealAddress;
+  };
+  size_t expanded = 0;
+  for (auto const& block: m_virtual)
+  {
+    if (!covers(block)) continue;
+    block.element.expand(*m_store, block.baseAddress, block.parent, m_threads);
+    ++expanded;
   }
+  if (expanded == 0) return false;
+  DEBUG("Expanded " << expanded << " generate blocks covering address 0x" << std::hex << nodeAddress << std::dec);
+  m_virtual.erase(std::remove_if(m_virtual.begin(), m_virtual.end(), covers), m_virtual.end());
+  m_virtualByParent.clear();
+  for (size_t b = 0; b < m_virtual.size(); ++b) m_virtualByParent[m_virtual[b].parent].push_back(b);
+  // the nodes resolved so far are now found in the store first, the cache entries stay valid
+  m_store->buildIndices();
+  m_store->shrink();
+  return true;
 }
 
-std::string xhal::utils::XHALXMLParser::substituteVars(std::string & s, std::unordered_map<std::string, int> dict)
+std::experimental::optional<xhal::utils::Node> xhal::utils::XHALXMLParser::getNodeFromAddress(const uint32_t nodeAddress)
 {
-  if (s == "") {return s;}
-  std::string ret;
-  ret = s;
-  for (auto& p: dict)
+  if (!m_virtual.empty()) expandCovering(nodeAddress);
+  std::experimental::optional<xhal::utils::Node> res;
+  if (NodeRef node = findNodeFromAddress(nodeAddress))
   {
-    ret = replaceAll(ret,"${" + p.first + "}",std::to_string(p.second));
+    res.emplace();
+    m_store->toNode(node.index(), *res);
   }
-  return ret;
+  return res;
 }
 
-std::string xhal::utils::XHALXMLParser::replaceAll( std::string const& original, std::string const& from, std::string const& to )
+xhal::utils::NodeRef xhal::utils::XHALXMLParser::findNodeFromAddress(const uint32_t nodeAddress) const
 {
-    std::string results;
-    std::string::const_iterator end = original.end();
-    std::string::const_iterator current = original.begin();
-    std::string::const_iterator next = std::search( current, end, from.begin(), from.end() );
-    while ( next != end ) {
-        results.append( current, next );
-        results.append( to );
-        current = next + from.size();
-        next = std::search( current, end, from.begin(), from.end() );
+  uint32_t best = NodeStore::NO_NODE;
+  for (auto i: m_store->findByRealAddress(nodeAddress))
+  {
+    // prefer the full word register starting at the address over masked fields and block entries
+    if (m_store->realAddress(i) == nodeAddress && m_store->mask(i) == 0xFFFFFFFF)
+    {
+      best = i;
+      break;
     }
-    results.append( current, next );
-    return results;
+    if (best == NodeStore::NO_NODE) best = i;
+  }
+  return m_store->ref(best);
 }
 
-std::experimental::optional<xhal::utils::Node> xhal::utils::XHALXMLParser::getNode(const char* nodeName)
+std::vector<xhal::utils::Node> xhal::utils::XHALXMLParser::getNodesFromAddress(const uint32_t nodeAddress)
 {
-  DEBUG("Call getNode for argument " << nodeName);
-  //Node * res = NULL;
-  TRACE("Searching unordered map");
-  auto search = m_nodes->find(nodeName);
-  if (search!=m_nodes->end())
+  if (!m_virtual.empty()) expandCovering(nodeAddress);
+  std::vector<xhal::utils::Node> nodes;
+  for (auto i: m_store->findByRealAddress(nodeAddress))
   {
-    return search->second;
-  } else {
-    return {};
-  }
-  //TRACE("Looping over nodes");
-  //for (auto & n: *m_nodes)
-  //{
-  //  TRACE("Node name: " << n.name);
-  //  if (nodeName == n.name)
-  //  {
-  //    res = &n;
-  //    break;
-  //  }
-  //}
-  //if (res)
-  //{
-  //  return *res;
-  //} else {
-  //  return {};
-  //}
+    nodes.push_back(m_store->toNode(i));
+  }
+  return nodes;
 }
 
-std::experimental::optional<xhal::utils::Node> xhal::utils::XHALXMLParser::getNodeFromAddress(const uint32_t nodeAddress)
+std::vector<uint32_t> xhal::utils::XHALXMLParser::findNodes(const std::string& pattern)
 {
-  //Node * res = NULL;
-  //for (auto & n: *m_nodes)
-  //{
-  //  if (nodeAddress == n.real_address)
-  //  {
-  //    res = &n;
-  //    break;
-  //  }
-  //}
-  //if (res)
-  //{
-  //  return *res;
-  //} else {
-  //  return {};
-  //}
+  DEBUG("Call findNodes for pattern " << pattern);
+  NodePattern compiled(pattern);
+  expandAll();
+  return m_store->findNodes(compiled);
+}
 
+std::vector<xhal::utils::Node> xhal::utils::XHALXMLParser::getAllChildren(const char* nodeName)
+{
+  expandAll();
+  std::vector<xhal::utils::Node> kids;
+  const uint32_t top = m_store->find(nodeName);
+  if (top == NodeStore::NO_NODE) return kids;
+  // preorder walk of the first child / next sibling links
+  uint32_t i = top;
+  while (true)
+  {
+    const uint32_t child = m_store->firstChild(i);
+    if (child != NodeStore::NO_NODE)
+    {
+      i = child;
+      continue;
+    }
+    kids.push_back(m_store->toNode(i));
+    while (i != top && m_store->nextSibling(i) == NodeStore::NO_NODE) i = m_store->parent(i);
+    if (i == top) break;
+    i = m_store->nextSibling(i);
+  }
+  return kids;
 }
 
 std::unordered_map<std::string,xhal::utils::Node> xhal::utils::XHALXMLParser::getAllNodes()
 {
-  return *m_nodes;
+  expandAll();
+  std::unordered_map<std::string,xhal::utils::Node> nodes;
+  nodes.reserve(m_store->size());
+  for (NodeRef ref: *m_store)
+  {
+    Node node = ref.toNode();
+    nodes.insert(std::make_pair(node.name, node));
+  }
+  return nodes;
 }
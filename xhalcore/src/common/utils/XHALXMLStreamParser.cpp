@@ -0,0 +1,282 @@
+#include "xhal/utils/XHALXMLParser.h"
+#include "xhal/utils/XHALXMLStreamParser.h"
+
+#include <cstdlib>
+#include <memory>
+
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/sax/SAXParseException.hpp>
+
+namespace {
+  const unsigned int MAX_INCLUDE_DEPTH = 32;
+
+  /*
+   * Attribute and element names converted to XMLCh once, at static initialization time.
+   * The names are plain ASCII so no transcoder (nor Xerces initialization) is needed.
+   */
+  struct XMLChName
+  {
+    XMLCh s[32];
+    XMLChName() {s[0] = 0;}
+    XMLChName(const char * name)
+    {
+      size_t i = 0;
+      for (; name[i] != '\0'; ++i) s[i] = name[i];
+      s[i] = 0;
+    }
+  };
+
+  struct AttributeNames
+  {
+    XMLChName names[xhal::utils::XMLAttributes::COUNT];
+    AttributeNames()
+    {
+      for (int a = 0; a < xhal::utils::XMLAttributes::COUNT; ++a) names[a] = XMLChName(xhal::utils::XMLAttributes::NAMES[a]);
+    }
+  };
+
+  const AttributeNames ATTRIBUTE_NAMES;
+  const XMLChName XINCLUDE_NS("http://www.w3.org/2001/XInclude");
+  const XMLChName INCLUDE("include");
+  const XMLChName HREF("href");
+
+  bool equals(const XMLCh * a, const XMLCh * b)
+  {
+    while (*a == *b) {
+      if (*a == 0) return true;
+      ++a;
+      ++b;
+    }
+    return false;
+  }
+
+  /*
+   * ASCII values (the usual case) are copied directly, others go through the Xerces transcoder
+   * to get the same result as XMLString::transcode
+   */
+  void transcode(const XMLCh * value, std::string& out)
+  {
+    out.clear();
+    for (const XMLCh * p = value; *p != 0; ++p) {
+      if (*p >= 0x80) {
+        char * tmp = xercesc::XMLString::transcode(value);
+        out = tmp;
+        xercesc::XMLString::release(&tmp);
+        return;
+      }
+      out.push_back(static_cast<char>(*p));
+    }
+  }
+
+  /*
+   * Returns the attribute index of the name or -1
+   */
+  int attributeIndex(const XMLCh * name)
+  {
+    for (int a = 0; a < xhal::utils::XMLAttributes::COUNT; ++a) {
+      const XMLCh * candidate = ATTRIBUTE_NAMES.names[a].s;
+      if (name[0] == candidate[0] && equals(name, candidate)) return a;
+    }
+    return -1;
+  }
+
+  std::string dirName(const std::string& path)
+  {
+    size_t pos = path.rfind('/');
+    if (pos == std::string::npos) return "";
+    return path.substr(0, pos + 1);
+  }
+}
+
+void xhal::utils::readAttributes(const xercesc::Attributes& attrs, XMLAttributes& out)
+{
+  out.clear();
+  const XMLSize_t n = attrs.getLength();
+  for (XMLSize_t i = 0; i < n; ++i) {
+    const int a = attributeIndex(attrs.getQName(i));
+    if (a < 0) continue;
+    transcode(attrs.getValue(i), out.values[a]);
+    out.set(static_cast<XMLAttributes::Name>(a));
+  }
+}
+
+void xhal::utils::readAttributes(const xercesc::DOMElement * element, XMLAttributes& out)
+{
+  out.clear();
+  const xercesc::DOMNamedNodeMap * attrs = element->getAttributes();
+  const XMLSize_t n = attrs->getLength();
+  for (XMLSize_t i = 0; i < n; ++i) {
+    const xercesc::DOMNode * attr = attrs->item(i);
+    const int a = attributeIndex(attr->getNodeName());
+    if (a < 0) continue;
+    transcode(attr->getNodeValue(), out.values[a]);
+    out.set(static_cast<XMLAttributes::Name>(a));
+  }
+}
+
+xhal::utils::XHALXMLStreamParser::XHALXMLStreamParser(NodeStore * store, log4cplus::Logger logger, unsigned int threads):
+  m_store(store),
+  m_logger(logger),
+  m_threads(threads),
+  m_virtual(nullptr),
+  m_fragments(nullptr),
+  m_depth(0),
+  m_skipDepth(0)
+{
+  m_captureParent.node = NodeStore::NO_NODE;
+  m_captureParent.address = 0;
+}
+
+void xhal::utils::XHALXMLStreamParser::parse(const std::string& xmlFile)
+{
+  m_frames.clear();
+  m_depth = 0;
+  parseTop(xmlFile);
+}
+
+void xhal::utils::XHALXMLStreamParser::parseFragment(const std::string& fileName, uint32_t parent, uint32_t parentAddress, unsigned int depth)
+{
+  m_frames.clear();
+  Frame frame;
+  frame.node = parent;
+  frame.address = parentAddress;
+  m_frames.push_back(frame);
+  m_depth = depth;
+  parseTop(fileName);
+}
+
+void xhal::utils::XHALXMLStreamParser::parseTop(const std::string& fileName)
+{
+  m_files.clear();
+  m_capture.clear();
+  m_skipDepth = 0;
+  try {
+    parseFile(fileName);
+  } catch (const xercesc::SAXParseException& e) {
+    char * message = xercesc::XMLString::transcode(e.getMessage());
+    char * systemId = xercesc::XMLString::transcode(e.getSystemId());
+    ERROR("An error occured during parsing of " << systemId << " line " << e.getLineNumber() << std::endl
+          << "   Message: " << message);
+    xercesc::XMLString::release(&message);
+    xercesc::XMLString::release(&systemId);
+    throw xhal::utils::Exception("XHALParser: an error occured during parsing");
+  } catch (const xercesc::XMLException& e) {
+    char * message = xercesc::XMLString::transcode(e.getMessage());
+    ERROR("An error occured during parsing" << std::endl
+          << "   Message: " << message);
+    xercesc::XMLString::release(&message);
+    throw xhal::utils::Exception("XHALParser: an error occured during parsing");
+  }
+}
+
+void xhal::utils::XHALXMLStreamParser::parseFile(const std::string& fileName)
+{
+  if (m_files.size() > MAX_INCLUDE_DEPTH) {
+    ERROR("XInclude nesting is too deep, possible include loop at " << fileName);
+    throw xhal::utils::Exception("XHALParser: XInclude nesting is too deep");
+  }
+  DEBUG("Streaming " << fileName);
+  std::unique_ptr<xercesc::SAX2XMLReader> reader(xercesc::XMLReaderFactory::createXMLReader());
+  reader->setFeature(xercesc::XMLUni::fgSAX2CoreNameSpaces, true);
+  reader->setFeature(xercesc::XMLUni::fgSAX2CoreValidation, false);
+  reader->setFeature(xercesc::XMLUni::fgXercesSchema, false);
+  reader->setFeature(xercesc::XMLUni::fgXercesLoadExternalDTD, false);
+  reader->setContentHandler(this);
+  reader->setErrorHandler(this);
+  m_files.push_back(fileName);
+  reader->parse(fileName.c_str());
+  m_files.pop_back();
+}
+
+void xhal::utils::XHALXMLStreamParser::include(const xercesc::Attributes& attrs)
+{
+  const XMLCh * href = attrs.getValue(HREF.s);
+  if (href == nullptr) {
+    WARN("xi:include without href attribute in " << m_files.back() << " ignored");
+    return;
+  }
+  std::string fileName;
+  transcode(href, fileName);
+  if (fileName.empty() || fileName[0] != '/') fileName = dirName(m_files.back()) + fileName;
+  // the root element of the included file takes the place of the xi:include element
+  if (!m_fragments) {
+    parseFile(fileName);
+    return;
+  }
+  XMLFragment fragment;
+  fragment.file = fileName;
+  fragment.hash = XHALXMLCache::fileHash(fileName);
+  fragment.depth = m_depth + m_files.size();
+  fragment.parent = m_frames.empty() ? NodeStore::NO_NODE : m_frames.back().node;
+  fragment.parentAddress = m_frames.empty() ? 0 : m_frames.back().address;
+  // inside a generate block the nodes are only emitted when the block is expanded
+  fragment.reloadable = m_capture.empty();
+  fragment.first = fragment.end = m_store->size();
+  const size_t idx = m_fragments->size();
+  m_fragments->push_back(fragment);
+  parseFile(fileName);
+  if (fragment.reloadable) (*m_fragments)[idx].end = m_store->size();
+}
+
+void xhal::utils::XHALXMLStreamParser::startElement(const XMLCh * const uri, const XMLCh * const localname,
+                                                      const XMLCh * const qname, const xercesc::Attributes& attrs)
+{
+  if (m_skipDepth > 0) {
+    ++m_skipDepth;
+    return;
+  }
+  if (equals(localname, INCLUDE.s) && equals(uri, XINCLUDE_NS.s)) {
+    include(attrs);
+    // skip xi:fallback and anything else inside the xi:include element
+    m_skipDepth = 1;
+    return;
+  }
+  readAttributes(attrs, m_attributes);
+  if (!m_attributes.has(XMLAttributes::ID)) ERROR("Node has no id attribute");
+  if (!m_capture.empty()) {
+    m_capture.push_back(&m_capture.back()->addChild(m_attributes));
+    return;
+  }
+
+  Frame parent;
+  if (m_frames.empty()) {
+    parent.node = NodeStore::NO_NODE;
+    parent.address = 0;
+  } else {
+    parent = m_frames.back();
+  }
+  m_element.assign(m_attributes);
+  if (m_element.isGenerate()) {
+    // the subtree is recorded and expanded once the element is closed
+    m_template.assign(m_attributes);
+    m_capture.push_back(&m_template);
+    m_captureParent = parent;
+    return;
+  }
+  Frame frame;
+  frame.node = m_element.emit(*m_store, parent.address, parent.node, frame.address);
+  m_frames.push_back(frame);
+}
+
+void xhal::utils::XHALXMLStreamParser::endElement(const XMLCh * const uri, const XMLCh * const localname, const XMLCh * const qname)
+{
+  if (m_skipDepth > 0) {
+    --m_skipDepth;
+    return;
+  }
+  if (!m_capture.empty()) {
+    m_capture.pop_back();
+    if (m_capture.empty()) {
+      m_template.compile();
+      if (m_virtual) {
+        m_virtual->push_back(VirtualBlock{std::move(m_template), m_captureParent.node, m_captureParent.address});
+      } else {
+        m_template.expand(*m_store, m_captureParent.address, m_captureParent.node, m_threads);
+      }
+      m_template.assign(XMLAttributes());
+    }
+    return;
+  }
+  m_frames.pop_back();
+}